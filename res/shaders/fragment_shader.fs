@@ -1,4 +1,7 @@
 #version 330 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
 out vec4 frag_color;
 
 in vec3 frag_pos;
@@ -9,15 +12,19 @@ in vec4 frag_pos_light_space;
 struct Material {
   sampler2D diffuse1;
   sampler2D specular1;
+  // Layers in the shared material textures, -1 samples the samplers above.
+  int diffuse_layer;
+  int specular_layer;
   float shininess;
 
   bool is_blinn_phong;
 };
 
+// The light structs follow std140 rules and are mirrored on the CPU side by
+// LightController, keep both in sync.
 struct DirectLight {
-  bool enable;
-
   vec3 direction;
+  bool enable;
 
   vec3 ambient;
   vec3 diffuse;
@@ -25,102 +32,161 @@ struct DirectLight {
 };
 
 struct PointLight {
-  bool enable;
-
   vec3 position;
+  float constant;
 
   vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-
-  float constant;
   float linear;
+
+  vec3 diffuse;
   float quadratic;
-};
 
-struct SpotLight {
+  vec3 specular;
   bool enable;
+};
 
+struct SpotLight {
   vec3 position;
-  vec3 direction;
+  float constant;
 
-  float cut_off;
-  float outer_cut_off;
+  vec3 direction;
+  float linear;
 
   vec3 ambient;
+  float quadratic;
+
   vec3 diffuse;
+  float cut_off;
+
   vec3 specular;
+  float outer_cut_off;
 
-  float constant;
-  float linear;
-  float quadratic;
+  bool enable;
 };
 
-#define DIRECT_LIGHT_COUNT 1
-#define POINT_LIGHT_COUNT 4
-#define SPOT_LIGHT_COUNT 2
+#define MAX_DIRECT_LIGHTS 1
+#define MAX_POINT_LIGHTS 4
+#define MAX_SPOT_LIGHTS 2
 
-uniform bool gamma = true;
+layout (std140) uniform Lights {
+  DirectLight direct_light[MAX_DIRECT_LIGHTS];
+  PointLight point_light[MAX_POINT_LIGHTS];
+  SpotLight spot_light[MAX_SPOT_LIGHTS];
+  SpotLight flashlight;
+};
+
+layout (std140) uniform FrameConstants {
+  mat4 view;
+  mat4 project;
+  mat4 view_project;
+  vec4 view_position;
+  int frame_index;
+};
 
-uniform vec3 view_position;
+// Mirrored by MaterialTextures, keep the sizes in sync.
+#ifdef BINDLESS_TEXTURES
+layout (std140) uniform MaterialTextures {
+  uvec2 material_handles[256];
+};
+#else
+uniform sampler2DArray material_textures;
+#endif
 
-uniform Material material;
+uniform bool gamma = true;
 
-uniform DirectLight direct_light[DIRECT_LIGHT_COUNT];
-uniform PointLight point_light[POINT_LIGHT_COUNT];
-uniform SpotLight spot_light[SPOT_LIGHT_COUNT];
-uniform SpotLight flashlight;
+uniform Material material;
 
 uniform bool shadow_enable = true;
 uniform sampler2D shadow_map;
 
+// Specialised variants get SPECIALIZED plus the light counts and feature
+// switches injected as #defines, so every branch below folds away at compile
+// time. The uber shader falls back to the runtime uniforms.
+#ifdef SPECIALIZED
+#define LIGHT_ENABLED(light) true
+#else
+#define DIRECT_LIGHT_COUNT MAX_DIRECT_LIGHTS
+#define POINT_LIGHT_COUNT MAX_POINT_LIGHTS
+#define SPOT_LIGHT_COUNT MAX_SPOT_LIGHTS
+#define FLASHLIGHT_ENABLE flashlight.enable
+#define BLINN_PHONG material.is_blinn_phong
+#define SHADOW_ENABLE shadow_enable
+#define GAMMA_ENABLE gamma
+#define LIGHT_ENABLED(light) (light).enable
+#endif
+
+vec4 SampleMaterialTexture(sampler2D fallback, int layer, vec2 tex_coords);
+
 float CalculateShadow(vec4 light_space_frag_pos, vec3 normal, vec3 light_dir);
 
-vec3 CalculateDirectLight(DirectLight light, vec3 normal, vec3 view_dir);
+float CalculateSpecular(vec3 light_dir, vec3 normal, vec3 view_dir);
 
-vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 frag_position, vec3 view_dir);
+vec3 CalculateDirectLight(DirectLight light, vec3 normal, vec3 view_dir, vec3 diffuse1, vec3 specular1);
 
-vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 frag_position, vec3 view_dir);
+vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 view_dir, vec3 diffuse1, vec3 specular1);
+
+vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 view_dir, vec3 diffuse1, vec3 specular1);
 
 void main() {
   vec3 normal = normalize(frag_normal);
-  vec3 view_direction = normalize(view_position - frag_pos);
+  vec3 view_direction = normalize(view_position.xyz - frag_pos);
+
+  vec3 diffuse1 = vec3(SampleMaterialTexture(material.diffuse1, material.diffuse_layer, frag_tex_coords));
+  vec3 specular1 = vec3(SampleMaterialTexture(material.specular1, material.specular_layer, frag_tex_coords));
 
   vec3 res = vec3(0.0, 0.0, 0.0);
 
   for (int i = 0; i < DIRECT_LIGHT_COUNT; ++i) {
-    if (direct_light[i].enable) {
-      res += CalculateDirectLight(direct_light[i], normal, view_direction);
+    if (LIGHT_ENABLED(direct_light[i])) {
+      res += CalculateDirectLight(direct_light[i], normal, view_direction, diffuse1, specular1);
     }
   }
 
   for (int i = 0; i < POINT_LIGHT_COUNT; ++i) {
-    if (point_light[i].enable) {
-      res += CalculatePointLight(point_light[i], normal, frag_pos, view_direction);
+    if (LIGHT_ENABLED(point_light[i])) {
+      res += CalculatePointLight(point_light[i], normal, view_direction, diffuse1, specular1);
     }
   }
 
   for (int i = 0; i < SPOT_LIGHT_COUNT; ++i) {
-    if (spot_light[i].enable) {
-      res += CalculateSpotLight(spot_light[i], normal, frag_pos, view_direction);
+    if (LIGHT_ENABLED(spot_light[i])) {
+      res += CalculateSpotLight(spot_light[i], normal, view_direction, diffuse1, specular1);
     }
   }
 
-  if (flashlight.enable) {
-    res += CalculateSpotLight(flashlight, normal, frag_pos, view_direction);
+  if (FLASHLIGHT_ENABLE) {
+    res += CalculateSpotLight(flashlight, normal, view_direction, diffuse1, specular1);
   }
 
-  if (gamma) {
+  if (GAMMA_ENABLE) {
     res = pow(res, vec3(1.0 / 2.2));
   }
 
   frag_color = vec4(res, 1.0);
 }
 
-vec3 CalculateDirectLight(DirectLight light, vec3 normal, vec3 view_dir) {
-  vec3 diffuse1 = vec3(texture(material.diffuse1, frag_tex_coords));
-  vec3 specular1 = vec3(texture(material.specular1, frag_tex_coords));
+vec4 SampleMaterialTexture(sampler2D fallback, int layer, vec2 tex_coords) {
+  if (layer < 0) {
+    return texture(fallback, tex_coords);
+  }
+#ifdef BINDLESS_TEXTURES
+  return texture(sampler2D(material_handles[layer]), tex_coords);
+#else
+  return texture(material_textures, vec3(tex_coords, float(layer)));
+#endif
+}
 
+float CalculateSpecular(vec3 light_dir, vec3 normal, vec3 view_dir) {
+  if (BLINN_PHONG) {
+    vec3 half_vec = normalize(light_dir + view_dir);
+    return pow(max(dot(normal, half_vec), 0.0), material.shininess);
+  } else {
+    vec3 reflect_dir = reflect(-light_dir, normal);
+    return pow(max(dot(reflect_dir, view_dir), 0.0), material.shininess);
+  }
+}
+
+vec3 CalculateDirectLight(DirectLight light, vec3 normal, vec3 view_dir, vec3 diffuse1, vec3 specular1) {
   vec3 ambient = light.ambient * diffuse1;
 
   vec3 light_dir = normalize(-light.direction);
@@ -128,44 +194,25 @@ vec3 CalculateDirectLight(DirectLight light, vec3 normal, vec3 view_dir) {
   float diff = max(dot(normal, light_dir), 0.0);
   vec3 diffuse = light.diffuse * diff * diffuse1;
 
-  float spec;
-  if (material.is_blinn_phong) {
-    vec3 view_direction = normalize(view_position - frag_pos);
-    vec3 half_vec = normalize(light_dir + view_direction);
-    spec = pow(max(dot(normal, half_vec), 0.0), material.shininess);
-  } else {
-    vec3 reflect_dir = reflect(-light_dir, normal);
-    spec = pow(max(dot(reflect_dir, view_dir), 0.0), material.shininess);
-  }
+  float spec = CalculateSpecular(light_dir, normal, view_dir);
   vec3 specular = light.specular * spec * specular1;
 
   float shadow = 0.0;
-  if (shadow_enable) {
+  if (SHADOW_ENABLE) {
     shadow = CalculateShadow(frag_pos_light_space, normal, light_dir);
   }
 
   return ambient + (1.0 - shadow) * (diffuse + specular);
 }
 
-vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 frag_position, vec3 view_dir) {
-  vec3 diffuse1 = vec3(texture(material.diffuse1, frag_tex_coords));
-  vec3 specular1 = vec3(texture(material.specular1, frag_tex_coords));
-
+vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 view_dir, vec3 diffuse1, vec3 specular1) {
   vec3 ambient = light.ambient * diffuse1;
 
-  vec3 light_dir = normalize(light.position - frag_position);
+  vec3 light_dir = normalize(light.position - frag_pos);
   float diff = max(dot(light_dir, normal), 0.0);
   vec3 diffuse = light.diffuse * diff * diffuse1;
 
-  float spec;
-  if (material.is_blinn_phong) {
-    vec3 view_direction = normalize(view_position - frag_position);
-    vec3 half_vec = normalize(light_dir + view_direction);
-    spec = pow(max(dot(normal, half_vec), 0.0), material.shininess);
-  } else {
-    vec3 reflect_dir = reflect(-light_dir, normal);
-    spec = pow(max(dot(reflect_dir, view_dir), 0.0), material.shininess);
-  }
+  float spec = CalculateSpecular(light_dir, normal, view_dir);
   vec3 specular = light.specular * spec * specular1;
 
   float distance = length(light.position - frag_pos);
@@ -174,10 +221,7 @@ vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 frag_position, vec3
   return (ambient + diffuse + specular) * attenuation;
 }
 
-vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 frag_position, vec3 view_dir) {
-  vec3 diffuse1 = vec3(texture(material.diffuse1, frag_tex_coords));
-  vec3 specular1 = vec3(texture(material.specular1, frag_tex_coords));
-
+vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 view_dir, vec3 diffuse1, vec3 specular1) {
   vec3 ambient = light.ambient * diffuse1;
 
   vec3 light_dir = normalize(light.position - frag_pos);
@@ -188,15 +232,7 @@ vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 frag_position, vec3 v
   float diff = max(dot(light_dir, normal), 0.0);
   vec3 diffuse = light.diffuse * diff * diffuse1 * intensity;
 
-  float spec;
-  if (material.is_blinn_phong) {
-    vec3 view_direction = normalize(view_position - frag_position);
-    vec3 half_vec = normalize(light_dir + view_direction);
-    spec = pow(max(dot(normal, half_vec), 0.0), material.shininess);
-  } else {
-    vec3 reflect_dir = reflect(-light_dir, normal);
-    spec = pow(max(dot(reflect_dir, view_dir), 0.0), material.shininess);
-  }
+  float spec = CalculateSpecular(light_dir, normal, view_dir);
   vec3 specular = light.specular * spec * specular1 * intensity;
 
   float distance = length(light.position - frag_pos);
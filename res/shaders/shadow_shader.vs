@@ -1,10 +1,26 @@
 #version 330 core
 
 layout (location = 0) in vec3 pos;
+#ifdef INSTANCED
+layout (location = 3) in mat4 instance_model;
+layout (location = 10) in vec3 instance_position_scale;
+layout (location = 11) in vec3 instance_position_offset;
+#endif
 
 uniform mat4 light_space_trans;
 uniform mat4 model;
 
+// Dequantisation of packed positions, identity for float ones.
+uniform vec3 position_scale = vec3(1.0);
+uniform vec3 position_offset = vec3(0.0);
+
 void main() {
-  gl_Position = light_space_trans * model * vec4(pos, 1.0);
+#ifdef INSTANCED
+  mat4 model_matrix = instance_model;
+  vec3 position = instance_position_offset + instance_position_scale * pos;
+#else
+  mat4 model_matrix = model;
+  vec3 position = position_offset + position_scale * pos;
+#endif
+  gl_Position = light_space_trans * (model_matrix * vec4(position, 1.0));
 }
@@ -1,22 +1,84 @@
 #version 330 core
 layout (location = 0) in vec3 pos;
+#ifdef PACKED_VERTICES
+// Octahedral in xy, see PackedVertex.
+layout (location = 1) in vec4 normal;
+#else
 layout (location = 1) in vec3 normal;
+#endif
 layout (location = 2) in vec2 tex_coords;
+#ifdef INSTANCED
+// See InstanceData.
+layout (location = 3) in mat4 instance_model;
+layout (location = 7) in mat3 instance_normal_matrix;
+layout (location = 10) in vec3 instance_position_scale;
+layout (location = 11) in vec3 instance_position_offset;
+#endif
+
+layout (std140) uniform FrameConstants {
+  mat4 view;
+  mat4 project;
+  mat4 view_project;
+  vec4 view_position;
+  int frame_index;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 project;
+// transpose(inverse(mat3(model))), computed once by Model.
+uniform mat3 normal_matrix = mat3(1.0);
 uniform mat4 light_space_trans;
 
+// Dequantisation of packed positions, identity for float ones.
+uniform vec3 position_scale = vec3(1.0);
+uniform vec3 position_offset = vec3(0.0);
+
 out vec3 frag_pos;
 out vec3 frag_normal;
 out vec2 frag_tex_coords;
 out vec4 frag_pos_light_space;
 
+#ifdef PACKED_VERTICES
+vec3 DecodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+#endif
+
 void main() {
-  gl_Position = project * view * model * vec4(pos, 1.0);
-  frag_pos = vec3(model * vec4(pos, 1.0));
-  frag_normal = mat3(transpose(inverse(model))) * normal;
+#ifdef INSTANCED
+  vec3 position = instance_position_offset + instance_position_scale * pos;
+#else
+  vec3 position = position_offset + position_scale * pos;
+#endif
+#ifdef PACKED_VERTICES
+  vec3 object_normal = DecodeOctahedral(normal.xy / 511.0);
+#else
+  vec3 object_normal = normal;
+#endif
+
+#ifdef INSTANCED
+  mat4 model_matrix = instance_model;
+  mat3 normal_transform = instance_normal_matrix;
+#else
+  mat4 model_matrix = model;
+  mat3 normal_transform = normal_matrix;
+#endif
+
+#ifdef PER_VERTEX_TRANSFORMS
+  // Baseline for the vertex benchmark: matrix products and the inverse
+  // redone for every vertex.
+  vec4 world_position = model_matrix * vec4(position, 1.0);
+  gl_Position = view_project * model_matrix * vec4(position, 1.0);
+  frag_normal = mat3(transpose(inverse(model_matrix))) * object_normal;
+#else
+  vec4 world_position = model_matrix * vec4(position, 1.0);
+  gl_Position = view_project * world_position;
+  frag_normal = normal_transform * object_normal;
+#endif
+  frag_pos = vec3(world_position);
   frag_tex_coords = tex_coords;
-  frag_pos_light_space = light_space_trans * vec4(pos, 1.0);
+  frag_pos_light_space = light_space_trans * world_position;
 }
@@ -0,0 +1,310 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "block_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+const int kBC7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Endpoints of the principal axis of |block| over the first |channels|
+// channels, i.e. the line through the mean along the direction of largest
+// variance, clipped to the extent of the texels.
+void FitEndpoints(const unsigned char* block, int channels, float* low, float* high) {
+  float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < channels; ++c) {
+      mean[c] += block[i * 4 + c];
+    }
+  }
+  for (int c = 0; c < channels; ++c) {
+    mean[c] /= 16.0f;
+  }
+
+  float covariance[4][4] = {};
+  for (int i = 0; i < 16; ++i) {
+    for (int a = 0; a < channels; ++a) {
+      for (int b = 0; b < channels; ++b) {
+        covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+      }
+    }
+  }
+
+  // A few power iterations are plenty for a 4x4 block.
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float length = 0.0f;
+    for (int a = 0; a < channels; ++a) {
+      for (int b = 0; b < channels; ++b) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      length = std::max(length, std::fabs(next[a]));
+    }
+    if (length == 0.0f) {
+      break;
+    }
+    for (int c = 0; c < channels; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  float min_t = 0.0f, max_t = 0.0f;
+  for (int i = 0; i < 16; ++i) {
+    float t = 0.0f;
+    for (int c = 0; c < channels; ++c) {
+      t += (block[i * 4 + c] - mean[c]) * axis[c];
+    }
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+
+  float axis_length = 0.0f;
+  for (int c = 0; c < channels; ++c) {
+    axis_length += axis[c] * axis[c];
+  }
+  if (axis_length > 0.0f) {
+    min_t /= axis_length;
+    max_t /= axis_length;
+  }
+
+  for (int c = 0; c < channels; ++c) {
+    low[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+    high[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+  }
+}
+
+uint16_t PackRGB565(const float* color) {
+  int r = std::clamp((int)std::lround(color[0] * 31.0f / 255.0f), 0, 31);
+  int g = std::clamp((int)std::lround(color[1] * 63.0f / 255.0f), 0, 63);
+  int b = std::clamp((int)std::lround(color[2] * 31.0f / 255.0f), 0, 31);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void UnpackRGB565(uint16_t packed, int* color) {
+  int r = (packed >> 11) & 31;
+  int g = (packed >> 5) & 63;
+  int b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+int SquaredDistance(const unsigned char* texel, const int* color, int channels) {
+  int distance = 0;
+  for (int c = 0; c < channels; ++c) {
+    int delta = texel[c] - color[c];
+    distance += delta * delta;
+  }
+  return distance;
+}
+
+void WriteLittleEndian(unsigned char* output, uint64_t bits, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    output[i] = (unsigned char)(bits >> (8 * i));
+  }
+}
+
+std::size_t BlockEncoder::GetBlockBytes(Format format) {
+  return format == Format::kBC1 ? 8 : 16;
+}
+
+std::vector<unsigned char> BlockEncoder::CompressImage(const unsigned char* rgba, int width, int height,
+                                                       Format format, ThreadPool* pool) {
+  int blocks_x = (width + 3) / 4;
+  int blocks_y = (height + 3) / 4;
+  std::size_t block_bytes = GetBlockBytes(format);
+  std::vector<unsigned char> output((std::size_t)blocks_x * blocks_y * block_bytes);
+
+  auto encode_rows = [&](std::size_t begin, std::size_t end) {
+    unsigned char block[64];
+    for (std::size_t by = begin; by < end; ++by) {
+      for (int bx = 0; bx < blocks_x; ++bx) {
+        for (int y = 0; y < 4; ++y) {
+          int source_y = std::min((int)by * 4 + y, height - 1);
+          for (int x = 0; x < 4; ++x) {
+            int source_x = std::min(bx * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + ((std::size_t)source_y * width + source_x) * 4, 4);
+          }
+        }
+
+        unsigned char* target = output.data() + (by * blocks_x + bx) * block_bytes;
+        if (format == Format::kBC1) {
+          EncodeBC1(block, target);
+        } else if (format == Format::kBC3) {
+          EncodeBC3(block, target);
+        } else {
+          EncodeBC7(block, target);
+        }
+      }
+    }
+  };
+
+  if (pool) {
+    pool->ParallelFor(blocks_y, encode_rows);
+  } else {
+    encode_rows(0, blocks_y);
+  }
+
+  return output;
+}
+
+void BlockEncoder::EncodeBC1(const unsigned char* block, unsigned char* output) {
+  float low[4], high[4];
+  FitEndpoints(block, 3, low, high);
+
+  uint16_t color0 = PackRGB565(high);
+  uint16_t color1 = PackRGB565(low);
+  // color0 > color1 selects the four colour mode, a flat block needs no indices.
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+  if (color0 == color1) {
+    WriteLittleEndian(output, color0 | ((uint32_t)color1 << 16), 4);
+    WriteLittleEndian(output + 4, 0, 4);
+    return;
+  }
+
+  int palette[4][3];
+  UnpackRGB565(color0, palette[0]);
+  UnpackRGB565(color1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; ++i) {
+    int best = 0;
+    int best_distance = SquaredDistance(block + i * 4, palette[0], 3);
+    for (int p = 1; p < 4; ++p) {
+      int distance = SquaredDistance(block + i * 4, palette[p], 3);
+      if (distance < best_distance) {
+        best = p;
+        best_distance = distance;
+      }
+    }
+    indices |= (uint32_t)best << (2 * i);
+  }
+
+  WriteLittleEndian(output, color0 | ((uint32_t)color1 << 16), 4);
+  WriteLittleEndian(output + 4, indices, 4);
+}
+
+void BlockEncoder::EncodeBC3(const unsigned char* block, unsigned char* output) {
+  int alpha0 = 0, alpha1 = 255;
+  for (int i = 0; i < 16; ++i) {
+    alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+    alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+  }
+
+  uint64_t alpha_bits = (uint64_t)alpha0 | ((uint64_t)alpha1 << 8);
+  if (alpha0 != alpha1) {
+    // alpha0 > alpha1 selects the eight step ramp.
+    int ramp[8] = {alpha0, alpha1};
+    for (int i = 1; i < 7; ++i) {
+      ramp[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+      int alpha = block[i * 4 + 3];
+      int best = 0;
+      for (int r = 1; r < 8; ++r) {
+        if (std::abs(alpha - ramp[r]) < std::abs(alpha - ramp[best])) {
+          best = r;
+        }
+      }
+      alpha_bits |= (uint64_t)best << (16 + 3 * i);
+    }
+  }
+
+  WriteLittleEndian(output, alpha_bits, 8);
+  EncodeBC1(block, output + 8);
+}
+
+void BlockEncoder::EncodeBC7(const unsigned char* block, unsigned char* output) {
+  float low[4], high[4];
+  FitEndpoints(block, 4, low, high);
+
+  // Mode 6: one subset, 7 bit RGBA endpoints plus a shared low bit each.
+  int endpoints[2][4];
+  int p_bits[2];
+  const float* fitted[2] = {low, high};
+  for (int e = 0; e < 2; ++e) {
+    int best_error = -1;
+    for (int p = 0; p < 2; ++p) {
+      int error = 0;
+      int quantized[4];
+      for (int c = 0; c < 4; ++c) {
+        int q = std::clamp((int)std::lround((fitted[e][c] - p) / 2.0f), 0, 127);
+        quantized[c] = q;
+        int delta = ((q << 1) | p) - (int)std::lround(fitted[e][c]);
+        error += delta * delta;
+      }
+      if (best_error < 0 || error < best_error) {
+        best_error = error;
+        p_bits[e] = p;
+        std::memcpy(endpoints[e], quantized, sizeof(quantized));
+      }
+    }
+  }
+
+  int palette[16][4];
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      int e0 = (endpoints[0][c] << 1) | p_bits[0];
+      int e1 = (endpoints[1][c] << 1) | p_bits[1];
+      palette[i][c] = ((64 - kBC7Weights[i]) * e0 + kBC7Weights[i] * e1 + 32) >> 6;
+    }
+  }
+
+  int indices[16];
+  for (int i = 0; i < 16; ++i) {
+    int best = 0;
+    int best_distance = SquaredDistance(block + i * 4, palette[0], 4);
+    for (int p = 1; p < 16; ++p) {
+      int distance = SquaredDistance(block + i * 4, palette[p], 4);
+      if (distance < best_distance) {
+        best = p;
+        best_distance = distance;
+      }
+    }
+    indices[i] = best;
+  }
+
+  // The first index is stored without its top bit, which must be clear.
+  if (indices[0] >= 8) {
+    for (int c = 0; c < 4; ++c) {
+      std::swap(endpoints[0][c], endpoints[1][c]);
+    }
+    std::swap(p_bits[0], p_bits[1]);
+    for (int i = 0; i < 16; ++i) {
+      indices[i] = 15 - indices[i];
+    }
+  }
+
+  uint64_t bits[2] = {0, 0};
+  int position = 0;
+  auto put = [&](uint64_t value, int count) {
+    for (int i = 0; i < count; ++i, ++position) {
+      bits[position / 64] |= ((value >> i) & 1) << (position % 64);
+    }
+  };
+
+  put(1 << 6, 7);
+  for (int c = 0; c < 4; ++c) {
+    put(endpoints[0][c], 7);
+    put(endpoints[1][c], 7);
+  }
+  put(p_bits[0], 1);
+  put(p_bits[1], 1);
+  put(indices[0], 3);
+  for (int i = 1; i < 16; ++i) {
+    put(indices[i], 4);
+  }
+
+  WriteLittleEndian(output, bits[0], 8);
+  WriteLittleEndian(output + 8, bits[1], 8);
+}
@@ -0,0 +1,36 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef BLOCK_ENCODER_H_
+#define BLOCK_ENCODER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "thread_pool.h"
+
+// CPU encoder for the BCn block compressed formats. Quality is that of a
+// fast single pass fit (principal axis endpoints, nearest palette index), good
+// enough for offline conversion of the scene textures.
+class BlockEncoder {
+ public:
+  enum class Format {
+    kBC1,  // RGB, 4 bpp.
+    kBC3,  // RGBA with interpolated alpha, 8 bpp.
+    kBC7,  // RGBA, mode 6 only, 8 bpp.
+  };
+
+  static std::size_t GetBlockBytes(Format format);
+
+  // Compresses a tightly packed RGBA8 image. Edge blocks of sizes that aren't
+  // a multiple of 4 repeat the last row/column. Block rows are spread over
+  // |pool| when given.
+  static std::vector<unsigned char> CompressImage(const unsigned char* rgba, int width, int height,
+                                                  Format format, ThreadPool* pool = nullptr);
+
+  // |block| holds 4x4 RGBA8 texels, row by row.
+  static void EncodeBC1(const unsigned char* block, unsigned char* output);
+  static void EncodeBC3(const unsigned char* block, unsigned char* output);
+  static void EncodeBC7(const unsigned char* block, unsigned char* output);
+};
+
+#endif // BLOCK_ENCODER_H_
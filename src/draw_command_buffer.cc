@@ -0,0 +1,62 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "draw_command_buffer.h"
+
+#include <cstring>
+
+#include "geometry_buffer.h"
+#include "gl_extensions.h"
+
+DrawCommandBuffer::DrawCommandBuffer()
+    : indirect_(GLExtensions::has_multi_draw_indirect),
+      uploaded_(false) {}
+
+void DrawCommandBuffer::Upload(const std::vector<DrawElementsIndirectCommand>& commands) {
+  commands_ = commands;
+  uploaded_ = false;
+  if (!indirect_ || commands.empty()) {
+    return;
+  }
+
+  auto& ring_buffer = FrameRingBuffer::Get();
+  allocation_ = ring_buffer.Allocate(commands.size() * sizeof(DrawElementsIndirectCommand));
+  // Mapping may fail without persistent mapping, this frame then draws
+  // command by command.
+  if (allocation_.data) {
+    std::memcpy(allocation_.data, commands.data(), allocation_.size);
+    uploaded_ = true;
+  }
+  ring_buffer.Unmap(allocation_);
+}
+
+std::size_t DrawCommandBuffer::Draw(const InstanceBuffer& instances, int page, std::size_t first,
+                                    std::size_t count) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  GeometryBuffer::Get().Bind(page);
+  if (uploaded_) {
+    instances.Bind(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, allocation_.buffer);
+    GLExtensions::MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                            (void*)(allocation_.offset + first * sizeof(DrawElementsIndirectCommand)),
+                                            count, 0);
+    return 1;
+  }
+
+  for (std::size_t i = first; i < first + count; ++i) {
+    const auto& command = commands_[i];
+    instances.Bind(command.base_instance);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                                      (void*)(command.first_index * sizeof(GLuint)),
+                                      command.instance_count, command.base_vertex);
+  }
+  return count;
+}
+
+void DrawCommandBuffer::SetIndirect(bool indirect) {
+  // Takes effect with the next Upload(), which fills the buffer only while
+  // indirect.
+  indirect_ = indirect && GLExtensions::has_multi_draw_indirect;
+}
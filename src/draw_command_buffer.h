@@ -0,0 +1,53 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef DRAW_COMMAND_BUFFER_H_
+#define DRAW_COMMAND_BUFFER_H_
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "frame_ring_buffer.h"
+#include "instance_buffer.h"
+
+// Layout GL reads from GL_DRAW_INDIRECT_BUFFER.
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// Draws of GeometryBuffer meshes, refilled every frame. A run of commands
+// goes out as one glMultiDrawElementsIndirect where supported, per command
+// data found through the base instance. Otherwise every command is a
+// glDrawElementsInstancedBaseVertex, with the instance attributes pointed
+// at its base instance first.
+class DrawCommandBuffer {
+ public:
+  DrawCommandBuffer();
+
+  // Once per frame, the indirect commands live in FrameRingBuffer.
+  void Upload(const std::vector<DrawElementsIndirectCommand>& commands);
+
+  // Commands [first, first + count), all of meshes in GeometryBuffer
+  // |page|, with the attributes of |instances|. Returns the number of draw
+  // calls made.
+  std::size_t Draw(const InstanceBuffer& instances, int page, std::size_t first, std::size_t count) const;
+
+  bool IsIndirect() const { return indirect_; }
+  // Only takes effect where glMultiDrawElementsIndirect is available.
+  void SetIndirect(bool indirect);
+
+ private:
+  FrameRingBuffer::Allocation allocation_;
+  bool indirect_;
+  // Whether this frame's commands made it into |allocation_|.
+  bool uploaded_;
+
+  // Read by the fallback.
+  std::vector<DrawElementsIndirectCommand> commands_;
+};
+
+#endif // DRAW_COMMAND_BUFFER_H_
@@ -0,0 +1,145 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "frame_ring_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "gl_extensions.h"
+
+FrameRingBuffer& FrameRingBuffer::Get() {
+  static FrameRingBuffer ring_buffer;
+  return ring_buffer;
+}
+
+FrameRingBuffer::FrameRingBuffer()
+    : persistent_(GLExtensions::has_buffer_storage) {
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  uniform_alignment_ = std::max<std::size_t>(alignment, 16);
+
+  stats_.persistent = persistent_;
+  CreateBuffer();
+}
+
+void FrameRingBuffer::BeginFrame() {
+  region_ = (region_ + 1) % kFrameCount;
+  region_offset_ = 0;
+
+  GLsync& fence = fences_[region_];
+  if (fence) {
+    // A fence which already signalled costs nothing; only time real waits.
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    double wait_ms = 0.0;
+    if (result == GL_TIMEOUT_EXPIRED) {
+      auto start = std::chrono::steady_clock::now();
+      do {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      } while (result == GL_TIMEOUT_EXPIRED);
+      wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      ++stats_.stalled_frames;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    stats_.wait_ms = wait_ms;
+    stats_.max_wait_ms = std::max(stats_.max_wait_ms, wait_ms);
+    stats_.total_wait_ms += wait_ms;
+  }
+
+  for (auto iter = retired_.begin(); iter != retired_.end();) {
+    if (--iter->frames_left <= 0) {
+      glDeleteBuffers(1, &iter->buffer);
+      iter = retired_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void FrameRingBuffer::EndFrame() {
+  fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  stats_.frame_bytes = region_offset_;
+  ++stats_.frames;
+}
+
+FrameRingBuffer::Allocation FrameRingBuffer::Allocate(std::size_t size, std::size_t alignment) {
+  std::size_t offset = (region_offset_ + alignment - 1) / alignment * alignment;
+  if (offset + size > region_bytes_) {
+    Grow(offset + size);
+    offset = 0;
+  }
+  region_offset_ = offset + size;
+
+  Allocation allocation;
+  allocation.buffer = buffer_;
+  allocation.offset = region_ * region_bytes_ + offset;
+  allocation.size = size;
+  if (persistent_) {
+    allocation.data = mapped_ + allocation.offset;
+  } else if (size > 0) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    allocation.data = glMapBufferRange(GL_COPY_WRITE_BUFFER, allocation.offset, size,
+                                       GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                                       GL_MAP_INVALIDATE_RANGE_BIT);
+  }
+  return allocation;
+}
+
+void FrameRingBuffer::Unmap(const Allocation& allocation) {
+  if (!persistent_ && allocation.data) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, allocation.buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+}
+
+void FrameRingBuffer::Clear() {
+  for (auto& fence : fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  for (auto& retired : retired_) {
+    glDeleteBuffers(1, &retired.buffer);
+  }
+  retired_.clear();
+  // Deleting unmaps too.
+  glDeleteBuffers(1, &buffer_);
+  buffer_ = 0;
+  mapped_ = nullptr;
+}
+
+void FrameRingBuffer::Grow(std::size_t min_region_bytes) {
+  // Draws already issued this frame still read the old buffer, and so may
+  // those of the frames in flight.
+  retired_.push_back({buffer_, kFrameCount});
+  while (region_bytes_ < min_region_bytes) {
+    region_bytes_ *= 2;
+  }
+
+  // The new buffer is idle, the fences of the old one don't apply.
+  for (auto& fence : fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+
+  CreateBuffer();
+  ++stats_.grows;
+}
+
+void FrameRingBuffer::CreateBuffer() {
+  std::size_t bytes = region_bytes_ * kFrameCount;
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  if (persistent_) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLExtensions::BufferStorage(GL_COPY_WRITE_BUFFER, bytes, nullptr, flags);
+    mapped_ = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, flags));
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+  }
+  stats_.region_bytes = region_bytes_;
+}
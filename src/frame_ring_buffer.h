@@ -0,0 +1,96 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef FRAME_RING_BUFFER_H_
+#define FRAME_RING_BUFFER_H_
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// Space for data written once a frame and read by that frame's draws, e.g.
+// instance transforms, draw commands and frame constants. One buffer is
+// split into kFrameCount regions used in turn. A fence set after a frame
+// guards its region, so the CPU only waits when it runs more than
+// kFrameCount - 1 frames ahead of the GPU, and never for the driver to
+// orphan or copy.
+//
+// With GL 4.4 or ARB_buffer_storage the buffer is created with
+// glBufferStorage and stays mapped, persistent and coherent. Otherwise
+// every allocation is mapped unsynchronised with glMapBufferRange, the
+// fences providing the synchronisation, and has to be unmapped before use.
+class FrameRingBuffer {
+ public:
+  static const int kFrameCount = 3;
+
+  struct Allocation {
+    void* data = nullptr;
+    GLuint buffer = 0;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+  };
+
+  struct Stats {
+    bool persistent = false;
+    std::size_t region_bytes = 0;
+    // Of the last frame.
+    std::size_t frame_bytes = 0;
+    double wait_ms = 0.0;
+    double max_wait_ms = 0.0;
+    double total_wait_ms = 0.0;
+    // Frames whose fence hadn't signalled yet.
+    std::size_t stalled_frames = 0;
+    std::size_t frames = 0;
+    std::size_t grows = 0;
+  };
+
+  static FrameRingBuffer& Get();
+
+  // Waits until the GPU is done with the region this frame reuses. Call
+  // before the first Allocate() of a frame.
+  void BeginFrame();
+  // Fences the frame's region. Call after its last draw.
+  void EndFrame();
+
+  // Write |size| bytes through |data|, then call Unmap() before drawing.
+  // Valid for this frame only.
+  Allocation Allocate(std::size_t size, std::size_t alignment = 16);
+  void Unmap(const Allocation& allocation);
+
+  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, for ranges bound as uniform blocks.
+  std::size_t GetUniformAlignment() const { return uniform_alignment_; }
+
+  // Deletes the buffer. Call before the context goes away.
+  void Clear();
+
+  Stats GetStats() const { return stats_; }
+
+ private:
+  static const std::size_t kInitialRegionBytes = 4 << 20;
+
+  FrameRingBuffer();
+
+  // Replaces the buffer with one of larger regions. The old one is deleted
+  // once the frames using it are done.
+  void Grow(std::size_t min_region_bytes);
+  void CreateBuffer();
+
+  GLuint buffer_ = 0;
+  char* mapped_ = nullptr;
+  bool persistent_;
+  std::size_t region_bytes_ = kInitialRegionBytes;
+  std::size_t uniform_alignment_ = 256;
+
+  int region_ = 0;
+  std::size_t region_offset_ = 0;
+  GLsync fences_[kFrameCount] = {};
+
+  struct RetiredBuffer {
+    GLuint buffer;
+    int frames_left;
+  };
+  std::vector<RetiredBuffer> retired_;
+
+  Stats stats_;
+};
+
+#endif // FRAME_RING_BUFFER_H_
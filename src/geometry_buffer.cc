@@ -0,0 +1,231 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "geometry_buffer.h"
+
+#include <algorithm>
+
+#include "gl_state_cache.h"
+#include "vertex.h"
+
+GeometryBuffer& GeometryBuffer::Get() {
+  static GeometryBuffer buffer;
+  return buffer;
+}
+
+void GeometryBuffer::SetPackedVertices(bool packed_vertices) {
+  packed_vertices_ = packed_vertices;
+  for (auto& page : pages_) {
+    if (page.buffer != 0) {
+      SetupVertexArray(page);
+    }
+  }
+}
+
+std::size_t GeometryBuffer::GetVertexSize() const {
+  return packed_vertices_ ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+GeometryBuffer::Handle GeometryBuffer::Allocate(const void* vertices, std::size_t vertex_count,
+                                                const GLuint* indices, std::size_t index_count) {
+  std::size_t vertex_bytes = vertex_count * GetVertexSize();
+  std::size_t bytes = vertex_bytes + index_count * sizeof(GLuint);
+  std::uint32_t units = (std::uint32_t)((bytes + kUnitBytes - 1) / kUnitBytes);
+
+  Slot slot;
+  slot.vertex_count = vertex_count;
+  slot.index_count = index_count;
+  slot.page = AllocateInPages(units, -1, &slot.allocation);
+  if (slot.page < 0) {
+    slot.page = AddPage(std::max(kPageBytes, units * kUnitBytes));
+    slot.allocation = pages_[slot.page].allocator->Allocate(units);
+  }
+
+  std::size_t offset = slot.allocation.offset * kUnitBytes;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, pages_[slot.page].buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, vertex_bytes, vertices);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset + vertex_bytes, index_count * sizeof(GLuint), indices);
+
+  Handle handle;
+  if (!free_slots_.empty()) {
+    handle = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[handle] = slot;
+  } else {
+    handle = (Handle)slots_.size();
+    slots_.push_back(slot);
+  }
+  return handle;
+}
+
+void GeometryBuffer::Free(Handle handle) {
+  if (handle == kInvalidHandle || slots_[handle].page < 0) {
+    return;
+  }
+  pages_[slots_[handle].page].allocator->Free(slots_[handle].allocation);
+  slots_[handle] = Slot();
+  free_slots_.push_back(handle);
+}
+
+GeometryBuffer::Range GeometryBuffer::GetRange(Handle handle) const {
+  Range range;
+  if (handle == kInvalidHandle) {
+    return range;
+  }
+  // Vertex offsets are multiples of the vertex size, see kUnitBytes.
+  const Slot& slot = slots_[handle];
+  std::size_t offset = slot.allocation.offset * kUnitBytes;
+  range.page = slot.page;
+  range.base_vertex = (GLint)(offset / GetVertexSize());
+  range.first_index = (GLuint)((offset + slot.vertex_count * GetVertexSize()) / sizeof(GLuint));
+  return range;
+}
+
+void GeometryBuffer::Bind(int page) const {
+  GLStateCache::Get().BindVertexArray(pages_[page].vao);
+}
+
+void GeometryBuffer::Update() {
+  int sparse_page = -1;
+  float sparse_occupancy = kCompactOccupancy;
+  std::size_t free_units = 0, sparse_used_units = 0;
+  for (std::size_t i = 0; i < pages_.size(); ++i) {
+    if (pages_[i].buffer == 0) {
+      continue;
+    }
+    auto stats = pages_[i].allocator->GetStats();
+    free_units += stats.size - stats.used;
+    float occupancy = (float)stats.used / (float)stats.size;
+    if (occupancy < sparse_occupancy) {
+      sparse_page = (int)i;
+      sparse_occupancy = occupancy;
+      sparse_used_units = stats.used;
+    }
+  }
+  if (sparse_page < 0) {
+    return;
+  }
+  // Only when the other pages keep a page worth of space free afterwards,
+  // else the next allocations add a page right back.
+  std::size_t sparse_free_units = pages_[sparse_page].bytes / kUnitBytes - sparse_used_units;
+  if (free_units < sparse_free_units + sparse_used_units + kPageBytes / kUnitBytes) {
+    return;
+  }
+
+  std::size_t moved_bytes = 0;
+  for (auto& slot : slots_) {
+    if (slot.page != sparse_page) {
+      continue;
+    }
+    if (moved_bytes >= kCompactBytesPerFrame) {
+      return;
+    }
+
+    std::uint32_t units = pages_[sparse_page].allocator->GetAllocationSize(slot.allocation);
+    OffsetAllocator::Allocation allocation;
+    int page = AllocateInPages(units, sparse_page, &allocation);
+    if (page < 0) {
+      return;
+    }
+
+    std::size_t bytes = units * kUnitBytes;
+    glBindBuffer(GL_COPY_READ_BUFFER, pages_[sparse_page].buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pages_[page].buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slot.allocation.offset * kUnitBytes,
+                        allocation.offset * kUnitBytes, bytes);
+    pages_[sparse_page].allocator->Free(slot.allocation);
+    slot.page = page;
+    slot.allocation = allocation;
+    moved_bytes += bytes;
+    moved_bytes_ += bytes;
+  }
+
+  ReleasePage(sparse_page);
+}
+
+void GeometryBuffer::Clear() {
+  for (std::size_t i = 0; i < pages_.size(); ++i) {
+    if (pages_[i].buffer != 0) {
+      ReleasePage((int)i);
+    }
+  }
+  pages_.clear();
+  slots_.clear();
+  free_slots_.clear();
+}
+
+GeometryBuffer::Stats GeometryBuffer::GetStats() const {
+  Stats stats;
+  for (auto& page : pages_) {
+    if (page.buffer == 0) {
+      continue;
+    }
+    auto page_stats = page.allocator->GetStats();
+    ++stats.pages;
+    stats.capacity_bytes += page.bytes;
+    stats.used_bytes += page_stats.used * kUnitBytes;
+    stats.allocations += page_stats.allocations;
+    stats.free_ranges += page_stats.free_ranges;
+    stats.fragmentation = std::max(stats.fragmentation, page_stats.GetFragmentation());
+  }
+  stats.pages_added = pages_added_;
+  stats.pages_released = pages_released_;
+  stats.moved_bytes = moved_bytes_;
+  return stats;
+}
+
+int GeometryBuffer::AllocateInPages(std::uint32_t units, int exclude, OffsetAllocator::Allocation* allocation) {
+  for (std::size_t i = 0; i < pages_.size(); ++i) {
+    if (pages_[i].buffer == 0 || (int)i == exclude) {
+      continue;
+    }
+    *allocation = pages_[i].allocator->Allocate(units);
+    if (allocation->IsValid()) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+int GeometryBuffer::AddPage(std::size_t bytes) {
+  std::size_t index = 0;
+  while (index < pages_.size() && pages_[index].buffer != 0) {
+    ++index;
+  }
+  if (index == pages_.size()) {
+    pages_.emplace_back();
+  }
+
+  Page& page = pages_[index];
+  page.bytes = bytes;
+  page.allocator = std::make_unique<OffsetAllocator>((std::uint32_t)(bytes / kUnitBytes));
+  glGenBuffers(1, &page.buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+  glGenVertexArrays(1, &page.vao);
+  SetupVertexArray(page);
+
+  ++pages_added_;
+  return (int)index;
+}
+
+void GeometryBuffer::ReleasePage(int index) {
+  Page& page = pages_[index];
+  GLStateCache::Get().OnVertexArrayDeleted(page.vao);
+  glDeleteVertexArrays(1, &page.vao);
+  glDeleteBuffers(1, &page.buffer);
+  page = Page();
+  ++pages_released_;
+}
+
+void GeometryBuffer::SetupVertexArray(const Page& page) {
+  // Vertices and indices come from the same buffer.
+  GLStateCache::Get().BindVertexArray(page.vao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, page.buffer);
+  if (packed_vertices_) {
+    SetupVertexAttributes<PackedVertex>();
+  } else {
+    SetupVertexAttributes<Vertex>();
+  }
+  GLStateCache::Get().BindVertexArray(0);
+}
@@ -0,0 +1,113 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef GEOMETRY_BUFFER_H_
+#define GEOMETRY_BUFFER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "offset_allocator.h"
+
+// Vertices and indices of every Mesh, sub-allocated from a few large GL
+// buffers (pages) with an OffsetAllocator each. A mesh's vertices and
+// indices share one range, so every page needs only one VAO and draws of
+// meshes in the same page differ only in base vertex and first index.
+// Pages are added when full. Update() empties sparse pages a bit at a time,
+// moving ranges with glCopyBufferSubData, and releases them. Ranges are
+// reached through handles, which stay valid when they move.
+class GeometryBuffer {
+ public:
+  using Handle = std::uint32_t;
+  static constexpr Handle kInvalidHandle = 0xFFFFFFFF;
+
+  struct Range {
+    int page = -1;
+    GLint base_vertex = 0;
+    GLuint first_index = 0;
+  };
+
+  struct Stats {
+    std::size_t pages = 0;
+    std::size_t capacity_bytes = 0;
+    std::size_t used_bytes = 0;
+    std::size_t allocations = 0;
+    std::size_t free_ranges = 0;
+    // Of the page with the most split free space.
+    float fragmentation = 0.0f;
+    std::size_t pages_added = 0;
+    std::size_t pages_released = 0;
+    std::size_t moved_bytes = 0;
+  };
+
+  static GeometryBuffer& Get();
+
+  // PackedVertex or Vertex. Ranges written in the old format have to be
+  // allocated again.
+  bool IsPackedVertices() const { return packed_vertices_; }
+  void SetPackedVertices(bool packed_vertices);
+  std::size_t GetVertexSize() const;
+
+  // Copies |vertex_count| vertices of the current format, followed by the
+  // indices, into a new range.
+  Handle Allocate(const void* vertices, std::size_t vertex_count, const GLuint* indices, std::size_t index_count);
+  void Free(Handle handle);
+
+  Range GetRange(Handle handle) const;
+
+  void Bind(int page) const;
+
+  // Moves up to kCompactBytesPerFrame out of the emptiest sparse page into
+  // the others, and releases pages left empty. Call once a frame, before
+  // draw commands are built.
+  void Update();
+
+  // Deletes the pages. Call before the context goes away.
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  static constexpr std::size_t kPageBytes = 16 << 20;
+  // Allocation unit, a multiple of both vertex sizes.
+  static constexpr std::size_t kUnitBytes = 32;
+  static constexpr std::size_t kCompactBytesPerFrame = 4 << 20;
+  // Pages used less than this are emptied into the others.
+  static constexpr float kCompactOccupancy = 0.5f;
+
+  struct Page {
+    GLuint buffer = 0;
+    GLuint vao = 0;
+    std::size_t bytes = 0;
+    std::unique_ptr<OffsetAllocator> allocator;
+  };
+
+  struct Slot {
+    int page = -1;
+    OffsetAllocator::Allocation allocation;
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+  };
+
+  GeometryBuffer() = default;
+
+  // Returns -1 when no page other than |exclude| has room.
+  int AllocateInPages(std::uint32_t units, int exclude, OffsetAllocator::Allocation* allocation);
+  int AddPage(std::size_t bytes);
+  void ReleasePage(int page);
+  void SetupVertexArray(const Page& page);
+
+  std::vector<Page> pages_;
+  std::vector<Slot> slots_;
+  std::vector<Handle> free_slots_;
+
+  bool packed_vertices_ = true;
+
+  std::size_t pages_added_ = 0;
+  std::size_t pages_released_ = 0;
+  std::size_t moved_bytes_ = 0;
+};
+
+#endif // GEOMETRY_BUFFER_H_
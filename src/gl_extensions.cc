@@ -0,0 +1,101 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "gl_extensions.h"
+
+bool GLExtensions::has_program_binary = false;
+PFNGLGETPROGRAMBINARYPROC GLExtensions::GetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC GLExtensions::ProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC GLExtensions::ProgramParameteri = nullptr;
+bool GLExtensions::has_parallel_shader_compile = false;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC GLExtensions::MaxShaderCompilerThreads = nullptr;
+bool GLExtensions::has_texture_compression_s3tc = false;
+bool GLExtensions::has_texture_compression_s3tc_srgb = false;
+bool GLExtensions::has_texture_compression_bptc = false;
+bool GLExtensions::has_texture_storage = false;
+PFNGLTEXSTORAGE2DPROC GLExtensions::TexStorage2D = nullptr;
+bool GLExtensions::has_copy_image = false;
+PFNGLCOPYIMAGESUBDATAPROC GLExtensions::CopyImageSubData = nullptr;
+bool GLExtensions::has_bindless_texture = false;
+PFNGLGETTEXTUREHANDLEARBPROC GLExtensions::GetTextureHandle = nullptr;
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC GLExtensions::MakeTextureHandleResident = nullptr;
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC GLExtensions::MakeTextureHandleNonResident = nullptr;
+bool GLExtensions::has_buffer_storage = false;
+PFNGLBUFFERSTORAGEPROC GLExtensions::BufferStorage = nullptr;
+bool GLExtensions::has_multi_draw_indirect = false;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC GLExtensions::MultiDrawElementsIndirect = nullptr;
+
+int GLExtensions::major_version_ = 0;
+int GLExtensions::minor_version_ = 0;
+std::set<std::string> GLExtensions::extensions_;
+
+void GLExtensions::Load(GLADloadproc load) {
+  glGetIntegerv(GL_MAJOR_VERSION, &major_version_);
+  glGetIntegerv(GL_MINOR_VERSION, &minor_version_);
+
+  GLint extension_count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+  for (GLint i = 0; i < extension_count; ++i) {
+    extensions_.insert(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+  }
+
+  if (IsVersionAtLeast(4, 1) || HasExtension("GL_ARB_get_program_binary")) {
+    GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+    ProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+    ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    has_program_binary = GetProgramBinary && ProgramBinary && ProgramParameteri && format_count > 0;
+  }
+
+  if (HasExtension("GL_KHR_parallel_shader_compile")) {
+    MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+  } else if (HasExtension("GL_ARB_parallel_shader_compile")) {
+    MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+  }
+  has_parallel_shader_compile = MaxShaderCompilerThreads != nullptr;
+  if (has_parallel_shader_compile) {
+    // Let the driver pick the number of compiler threads.
+    MaxShaderCompilerThreads(0xFFFFFFFF);
+  }
+
+  has_texture_compression_s3tc = HasExtension("GL_EXT_texture_compression_s3tc");
+  has_texture_compression_s3tc_srgb = has_texture_compression_s3tc && HasExtension("GL_EXT_texture_sRGB");
+  has_texture_compression_bptc = IsVersionAtLeast(4, 2) || HasExtension("GL_ARB_texture_compression_bptc");
+
+  if (IsVersionAtLeast(4, 2) || HasExtension("GL_ARB_texture_storage")) {
+    TexStorage2D = (PFNGLTEXSTORAGE2DPROC)load("glTexStorage2D");
+  }
+  has_texture_storage = TexStorage2D != nullptr;
+
+  if (IsVersionAtLeast(4, 3) || HasExtension("GL_ARB_copy_image")) {
+    CopyImageSubData = (PFNGLCOPYIMAGESUBDATAPROC)load("glCopyImageSubData");
+  }
+  has_copy_image = CopyImageSubData != nullptr;
+
+  if (HasExtension("GL_ARB_bindless_texture")) {
+    GetTextureHandle = (PFNGLGETTEXTUREHANDLEARBPROC)load("glGetTextureHandleARB");
+    MakeTextureHandleResident = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)load("glMakeTextureHandleResidentARB");
+    MakeTextureHandleNonResident = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)load("glMakeTextureHandleNonResidentARB");
+  }
+  has_bindless_texture = GetTextureHandle && MakeTextureHandleResident && MakeTextureHandleNonResident;
+
+  if (IsVersionAtLeast(4, 4) || HasExtension("GL_ARB_buffer_storage")) {
+    BufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+  }
+  has_buffer_storage = BufferStorage != nullptr;
+
+  if (IsVersionAtLeast(4, 3) ||
+      (HasExtension("GL_ARB_multi_draw_indirect") && HasExtension("GL_ARB_base_instance"))) {
+    MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+  }
+  has_multi_draw_indirect = MultiDrawElementsIndirect != nullptr;
+}
+
+bool GLExtensions::HasExtension(const std::string& name) {
+  return extensions_.count(name) > 0;
+}
+
+bool GLExtensions::IsVersionAtLeast(int major, int minor) {
+  return major_version_ > major || (major_version_ == major && minor_version_ >= minor);
+}
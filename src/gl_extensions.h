@@ -0,0 +1,128 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef GL_EXTENSIONS_H_
+#define GL_EXTENSIONS_H_
+
+#include <set>
+#include <string>
+
+#include <glad/glad.h>
+
+// Entry points and enums newer than the GL 3.3 core loader generated by glad.
+// They are loaded at start-up and stay null when the driver lacks them, so
+// check the matching flag before use.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei buf_size, GLsizei* length,
+                                                   GLenum* binary_format, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binary_format,
+                                                const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+typedef void (APIENTRYP PFNGLCOPYIMAGESUBDATAPROC)(GLuint src_name, GLenum src_target, GLint src_level,
+                                                   GLint src_x, GLint src_y, GLint src_z,
+                                                   GLuint dst_name, GLenum dst_target, GLint dst_level,
+                                                   GLint dst_x, GLint dst_y, GLint dst_z,
+                                                   GLsizei width, GLsizei height, GLsizei depth);
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internal_format,
+                                               GLsizei width, GLsizei height);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data,
+                                               GLbitfield flags);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect,
+                                                           GLsizei draw_count, GLsizei stride);
+
+class GLExtensions {
+ public:
+  // Call once after gladLoadGLLoader(), with the same loader.
+  static void Load(GLADloadproc load);
+
+  static bool HasExtension(const std::string& name);
+
+  static bool IsVersionAtLeast(int major, int minor);
+
+  // GL 4.1 or ARB_get_program_binary, with at least one binary format.
+  static bool has_program_binary;
+  static PFNGLGETPROGRAMBINARYPROC GetProgramBinary;
+  static PFNGLPROGRAMBINARYPROC ProgramBinary;
+  static PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+
+  // KHR_parallel_shader_compile or its ARB twin: compiles run on driver
+  // threads and GL_COMPLETION_STATUS_KHR can be polled without blocking.
+  static bool has_parallel_shader_compile;
+  static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads;
+
+  // EXT_texture_compression_s3tc (BC1-BC3), with sRGB variants when
+  // EXT_texture_sRGB is present too.
+  static bool has_texture_compression_s3tc;
+  static bool has_texture_compression_s3tc_srgb;
+
+  // GL 4.2 or ARB_texture_compression_bptc (BC7).
+  static bool has_texture_compression_bptc;
+
+  // GL 4.2 or ARB_texture_storage: immutable texture storage.
+  static bool has_texture_storage;
+  static PFNGLTEXSTORAGE2DPROC TexStorage2D;
+
+  // GL 4.3 or ARB_copy_image: texel copies between textures on the GPU.
+  static bool has_copy_image;
+  static PFNGLCOPYIMAGESUBDATAPROC CopyImageSubData;
+
+  // ARB_bindless_texture: 64-bit handles sampled without binding.
+  static bool has_bindless_texture;
+  static PFNGLGETTEXTUREHANDLEARBPROC GetTextureHandle;
+  static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC MakeTextureHandleResident;
+  static PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC MakeTextureHandleNonResident;
+
+  // GL 4.4 or ARB_buffer_storage: immutable buffers, which may stay
+  // mapped while the GPU reads them.
+  static bool has_buffer_storage;
+  static PFNGLBUFFERSTORAGEPROC BufferStorage;
+
+  // GL 4.3, or ARB_multi_draw_indirect with ARB_base_instance: indexed
+  // draws read from a GL_DRAW_INDIRECT_BUFFER, base instance included.
+  static bool has_multi_draw_indirect;
+  static PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+
+ private:
+  static int major_version_;
+  static int minor_version_;
+  static std::set<std::string> extensions_;
+};
+
+#endif // GL_EXTENSIONS_H_
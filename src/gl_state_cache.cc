@@ -0,0 +1,186 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "gl_state_cache.h"
+
+#include <iostream>
+
+template <typename T>
+bool GLStateCache::Update(T& cached, T value) {
+  if (cached == value) {
+    ++frame_stats_.redundant;
+    return false;
+  }
+
+  cached = value;
+  ++frame_stats_.issued;
+  return true;
+}
+
+GLStateCache& GLStateCache::Get() {
+  static GLStateCache cache;
+  return cache;
+}
+
+GLStateCache::GLStateCache() {
+  Invalidate();
+}
+
+void GLStateCache::UseProgram(GLuint program) {
+  if (Update(program_, program)) {
+    glUseProgram(program);
+  }
+}
+
+void GLStateCache::BindVertexArray(GLuint vao) {
+  if (Update(vao_, vao)) {
+    glBindVertexArray(vao);
+  }
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+  if (unit >= textures_.size()) {
+    textures_.resize(unit + 1);
+  }
+
+  auto& binding = textures_[unit];
+  if (binding.target == target && binding.texture == texture) {
+    ++frame_stats_.redundant;
+    return;
+  }
+
+  ActiveTexture(unit);
+  glBindTexture(target, texture);
+  binding.target = target;
+  binding.texture = texture;
+  ++frame_stats_.issued;
+}
+
+void GLStateCache::BindFramebuffer(GLuint fbo) {
+  if (Update(framebuffer_, fbo)) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  }
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (viewport_[0] == x && viewport_[1] == y && viewport_[2] == width && viewport_[3] == height) {
+    ++frame_stats_.redundant;
+    return;
+  }
+
+  glViewport(x, y, width, height);
+  viewport_[0] = x;
+  viewport_[1] = y;
+  viewport_[2] = width;
+  viewport_[3] = height;
+  ++frame_stats_.issued;
+}
+
+void GLStateCache::SetDepthTest(bool enable) {
+  if (Update(depth_test_, (GLint)enable)) {
+    if (enable) {
+      glEnable(GL_DEPTH_TEST);
+    } else {
+      glDisable(GL_DEPTH_TEST);
+    }
+  }
+}
+
+void GLStateCache::SetCullFace(bool enable, GLenum mode) {
+  if (Update(cull_face_, (GLint)enable)) {
+    if (enable) {
+      glEnable(GL_CULL_FACE);
+    } else {
+      glDisable(GL_CULL_FACE);
+    }
+  }
+  if (enable && Update(cull_mode_, mode)) {
+    glCullFace(mode);
+  }
+}
+
+void GLStateCache::SetRasterizerDiscard(bool enable) {
+  if (Update(rasterizer_discard_, (GLint)enable)) {
+    if (enable) {
+      glEnable(GL_RASTERIZER_DISCARD);
+    } else {
+      glDisable(GL_RASTERIZER_DISCARD);
+    }
+  }
+}
+
+void GLStateCache::OnProgramDeleted(GLuint program) {
+  // A program in use stays alive until it is unbound, but its name may come
+  // back once that happens.
+  if (program_ == program) {
+    program_ = kUnknown;
+  }
+}
+
+void GLStateCache::OnVertexArrayDeleted(GLuint vao) {
+  if (vao_ == vao) {
+    vao_ = 0;
+  }
+}
+
+void GLStateCache::OnTextureDeleted(GLuint texture) {
+  for (auto& binding : textures_) {
+    if (binding.texture == texture) {
+      binding.texture = 0;
+    }
+  }
+}
+
+void GLStateCache::OnFramebufferDeleted(GLuint fbo) {
+  if (framebuffer_ == fbo) {
+    framebuffer_ = 0;
+  }
+}
+
+void GLStateCache::Invalidate() {
+  program_ = kUnknown;
+  vao_ = kUnknown;
+  active_unit_ = kUnknown;
+  textures_.clear();
+  framebuffer_ = kUnknown;
+  viewport_[0] = viewport_[1] = viewport_[2] = viewport_[3] = -1;
+  depth_test_ = -1;
+  cull_face_ = -1;
+  cull_mode_ = kUnknown;
+  rasterizer_discard_ = -1;
+}
+
+GLuint GLStateCache::AllocateTextureUnit() {
+  if (allocated_units_.empty()) {
+    GLint unit_count = 0;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &unit_count);
+    allocated_units_.assign(unit_count, false);
+    allocated_units_[kScratchTextureUnit] = true;
+  }
+
+  for (GLuint unit = 0; unit < allocated_units_.size(); ++unit) {
+    if (!allocated_units_[unit]) {
+      allocated_units_[unit] = true;
+      return unit;
+    }
+  }
+
+  std::cout << "DongZhong: " << "Out of texture units" << std::endl;
+  return kScratchTextureUnit;
+}
+
+void GLStateCache::ReleaseTextureUnit(GLuint unit) {
+  if (unit != kScratchTextureUnit && unit < allocated_units_.size()) {
+    allocated_units_[unit] = false;
+  }
+}
+
+void GLStateCache::ResetFrameStats() {
+  frame_stats_ = Stats();
+}
+
+void GLStateCache::ActiveTexture(GLuint unit) {
+  if (active_unit_ != unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    active_unit_ = unit;
+  }
+}
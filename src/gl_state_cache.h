@@ -0,0 +1,93 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef GL_STATE_CACHE_H_
+#define GL_STATE_CACHE_H_
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// Shadows the bits of GL state we change every frame and drops calls which
+// wouldn't change anything. All modules bind programs, vertex arrays,
+// textures and framebuffers through here so the shadow stays in sync.
+class GLStateCache {
+ public:
+  struct Stats {
+    std::size_t issued = 0;
+    std::size_t redundant = 0;
+  };
+
+  // Reserved for binding textures while creating or uploading them, never
+  // handed out by AllocateTextureUnit().
+  static const GLuint kScratchTextureUnit = 0;
+
+  static GLStateCache& Get();
+
+  void UseProgram(GLuint program);
+
+  void BindVertexArray(GLuint vao);
+
+  void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+  void BindFramebuffer(GLuint fbo);
+
+  void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+  void SetDepthTest(bool enable);
+
+  void SetCullFace(bool enable, GLenum mode = GL_BACK);
+
+  void SetRasterizerDiscard(bool enable);
+
+  // Deleting a bound object resets its binding to 0 behind our back, and the
+  // name may be reused right away.
+  void OnProgramDeleted(GLuint program);
+  void OnVertexArrayDeleted(GLuint vao);
+  void OnTextureDeleted(GLuint texture);
+  void OnFramebufferDeleted(GLuint fbo);
+
+  // Forgets all shadowed state, e.g. after foreign code touched it.
+  void Invalidate();
+
+  // Texture units are handed out for the lifetime of their owner, so
+  // samplers of different systems never share one.
+  GLuint AllocateTextureUnit();
+  void ReleaseTextureUnit(GLuint unit);
+
+  Stats GetFrameStats() const { return frame_stats_; }
+  void ResetFrameStats();
+
+ private:
+  // Matches no real GL value, so the first call always goes through.
+  static const GLuint kUnknown = 0xFFFFFFFF;
+
+  struct TextureBinding {
+    GLenum target = kUnknown;
+    GLuint texture = kUnknown;
+  };
+
+  GLStateCache();
+
+  // Counts the call and returns true when |cached| has to change to |value|.
+  template <typename T>
+  bool Update(T& cached, T value);
+
+  void ActiveTexture(GLuint unit);
+
+  GLuint program_;
+  GLuint vao_;
+  GLuint active_unit_;
+  std::vector<TextureBinding> textures_;
+  GLuint framebuffer_;
+  GLint viewport_[4];
+  GLint depth_test_;
+  GLint cull_face_;
+  GLenum cull_mode_;
+  GLint rasterizer_discard_;
+
+  std::vector<bool> allocated_units_;
+
+  Stats frame_stats_;
+};
+
+#endif // GL_STATE_CACHE_H_
@@ -2,8 +2,17 @@
 
 #include "global_controller.h"
 
+#include <cstring>
+
 #include <imgui.h>
 
+#include "frame_ring_buffer.h"
+#include "gl_state_cache.h"
+#include "shader_library.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "texture_streamer.h"
+
 GlobalController::GlobalController()
     : screen_size_(glm::vec2(1280, 720)),
       clear_color_(glm::vec4(0.1f, 0.1f, 0.1f, 1.0f)),
@@ -11,8 +20,10 @@ GlobalController::GlobalController()
       shadow_enabled_(true),
       displaying_shadow_map_(shadow_enabled_),
       is_drawing_coords_(true),
-      camera_(std::make_shared<Camera>(glm::vec3(0.2f, 0.3f, 3.0f))) {
-  coords_shader_ = std::make_shared<Shader>("vertex_shader.vs", "coords_fragment_shader.fs");
+      camera_(std::make_shared<Camera>(glm::vec3(0.2f, 0.3f, 3.0f))),
+      frame_index_(0) {
+  coords_shader_ = ShaderLibrary::Get().GetShader("vertex_shader.vs", "coords_fragment_shader.fs");
+  coords_model_uniform_ = coords_shader_->GetUniform("model");
   GenerateCoordVAO();
 }
 
@@ -40,6 +51,17 @@ glm::mat4 GlobalController::GetViewMatrix() const {
   return camera_->GetViewMatrix();
 }
 
+glm::mat4 GlobalController::GetProjectionMatrix() const {
+  return glm::perspective(glm::radians(45.0f), (float)screen_size_.x / screen_size_.y, 0.1f, 100.0f);
+}
+
+ShaderDefines GlobalController::GetShaderDefines() const {
+  return {
+    {"GAMMA_ENABLE", gamma_enabled_ ? "true" : "false"},
+    {"SHADOW_ENABLE", shadow_enabled_ ? "true" : "false"},
+  };
+}
+
 void GlobalController::CameraMove(Camera::Direction direction, float delta_time) {
   camera_->Move(direction, delta_time);
 }
@@ -76,35 +98,114 @@ void GlobalController::Config() {
               1000.0f / ImGui::GetIO().Framerate,
               ImGui::GetIO().Framerate);
 
+  ImGui::Text("Uniform lookups avoided: %zu", Shader::GetAvoidedLookupCount());
+
+  auto upload_stats = Shader::GetFrameUploadStats();
+  ImGui::Text("Uniform uploads per frame: %zu issued, %zu skipped",
+              upload_stats.issued, upload_stats.skipped);
+
+  auto state_stats = GLStateCache::Get().GetFrameStats();
+  ImGui::Text("GL state changes per frame: %zu issued, %zu redundant",
+              state_stats.issued, state_stats.redundant);
+
+  auto build_stats = Shader::GetBuildStats();
+  ImGui::Text("Programs compiled: %zu (%.1f ms), cached: %zu (%.1f ms)",
+              build_stats.compiled, build_stats.compile_ms,
+              build_stats.cache_hits, build_stats.cache_ms);
+  ImGui::Text("Shader reloads: %zu, failed: %zu", build_stats.reloaded, build_stats.reload_failed);
+
+  auto& texture_cache = TextureCache::Get();
+  ImGui::Text("Textures: %zu resident (%.1f MB), hit rate %.0f%%",
+              texture_cache.GetResidentCount(),
+              texture_cache.GetResidentBytes() / (1024.0f * 1024.0f),
+              texture_cache.GetHitRate() * 100.0f);
+  if (ImGui::Button("Evict unused textures")) {
+    texture_cache.EvictUnused();
+  }
+
+  const char* load_labels[2] = {"Decoded", "Compressed"};
+  for (bool compressed : {false, true}) {
+    auto load_stats = Texture::GetLoadStats(compressed);
+    ImGui::Text("%s textures: %zu, decode %.1f ms, mips %.1f ms, upload %.1f ms, %.2f MB",
+                load_labels[compressed], load_stats.loaded, load_stats.decode_ms, load_stats.mip_ms,
+                load_stats.upload_ms, load_stats.gpu_bytes / (1024.0f * 1024.0f));
+  }
+
+  auto& texture_loader = TextureLoader::Get();
+  ImGui::Text("Textures loading: %zu, mip chains cached: %zu, uploaded this frame: %.1f KB",
+              texture_loader.GetPendingCount(),
+              texture_loader.GetStats().mip_cache_hits,
+              texture_loader.GetStats().frame_upload_bytes / 1024.0f);
+  int upload_budget_kb = (int)(texture_loader.GetUploadBudget() / 1024);
+  if (ImGui::SliderInt("Upload budget (KB/frame)", &upload_budget_kb, 64, 16384)) {
+    texture_loader.SetUploadBudget((std::size_t)upload_budget_kb * 1024);
+  }
+
+  auto& texture_streamer = TextureStreamer::Get();
+  auto stream_stats = texture_streamer.GetStats();
+  bool streaming = texture_streamer.IsEnabled();
+  if (ImGui::Checkbox("Stream texture mips", &streaming)) {
+    texture_streamer.SetEnabled(streaming);
+  }
+  ImGui::Text("Streamed textures: %zu, %zu levels pending",
+              stream_stats.textures, stream_stats.pending);
+  ImGui::Text("Resident %.2f MB, requested %.2f MB, evicted %.2f MB",
+              stream_stats.resident_bytes / (1024.0f * 1024.0f),
+              stream_stats.requested_bytes / (1024.0f * 1024.0f),
+              stream_stats.evicted_bytes / (1024.0f * 1024.0f));
+  int stream_budget_mb = (int)(texture_streamer.GetBudget() / (1024 * 1024));
+  if (ImGui::SliderInt("Streaming budget (MB)", &stream_budget_mb, 1, 1024)) {
+    texture_streamer.SetBudget((std::size_t)stream_budget_mb * 1024 * 1024);
+  }
+
+  auto ring_stats = FrameRingBuffer::Get().GetStats();
+  ImGui::Text("Frame ring buffer: %s, %d x %.1f MB, %.1f KB last frame, grown %zu times",
+              ring_stats.persistent ? "persistent" : "unsynchronised maps", FrameRingBuffer::kFrameCount,
+              ring_stats.region_bytes / (1024.0f * 1024.0f), ring_stats.frame_bytes / 1024.0f, ring_stats.grows);
+  ImGui::Text("Fence waits: %zu of %zu frames, last %.3f ms, max %.3f ms, total %.1f ms",
+              ring_stats.stalled_frames, ring_stats.frames, ring_stats.wait_ms, ring_stats.max_wait_ms,
+              ring_stats.total_wait_ms);
+
   ImGui::End();
   ImGui::PopID();
 }
 
+void GlobalController::UpdateFrameConstants() {
+  FrameConstants constants = {};
+  constants.view = GetViewMatrix();
+  constants.project = GetProjectionMatrix();
+  constants.view_project = constants.project * constants.view;
+  constants.view_position = glm::vec4(camera_->GetPosition(), 1.0f);
+  constants.frame_index = (GLint)frame_index_;
+
+  auto& ring_buffer = FrameRingBuffer::Get();
+  auto allocation = ring_buffer.Allocate(sizeof(FrameConstants), ring_buffer.GetUniformAlignment());
+  std::memcpy(allocation.data, &constants, sizeof(FrameConstants));
+  ring_buffer.Unmap(allocation);
+  glBindBufferRange(GL_UNIFORM_BUFFER, (GLuint)Shader::UniformBlock::kFrameConstants, allocation.buffer,
+                    allocation.offset, sizeof(FrameConstants));
+
+  ++frame_index_;
+}
+
 void GlobalController::RenderCoords() {
   if (!is_drawing_coords_) {
     return;
   }
 
-  glBindVertexArray(coords_vao_);
+  GLStateCache::Get().BindVertexArray(coords_vao_);
 
   coords_shader_->Use();
 
   glm::mat4 model(1.0f);
-  coords_shader_->SetMat4("model", model);
-
-  coords_shader_->SetMat4("view", camera_->GetViewMatrix());
-  coords_shader_->SetMat4("project", glm::perspective(glm::radians(45.0f),
-                                                      (float)screen_size_.x / screen_size_.y,
-                                                      0.1f, 100.0f));
+  coords_shader_->SetMat4(coords_model_uniform_, model);
 
   glDrawArrays(GL_LINES, 0, 6);
-
-  glBindVertexArray(0);
 }
 
 void GlobalController::GenerateCoordVAO() {
   glGenVertexArrays(1, &coords_vao_);
-  glBindVertexArray(coords_vao_);
+  GLStateCache::Get().BindVertexArray(coords_vao_);
 
   static GLfloat coord_vertices[] = {
     -100.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
@@ -126,5 +227,5 @@ void GlobalController::GenerateCoordVAO() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
   glEnableVertexAttribArray(2);
 
-  glBindVertexArray(0);
+  GLStateCache::Get().BindVertexArray(0);
 }
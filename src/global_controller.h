@@ -13,7 +13,6 @@
 class GlobalController {
  public:
   GlobalController();
-  ~GlobalController() = default;
 
   glm::vec2 GetScreenSize() const { return screen_size_; }
   void SetScreenSize(const glm::vec2& size);
@@ -32,6 +31,11 @@ class GlobalController {
 
   glm::mat4 GetViewMatrix() const;
 
+  glm::mat4 GetProjectionMatrix() const;
+
+  // Gamma and shadow switches for specialised shader variants.
+  ShaderDefines GetShaderDefines() const;
+
   void CameraMove(Camera::Direction direction, float delta_time);
 
   void CameraRotate(Camera::Rotation rotation, float delta_time);
@@ -42,9 +46,28 @@ class GlobalController {
 
   void Config();
 
+  // Fills the "FrameConstants" uniform block shared by all programs. Called
+  // once at the start of every frame.
+  void UpdateFrameConstants();
+
+  std::size_t GetFrameIndex() const { return frame_index_; }
+
   void RenderCoords();
 
  private:
+  // std140 mirror of the FrameConstants block in the vertex and fragment
+  // shaders.
+  struct FrameConstants {
+    glm::mat4 view;
+    glm::mat4 project;
+    glm::mat4 view_project;
+    glm::vec4 view_position;
+    GLint frame_index;
+    GLint padding[3];
+  };
+
+  static_assert(sizeof(FrameConstants) == 224, "FrameConstants must match std140 layout");
+
   void GenerateCoordVAO();
 
   glm::vec2 screen_size_;
@@ -57,10 +80,13 @@ class GlobalController {
 
   bool is_drawing_coords_;
   std::shared_ptr<Shader> coords_shader_;
+  Shader::Uniform coords_model_uniform_;
   GLuint coords_vao_;
   GLuint coords_vbo_;
 
   std::shared_ptr<Camera> camera_;
+
+  std::size_t frame_index_;
 };
 
 #endif // GLOBAL_CONTROLLER_H_
@@ -0,0 +1,36 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "gpu_timer.h"
+
+GpuTimer::GpuTimer()
+    : issued_(),
+      current_(0),
+      elapsed_ms_(0.0f) {
+  glGenQueries(kQueryCount, queries_);
+}
+
+GpuTimer::~GpuTimer() {
+  glDeleteQueries(kQueryCount, queries_);
+}
+
+void GpuTimer::Begin() {
+  // The query about to be reused was issued kQueryCount frames ago, pick up
+  // its result if the GPU got there.
+  if (issued_[current_]) {
+    GLint available = 0;
+    glGetQueryObjectiv(queries_[current_], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+      GLuint64 elapsed_ns = 0;
+      glGetQueryObjectui64v(queries_[current_], GL_QUERY_RESULT, &elapsed_ns);
+      elapsed_ms_ = (float)(elapsed_ns / 1.0e6);
+    }
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, queries_[current_]);
+}
+
+void GpuTimer::End() {
+  glEndQuery(GL_TIME_ELAPSED);
+  issued_[current_] = true;
+  current_ = (current_ + 1) % kQueryCount;
+}
@@ -0,0 +1,31 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef GPU_TIMER_H_
+#define GPU_TIMER_H_
+
+#include <glad/glad.h>
+
+// Measures GPU time between Begin() and End() with GL_TIME_ELAPSED queries.
+// Results are read a few frames later so the CPU never waits on the GPU.
+class GpuTimer {
+ public:
+  GpuTimer();
+  ~GpuTimer();
+
+  void Begin();
+  void End();
+
+  // Latest finished measurement, in milliseconds.
+  float GetElapsedMs() const { return elapsed_ms_; }
+
+ private:
+  static const int kQueryCount = 3;
+
+  GLuint queries_[kQueryCount];
+  bool issued_[kQueryCount];
+  int current_;
+
+  float elapsed_ms_;
+};
+
+#endif // GPU_TIMER_H_
@@ -0,0 +1,28 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// FNV-1a, 64 bit. Fast and good enough for cache keys and file names, not
+// for anything adversarial. Pass the previous result as |hash| to hash
+// several buffers as one.
+constexpr std::uint64_t kHashSeed = 14695981039346656037ull;
+
+inline std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t hash = kHashSeed) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+inline std::uint64_t HashString(const std::string& value, std::uint64_t hash = kHashSeed) {
+  return HashBytes(value.data(), value.size(), hash);
+}
+
+#endif // HASH_H_
@@ -0,0 +1,19 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "instance_buffer.h"
+
+#include <cstring>
+
+void InstanceBuffer::Upload(const std::vector<InstanceData>& instances) {
+  auto& ring_buffer = FrameRingBuffer::Get();
+  allocation_ = ring_buffer.Allocate(instances.size() * sizeof(InstanceData), alignof(glm::vec4));
+  if (allocation_.data) {
+    std::memcpy(allocation_.data, instances.data(), allocation_.size);
+  }
+  ring_buffer.Unmap(allocation_);
+}
+
+void InstanceBuffer::Bind(std::size_t first) const {
+  glBindBuffer(GL_ARRAY_BUFFER, allocation_.buffer);
+  SetupVertexAttributes<InstanceData>(allocation_.offset + first * sizeof(InstanceData), 1);
+}
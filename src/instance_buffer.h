@@ -0,0 +1,55 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef INSTANCE_BUFFER_H_
+#define INSTANCE_BUFFER_H_
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frame_ring_buffer.h"
+#include "vertex_layout.h"
+
+// Per instance vertex attributes of shaders compiled with INSTANCED,
+// replacing the model and dequantisation uniforms. Instances of different
+// meshes can then share one draw.
+struct InstanceData {
+  glm::mat4 model;
+  glm::mat3 normal_matrix;
+  glm::vec3 position_scale;
+  glm::vec3 position_offset;
+};
+
+// Matrices take one location per column.
+template <>
+struct VertexLayout<InstanceData> {
+  static constexpr std::array<VertexAttribute, 9> kAttributes = {{
+    {3, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, model)},
+    {4, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, model) + sizeof(glm::vec4)},
+    {5, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, model) + sizeof(glm::vec4) * 2},
+    {6, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, model) + sizeof(glm::vec4) * 3},
+    {7, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, normal_matrix)},
+    {8, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, normal_matrix) + sizeof(glm::vec3)},
+    {9, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, normal_matrix) + sizeof(glm::vec3) * 2},
+    {10, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, position_scale)},
+    {11, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, position_offset)},
+  }};
+};
+
+// InstanceData of one frame, written into FrameRingBuffer.
+class InstanceBuffer {
+ public:
+  // Replaces the contents. Call once per frame, the data lives as long as
+  // the frame's ring buffer region.
+  void Upload(const std::vector<InstanceData>& instances);
+
+  // Points the instance attributes of the bound vertex array at the
+  // instances from |first| on.
+  void Bind(std::size_t first) const;
+
+ private:
+  FrameRingBuffer::Allocation allocation_;
+};
+
+#endif // INSTANCE_BUFFER_H_
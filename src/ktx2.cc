@@ -0,0 +1,207 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "ktx2.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+const unsigned char kKtx2Identifier[12] = {
+  0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A,
+};
+
+// Identifier, nine uint32 header fields, then the index of DFD, KVD and SGD.
+const std::size_t kHeaderSize = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+const std::size_t kLevelIndexEntrySize = 3 * 8;
+
+// Khronos data format descriptor constants.
+const uint32_t kDFModelBC1A = 128;
+const uint32_t kDFModelBC3 = 130;
+const uint32_t kDFModelBC7 = 134;
+const uint32_t kDFPrimariesBT709 = 1;
+const uint32_t kDFTransferLinear = 1;
+const uint32_t kDFTransferSrgb = 2;
+const uint32_t kDFChannelColor = 0;
+const uint32_t kDFChannelAlpha = 15;
+
+uint32_t ReadUint32(const unsigned char* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+uint64_t ReadUint64(const unsigned char* data) {
+  return ReadUint32(data) | ((uint64_t)ReadUint32(data + 4) << 32);
+}
+
+void AppendUint32(std::vector<unsigned char>& data, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    data.push_back((unsigned char)(value >> (8 * i)));
+  }
+}
+
+void AppendUint64(std::vector<unsigned char>& data, uint64_t value) {
+  AppendUint32(data, (uint32_t)value);
+  AppendUint32(data, (uint32_t)(value >> 32));
+}
+
+void WriteUint64(unsigned char* data, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    data[i] = (unsigned char)(value >> (8 * i));
+  }
+}
+
+uint32_t GetBlockBytes(uint32_t vk_format) {
+  if (vk_format == Ktx2Image::kBC1RGBUnorm || vk_format == Ktx2Image::kBC1RGBSrgb) {
+    return 8;
+  }
+  if (vk_format == Ktx2Image::kBC3Unorm || vk_format == Ktx2Image::kBC3Srgb ||
+      vk_format == Ktx2Image::kBC7Unorm || vk_format == Ktx2Image::kBC7Srgb) {
+    return 16;
+  }
+  return 0;
+}
+
+// Basic data format descriptor block, which the spec requires even though
+// readers can derive everything from vkFormat.
+std::vector<unsigned char> MakeDataFormatDescriptor(uint32_t vk_format) {
+  bool srgb = vk_format == Ktx2Image::kBC1RGBSrgb || vk_format == Ktx2Image::kBC3Srgb ||
+              vk_format == Ktx2Image::kBC7Srgb;
+  uint32_t block_bytes = GetBlockBytes(vk_format);
+
+  uint32_t model = kDFModelBC7;
+  if (block_bytes == 8) {
+    model = kDFModelBC1A;
+  } else if (vk_format == Ktx2Image::kBC3Unorm || vk_format == Ktx2Image::kBC3Srgb) {
+    model = kDFModelBC3;
+  }
+
+  struct Sample {
+    uint32_t bit_offset;
+    uint32_t bit_length;
+    uint32_t channel;
+  };
+  std::vector<Sample> samples;
+  if (model == kDFModelBC3) {
+    samples.push_back({0, 64, kDFChannelAlpha});
+    samples.push_back({64, 64, kDFChannelColor});
+  } else {
+    samples.push_back({0, block_bytes * 8, kDFChannelColor});
+  }
+
+  uint32_t block_size = 24 + 16 * (uint32_t)samples.size();
+
+  std::vector<unsigned char> dfd;
+  AppendUint32(dfd, 4 + block_size);
+  AppendUint32(dfd, 0);
+  AppendUint32(dfd, 2 | (block_size << 16));
+  AppendUint32(dfd, model | (kDFPrimariesBT709 << 8) | ((srgb ? kDFTransferSrgb : kDFTransferLinear) << 16));
+  AppendUint32(dfd, 3 | (3 << 8));
+  AppendUint32(dfd, block_bytes);
+  AppendUint32(dfd, 0);
+  for (auto& sample : samples) {
+    AppendUint32(dfd, sample.bit_offset | ((sample.bit_length - 1) << 16) | (sample.channel << 24));
+    AppendUint32(dfd, 0);
+    AppendUint32(dfd, 0);
+    AppendUint32(dfd, 0xFFFFFFFF);
+  }
+  return dfd;
+}
+
+bool ReadKtx2(const std::string& file_name, Ktx2Image* image) {
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  if (data.size() < kHeaderSize || !std::equal(kKtx2Identifier, kKtx2Identifier + 12, data.begin())) {
+    std::cout << "DongZhong: " << file_name << " is not a KTX2 file" << std::endl;
+    return false;
+  }
+
+  const unsigned char* header = data.data() + 12;
+  uint32_t vk_format = ReadUint32(header);
+  uint32_t width = ReadUint32(header + 8);
+  uint32_t height = ReadUint32(header + 12);
+  uint32_t depth = ReadUint32(header + 16);
+  uint32_t layer_count = ReadUint32(header + 20);
+  uint32_t face_count = ReadUint32(header + 24);
+  uint32_t level_count = std::max<uint32_t>(ReadUint32(header + 28), 1);
+  uint32_t supercompression = ReadUint32(header + 32);
+
+  if (GetBlockBytes(vk_format) == 0 || depth != 0 || layer_count > 1 || face_count != 1 || supercompression != 0) {
+    std::cout << "DongZhong: " << file_name << " has an unsupported KTX2 layout" << std::endl;
+    return false;
+  }
+  if (data.size() < kHeaderSize + level_count * kLevelIndexEntrySize) {
+    return false;
+  }
+
+  image->vk_format = vk_format;
+  image->width = width;
+  image->height = height;
+  image->levels.clear();
+
+  const unsigned char* level_index = data.data() + kHeaderSize;
+  for (uint32_t level = 0; level < level_count; ++level) {
+    uint64_t offset = ReadUint64(level_index + level * kLevelIndexEntrySize);
+    uint64_t length = ReadUint64(level_index + level * kLevelIndexEntrySize + 8);
+    if (offset > data.size() || length > data.size() - offset) {
+      std::cout << "DongZhong: " << file_name << " is truncated" << std::endl;
+      return false;
+    }
+    image->levels.emplace_back(data.begin() + offset, data.begin() + offset + length);
+  }
+
+  return true;
+}
+
+bool WriteKtx2(const std::string& file_name, const Ktx2Image& image) {
+  uint32_t block_bytes = GetBlockBytes(image.vk_format);
+  if (block_bytes == 0 || image.levels.empty()) {
+    return false;
+  }
+
+  auto dfd = MakeDataFormatDescriptor(image.vk_format);
+  std::size_t level_count = image.levels.size();
+  std::size_t dfd_offset = kHeaderSize + level_count * kLevelIndexEntrySize;
+
+  std::vector<unsigned char> data(kKtx2Identifier, kKtx2Identifier + 12);
+  AppendUint32(data, image.vk_format);
+  AppendUint32(data, 1);
+  AppendUint32(data, image.width);
+  AppendUint32(data, image.height);
+  AppendUint32(data, 0);
+  AppendUint32(data, 0);
+  AppendUint32(data, 1);
+  AppendUint32(data, (uint32_t)level_count);
+  AppendUint32(data, 0);
+
+  AppendUint32(data, (uint32_t)dfd_offset);
+  AppendUint32(data, (uint32_t)dfd.size());
+  AppendUint32(data, 0);
+  AppendUint32(data, 0);
+  AppendUint64(data, 0);
+  AppendUint64(data, 0);
+
+  // Filled in below, once the level offsets are known.
+  data.resize(data.size() + level_count * kLevelIndexEntrySize);
+  data.insert(data.end(), dfd.begin(), dfd.end());
+
+  // Levels are stored smallest first, each aligned to the block size.
+  for (std::size_t level = level_count; level-- > 0;) {
+    data.resize((data.size() + block_bytes - 1) / block_bytes * block_bytes);
+
+    auto& level_data = image.levels[level];
+    unsigned char* entry = data.data() + kHeaderSize + level * kLevelIndexEntrySize;
+    WriteUint64(entry, data.size());
+    WriteUint64(entry + 8, level_data.size());
+    WriteUint64(entry + 16, level_data.size());
+
+    data.insert(data.end(), level_data.begin(), level_data.end());
+  }
+
+  std::ofstream file(file_name, std::ios::binary);
+  file.write((const char*)data.data(), data.size());
+  return file.good();
+}
@@ -0,0 +1,33 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef KTX2_H_
+#define KTX2_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal KTX2 container support: single 2D image with a mip chain, no
+// supercompression. Enough for the block compressed textures written by the
+// texture_compressor tool.
+struct Ktx2Image {
+  // VkFormat values of the formats we read and write.
+  static const uint32_t kBC1RGBUnorm = 131;
+  static const uint32_t kBC1RGBSrgb = 132;
+  static const uint32_t kBC3Unorm = 137;
+  static const uint32_t kBC3Srgb = 138;
+  static const uint32_t kBC7Unorm = 145;
+  static const uint32_t kBC7Srgb = 146;
+
+  uint32_t vk_format = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // Level 0 first.
+  std::vector<std::vector<unsigned char>> levels;
+};
+
+bool ReadKtx2(const std::string& file_name, Ktx2Image* image);
+
+bool WriteKtx2(const std::string& file_name, const Ktx2Image& image);
+
+#endif // KTX2_H_
@@ -6,6 +6,8 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "gl_state_cache.h"
+
 Light::Light(const glm::vec3& ambient,
              const glm::vec3& diffuse,
              const glm::vec3& specular)
@@ -14,20 +16,30 @@ Light::Light(const glm::vec3& ambient,
       diffuse_(diffuse),
       specular_(specular) {}
 
+Light::~Light() {
+  if (shadow_unit_ != 0) {
+    GLStateCache::Get().ReleaseTextureUnit(shadow_unit_);
+  }
+}
+
 void Light::SetEnable(bool enable) {
   enable_ = enable;
+  ++version_;
 }
 
 void Light::SetAmbient(const glm::vec3& ambient) {
   ambient_ = ambient;
+  ++version_;
 }
 
 void Light::SetDiffuse(const glm::vec3& diffuse) {
   diffuse_ = diffuse;
+  ++version_;
 }
 
 void Light::SetSpecular(const glm::vec3& specular) {
   specular_ = specular;
+  ++version_;
 }
 
 void Light::GenerateShadowMisc() {}
@@ -47,6 +59,7 @@ DirectLight::DirectLight(const glm::vec3& ambient,
 
 void DirectLight::SetDirection(const glm::vec3& direction) {
   direction_ = glm::normalize(direction);
+  ++version_;
 }
 
 glm::vec2 DirectLight::GetDirectionAngle() const {
@@ -75,13 +88,14 @@ void DirectLight::SetDirectionAngle(float pitch, float yaw) {
   direction.y = sin(glm::radians(pitch));
   direction.z = -cos(glm::radians(pitch)) * sin(glm::radians(yaw));
   direction_ = glm::normalize(direction);
+  ++version_;
 }
 
 void DirectLight::GenerateShadowMisc() {
   glGenFramebuffers(1, &shadow_fbo_);
 
   glGenTextures(1, &shadow_map_);
-  glBindTexture(GL_TEXTURE_2D, shadow_map_);
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, shadow_map_);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, kShadowWidth, kShadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -90,11 +104,13 @@ void DirectLight::GenerateShadowMisc() {
   GLfloat borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
   glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
-  glBindFramebuffer(GL_FRAMEBUFFER, shadow_fbo_);
+  GLStateCache::Get().BindFramebuffer(shadow_fbo_);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadow_map_, 0);
   glDrawBuffer(GL_NONE);
   glReadBuffer(GL_NONE);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  GLStateCache::Get().BindFramebuffer(0);
+
+  shadow_unit_ = GLStateCache::Get().AllocateTextureUnit();
 }
 
 glm::mat4 DirectLight::GetLightSpaceTrans() const {
@@ -122,18 +138,22 @@ PointLight::PointLight(const glm::vec3& ambient,
 
 void PointLight::SetPosition(const glm::vec3& position) {
   position_ = position;
+  ++version_;
 }
 
 void PointLight::SetConstant(float constant) {
   constant_ = constant;
+  ++version_;
 }
 
 void PointLight::SetLinear(float linear) {
   linear_ = linear;
+  ++version_;
 }
 
 void PointLight::SetQuadratic(float quadratic) {
   quadratic_ = quadratic;
+  ++version_;
 }
 
 void PointLight::GenerateShadowMisc() {
@@ -158,6 +178,7 @@ SpotLight::SpotLight(const glm::vec3& ambient,
 
 void SpotLight::SetDirection(const glm::vec3& direction) {
   direction_ = direction;
+  ++version_;
 }
 
 glm::vec2 SpotLight::GetDirectionAngle() const {
@@ -186,14 +207,17 @@ void SpotLight::SetDirectionAngle(float pitch, float yaw) {
   direction.y = sin(glm::radians(pitch));
   direction.z = -cos(glm::radians(pitch)) * sin(glm::radians(yaw));
   direction_ = glm::normalize(direction);
+  ++version_;
 }
 
 void SpotLight::SetCutOff(float cut_off) {
   cut_off_ = cut_off;
+  ++version_;
 }
 
 void SpotLight::SetOuterCutOff(float outer_cut_off) {
   outer_cut_off_ = outer_cut_off;
+  ++version_;
 }
 
 void SpotLight::GenerateShadowMisc() {
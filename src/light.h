@@ -24,7 +24,7 @@ class Light {
         const glm::vec3& diffuse = glm::vec3(0.0f, 0.0f, 0.0f),
         const glm::vec3& specular = glm::vec3(0.0f, 0.0f, 0.0f));
 
-  virtual ~Light() = default;
+  virtual ~Light();
 
   std::string GetName() const { return name_; }
 
@@ -42,16 +42,23 @@ class Light {
 
   Type GetType() const { return type_; }
 
+  // Bumped by every setter, so consumers can tell whether a light changed
+  // since they last looked at it.
+  std::size_t GetVersion() const { return version_; }
+
   virtual void GenerateShadowMisc();
 
   GLuint GetShadowFBO() const { return shadow_fbo_; }
   GLuint GetShadowMap() const { return shadow_map_; }
+  GLuint GetShadowUnit() const { return shadow_unit_; }
 
  protected:
   Type type_ = Type::kNone;
 
   std::string name_ = "Light";
 
+  std::size_t version_ = 0;
+
   bool enable_;
 
   glm::vec3 ambient_;
@@ -60,6 +67,8 @@ class Light {
 
   GLuint shadow_fbo_;
   GLuint shadow_map_;
+  // Texture unit the shadow map is sampled from, 0 until one is allocated.
+  GLuint shadow_unit_ = 0;
 };
 
 class DirectLight : public Light {
@@ -2,9 +2,21 @@
 
 #include "light_controller.h"
 
+#include <cstring>
+
 #include <imgui.h>
 
-LightController::LightController() = default;
+LightController::LightController() : light_block_() {
+  glGenBuffers(1, &light_ubo_);
+  glBindBuffer(GL_UNIFORM_BUFFER, light_ubo_);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), &light_block_, GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)Shader::UniformBlock::kLights, light_ubo_);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+LightController::~LightController() {
+  glDeleteBuffers(1, &light_ubo_);
+}
 
 void LightController::AddDirectLight(const std::string& name, const std::shared_ptr<DirectLight>& light) {
   direct_lights_[name] = light;
@@ -207,69 +219,124 @@ void LightController::Config() {
 
   ImGui::PopItemWidth();
 
+  ImGui::Text("Light block upload: %zu bytes", uploaded_bytes_);
+
   ImGui::End();
   ImGui::PopID();
 }
 
-void LightController::ApplyLighting(const std::shared_ptr<Shader>& shader,
-                                    const std::shared_ptr<GlobalController>& global_controller) {
-  shader->SetInt("POINT_LIGHT_COUNT", point_lights_.size());
+void LightController::ApplyLighting(const std::shared_ptr<GlobalController>& global_controller) {
+  uploaded_bytes_ = 0;
 
-  std::size_t i = 0;
-  for (auto&& [name, direct_light] : direct_lights_) {
-    if (direct_light) {
-      shader->SetBool("direct_light[" + std::to_string(i) + "].enable", direct_light->IsEnabled());
-      shader->SetVec3("direct_light[" + std::to_string(i) + "].direction", direct_light->GetDirection());
-      shader->SetVec3("direct_light[" + std::to_string(i) +"].ambient", direct_light->GetAmbient());
-      shader->SetVec3("direct_light[" + std::to_string(i) + "].diffuse", direct_light->GetDiffuse());
-      shader->SetVec3("direct_light[" + std::to_string(i) + "].specular", direct_light->GetSpecular());
+  glBindBuffer(GL_UNIFORM_BUFFER, light_ubo_);
+
+  direct_light_count_ = UpdateSlots(direct_lights_, light_block_.direct_light, direct_slots_, &PackDirectLight);
+  point_light_count_ = UpdateSlots(point_lights_, light_block_.point_light, point_slots_, &PackPointLight);
+  spot_light_count_ = UpdateSlots(spot_lights_, light_block_.spot_light, spot_slots_, &PackSpotLight);
+
+  // The flashlight follows the camera, so compare the packed data instead of
+  // relying on the light version alone.
+  if (flashlight_) {
+    auto flashlight = PackSpotLight(**flashlight_);
+    flashlight.position = global_controller->GetCameraPosition();
+    flashlight.direction = global_controller->GetCameraFront();
+    if (std::memcmp(&flashlight, &light_block_.flashlight, sizeof(SpotLightData)) != 0) {
+      UploadRange(light_block_.flashlight, flashlight);
     }
-    ++i;
   }
 
-  i = 0;
-  for (auto&& [name, point_light] : point_lights_) {
-    if (point_light) {
-      shader->SetBool("point_light[" + std::to_string(i) + "].enable", point_light->IsEnabled());
-      shader->SetVec3("point_light[" + std::to_string(i) + "].position", point_light->GetPosition());
-      shader->SetVec3("point_light[" + std::to_string(i) + "].ambient", point_light->GetAmbient());
-      shader->SetVec3("point_light[" + std::to_string(i) + "].diffuse", point_light->GetDiffuse());
-      shader->SetVec3("point_light[" + std::to_string(i) + "].specular", point_light->GetSpecular());
-      shader->SetFloat("point_light[" + std::to_string(i) + "].constant", point_light->GetConstant());
-      shader->SetFloat("point_light[" + std::to_string(i) + "].linear", point_light->GetLinear());
-      shader->SetFloat("point_light[" + std::to_string(i) + "].quadratic", point_light->GetQuadratic());
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+ShaderDefines LightController::GetShaderDefines() const {
+  bool flashlight_enable = flashlight_ && (*flashlight_)->IsEnabled();
+  return {
+    {"DIRECT_LIGHT_COUNT", std::to_string(direct_light_count_)},
+    {"POINT_LIGHT_COUNT", std::to_string(point_light_count_)},
+    {"SPOT_LIGHT_COUNT", std::to_string(spot_light_count_)},
+    {"FLASHLIGHT_ENABLE", flashlight_enable ? "true" : "false"},
+  };
+}
+
+LightController::DirectLightData LightController::PackDirectLight(const DirectLight& light) {
+  DirectLightData data = {};
+  data.enable = light.IsEnabled();
+  data.direction = light.GetDirection();
+  data.ambient = light.GetAmbient();
+  data.diffuse = light.GetDiffuse();
+  data.specular = light.GetSpecular();
+  return data;
+}
+
+LightController::PointLightData LightController::PackPointLight(const PointLight& light) {
+  PointLightData data = {};
+  data.enable = light.IsEnabled();
+  data.position = light.GetPosition();
+  data.ambient = light.GetAmbient();
+  data.diffuse = light.GetDiffuse();
+  data.specular = light.GetSpecular();
+  data.constant = light.GetConstant();
+  data.linear = light.GetLinear();
+  data.quadratic = light.GetQuadratic();
+  return data;
+}
+
+LightController::SpotLightData LightController::PackSpotLight(const SpotLight& light) {
+  SpotLightData data = {};
+  data.enable = light.IsEnabled();
+  data.position = light.GetPosition();
+  data.direction = light.GetDirection();
+  data.cut_off = glm::cos(glm::radians(light.GetCutOff()));
+  data.outer_cut_off = glm::cos(glm::radians(light.GetOuterCutOff()));
+  data.ambient = light.GetAmbient();
+  data.diffuse = light.GetDiffuse();
+  data.specular = light.GetSpecular();
+  data.constant = light.GetConstant();
+  data.linear = light.GetLinear();
+  data.quadratic = light.GetQuadratic();
+  return data;
+}
+
+template <typename Data>
+void LightController::UploadRange(Data& cached, const Data& data) {
+  cached = data;
+  GLintptr offset = reinterpret_cast<const char*>(&cached) - reinterpret_cast<const char*>(&light_block_);
+  glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(Data), &cached);
+  uploaded_bytes_ += sizeof(Data);
+}
+
+template <typename LightType, typename Data, std::size_t kCount>
+std::size_t LightController::UpdateSlots(const std::map<std::string, std::shared_ptr<LightType>>& lights,
+                                  Data (&block_data)[kCount],
+                                  SlotState (&slots)[kCount],
+                                  Data (*pack)(const LightType&)) {
+  std::size_t i = 0;
+  for (auto&& [name, light] : lights) {
+    if (i == kCount) {
+      break;
+    }
+    if (!light || !light->IsEnabled()) {
+      continue;
+    }
+
+    auto& slot = slots[i];
+    if (slot.light != light.get() || slot.version != light->GetVersion()) {
+      UploadRange(block_data[i], pack(*light));
+      slot.light = light.get();
+      slot.version = light->GetVersion();
     }
     ++i;
   }
 
-  i = 0;
-  for (auto&& [name, spot_light] : spot_lights_) {
-    if (spot_light) {
-      shader->SetBool("spot_light[" + std::to_string(i) + "].enable", spot_light->IsEnabled());
-      shader->SetVec3("spot_light[" + std::to_string(i) + "].position", spot_light->GetPosition());
-      shader->SetVec3("spot_light[" + std::to_string(i) + "].direction", spot_light->GetDirection());
-      shader->SetFloat("spot_light[" + std::to_string(i) + "].cut_off", glm::cos(glm::radians(spot_light->GetCutOff())));
-      shader->SetFloat("spot_light[" + std::to_string(i) + "].outer_cut_off", glm::cos(glm::radians(spot_light->GetOuterCutOff())));
-      shader->SetVec3("spot_light[" + std::to_string(i) + "].ambient", spot_light->GetAmbient());
-      shader->SetVec3("spot_light[" + std::to_string(i) + "].diffuse", spot_light->GetDiffuse());
-      shader->SetVec3("spot_light[" + std::to_string(i) + "].specular", spot_light->GetSpecular());
-      shader->SetFloat("spot_light[" + std::to_string(i) + "].constant", spot_light->GetConstant());
-      shader->SetFloat("spot_light[" + std::to_string(i) + "].linear", spot_light->GetLinear());
-      shader->SetFloat("spot_light[" + std::to_string(i) + "].quadratic", spot_light->GetQuadratic());
+  std::size_t count = i;
+
+  // Clear slots whose light went away or got disabled.
+  for (; i < kCount; ++i) {
+    if (slots[i].light) {
+      UploadRange(block_data[i], Data());
+      slots[i] = SlotState();
     }
   }
 
-  if (flashlight_) {
-    shader->SetBool("flashlight.enable", (*flashlight_)->IsEnabled());
-    shader->SetVec3("flashlight.position", global_controller->GetCameraPosition());
-    shader->SetVec3("flashlight.direction", global_controller->GetCameraFront());
-    shader->SetFloat("flashlight.cut_off", glm::cos(glm::radians((*flashlight_)->GetCutOff())));
-    shader->SetFloat("flashlight.outer_cut_off", glm::cos(glm::radians((*flashlight_)->GetOuterCutOff())));
-    shader->SetVec3("flashlight.ambient", (*flashlight_)->GetAmbient());
-    shader->SetVec3("flashlight.diffuse", (*flashlight_)->GetDiffuse());
-    shader->SetVec3("flashlight.specular", (*flashlight_)->GetSpecular());
-    shader->SetFloat("flashlight.constant", (*flashlight_)->GetConstant());
-    shader->SetFloat("flashlight.linear", (*flashlight_)->GetLinear());
-    shader->SetFloat("flashlight.quadratic", (*flashlight_)->GetQuadratic());
-  }
+  return count;
 }
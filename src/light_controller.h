@@ -4,6 +4,7 @@
 #define RENDER_CONTROLLER_H_
 
 #include <map>
+#include <optional>
 #include <string>
 
 #include "global_controller.h"
@@ -12,7 +13,13 @@
 
 class LightController {
  public:
+  // Capacity of the light arrays in the "Lights" uniform block.
+  static const std::size_t kMaxDirectLights = 1;
+  static const std::size_t kMaxPointLights = 4;
+  static const std::size_t kMaxSpotLights = 2;
+
   LightController();
+  ~LightController();
 
   void AddDirectLight(const std::string& name, const std::shared_ptr<DirectLight>& light);
 
@@ -32,16 +39,104 @@ class LightController {
 
   void Config();
 
-  void ApplyLighting(const std::shared_ptr<Shader>& shader,
-                     const std::shared_ptr<GlobalController>& global_controller);
+  // Brings the shared light uniform buffer up to date. Called once per frame,
+  // only lights which changed since the last call are uploaded.
+  void ApplyLighting(const std::shared_ptr<GlobalController>& global_controller);
+
+  std::size_t GetUploadedBytes() const { return uploaded_bytes_; }
+
+  // Light counts and flashlight switch for specialised shader variants, as of
+  // the last ApplyLighting().
+  ShaderDefines GetShaderDefines() const;
 
  private:
+  // std140 mirrors of the structs in fragment_shader.fs.
+  struct DirectLightData {
+    glm::vec3 direction;
+    GLint enable;
+    glm::vec3 ambient;
+    float padding0;
+    glm::vec3 diffuse;
+    float padding1;
+    glm::vec3 specular;
+    float padding2;
+  };
+
+  struct PointLightData {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    GLint enable;
+  };
+
+  struct SpotLightData {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 direction;
+    float linear;
+    glm::vec3 ambient;
+    float quadratic;
+    glm::vec3 diffuse;
+    float cut_off;
+    glm::vec3 specular;
+    float outer_cut_off;
+    GLint enable;
+    float padding[3];
+  };
+
+  static_assert(sizeof(DirectLightData) == 64, "DirectLight must match std140 layout");
+  static_assert(sizeof(PointLightData) == 64, "PointLight must match std140 layout");
+  static_assert(sizeof(SpotLightData) == 96, "SpotLight must match std140 layout");
+
+  struct LightBlock {
+    DirectLightData direct_light[kMaxDirectLights];
+    PointLightData point_light[kMaxPointLights];
+    SpotLightData spot_light[kMaxSpotLights];
+    SpotLightData flashlight;
+  };
+
+  // Which light a slot of the block was last filled from, and at which version.
+  struct SlotState {
+    const Light* light = nullptr;
+    std::size_t version = 0;
+  };
+
+  static DirectLightData PackDirectLight(const DirectLight& light);
+  static PointLightData PackPointLight(const PointLight& light);
+  static SpotLightData PackSpotLight(const SpotLight& light);
+
+  template <typename Data>
+  void UploadRange(Data& cached, const Data& data);
+
+  // Packs the enabled lights to the front of |block_data| and returns how
+  // many there are.
+  template <typename LightType, typename Data, std::size_t kCount>
+  std::size_t UpdateSlots(const std::map<std::string, std::shared_ptr<LightType>>& lights,
+                   Data (&block_data)[kCount],
+                   SlotState (&slots)[kCount],
+                   Data (*pack)(const LightType&));
+
   std::map<std::string, std::shared_ptr<DirectLight>> direct_lights_;
   std::map<std::string, std::shared_ptr<PointLight>> point_lights_;
   std::map<std::string, std::shared_ptr<SpotLight>> spot_lights_;
   std::optional<std::shared_ptr<SpotLight>> flashlight_;
 
   glm::vec3 clear_color_ {0.1f, 0.1f, 0.1f};
+
+  GLuint light_ubo_;
+  LightBlock light_block_;
+  SlotState direct_slots_[kMaxDirectLights];
+  SlotState point_slots_[kMaxPointLights];
+  SlotState spot_slots_[kMaxSpotLights];
+  std::size_t uploaded_bytes_ = 0;
+
+  std::size_t direct_light_count_ = 0;
+  std::size_t point_light_count_ = 0;
+  std::size_t spot_light_count_ = 0;
 };
 
 #endif // RENDER_CONTROLLER_H_
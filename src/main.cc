@@ -1,6 +1,7 @@
 // Created by Dong Zhong on 2022/02/18.
 
 #include <cmath>
+#include <iostream>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,12 +11,23 @@
 
 #include "stb_image.h"
 
+#include "frame_ring_buffer.h"
+#include "geometry_buffer.h"
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
 #include "global_controller.h"
 #include "light_controller.h"
 #include "light.h"
 #include "material.h"
+#include "material_textures.h"
+#include "mesh_cache.h"
 #include "scene.h"
+#include "shader_library.h"
+#include "shader_watcher.h"
 #include "texture.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "texture_streamer.h"
 #include "vertex.h"
 
 #include "test_model.h"
@@ -43,6 +55,8 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 
 void ProcessInput(GLFWwindow* window);
 
+void LoadScene();
+
 int main() {
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -73,6 +87,7 @@ int main() {
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
     return -1;
   }
+  GLExtensions::Load((GLADloadproc)glfwGetProcAddress);
 
   g_global_controller_ = std::make_shared<GlobalController>();
   int display_w, display_h;
@@ -89,35 +104,25 @@ int main() {
   g_light_controller_->AddSpotLight("Spot Light", std::make_shared<SpotLight>());
   g_light_controller_->AddFlashlight(std::make_shared<SpotLight>());
 
-  g_scene = std::make_shared<Scene>();
-  auto material = std::make_shared<Material>(32);
-  auto shader = std::make_shared<Shader>("vertex_shader.vs", "fragment_shader.fs");
-  material->SetRenderShader(shader);
-  g_scene->AddMaterial("Cube", material);
+  LoadScene();
 
-  auto diffuse_texture = std::make_shared<Texture>(TextureFromFile("container.png", TEXTURE_PATH, true));
-  auto specular_texture = std::make_shared<Texture>(TextureFromFile("container.png", TEXTURE_PATH, true));
+  auto build_stats = Shader::GetBuildStats();
+  std::cout << "DongZhong: " << "Shaders compiled: " << build_stats.compiled
+            << " (" << build_stats.compile_ms << " ms), loaded from cache: " << build_stats.cache_hits
+            << " (" << build_stats.cache_ms << " ms), rejected binaries: " << build_stats.cache_rejected
+            << std::endl;
 
-  // Test Model
-  for (std::size_t i = 0; i < TestModel::cube_positions.size(); ++i) {
-    auto cube_model = std::make_shared<Model>(TestModel::cube_vertices, TestModel::cube_indices);
-    cube_model->SetDiffuseTexture(diffuse_texture);
-    cube_model->SetSpecularTexture(specular_texture);
-    glm::mat4 cube_transform = glm::mat4(1.0);
-    cube_transform = glm::translate(cube_transform, TestModel::cube_positions[i]);
-    cube_transform = glm::rotate(cube_transform, glm::radians(float(20 * i)), glm::vec3(1.0f, 0.3f, 0.5f));
-    cube_model->SetModelTransformation(cube_transform);
-    g_scene->AddModel("TestModel" + std::to_string(i), cube_model, "Cube");
-  }
-
-  auto plane_model = std::make_shared<Model>(TestModel::plane_vertices, TestModel::plane_indices);
-  plane_model->SetDiffuseTexture(diffuse_texture);
-  plane_model->SetSpecularTexture(specular_texture);
-  g_scene->AddModel("TestPlane", plane_model, "Cube");
+  ShaderWatcher shader_watcher(SHADER_PATH);
 
   while (!glfwWindowShouldClose(window)) {
     glfwPollEvents();
 
+    shader_watcher.Update();
+    TextureLoader::Get().Update();
+    TextureStreamer::Get().Update();
+    GeometryBuffer::Get().Update();
+    FrameRingBuffer::Get().BeginFrame();
+
     ProcessInput(window);
 
     float current_frame = glfwGetTime();
@@ -132,15 +137,35 @@ int main() {
     g_light_controller_->Config();
     g_scene->Config();
 
+    Shader::ResetFrameUploadStats();
+    GLStateCache::Get().ResetFrameStats();
     g_scene->Render(g_global_controller_, g_light_controller_);
 
     ImGui::Render();
 
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    FrameRingBuffer::Get().EndFrame();
 
     glfwSwapBuffers(window);
   }
 
+  ShaderLibrary::Get().PrintReport();
+  TextureCache::Get().PrintReport();
+  MeshCache::Get().PrintReport();
+
+  // Release GL objects while the context is still alive.
+  g_scene.reset();
+  g_light_controller_.reset();
+  g_global_controller_.reset();
+  ShaderLibrary::Get().Clear();
+  MaterialTextures::Get().Clear();
+  MeshCache::Get().Clear();
+  GeometryBuffer::Get().Clear();
+  FrameRingBuffer::Get().Clear();
+  TextureCache::Get().Clear();
+  TextureLoader::Get().Clear();
+  TextureStreamer::Get().Clear();
+
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -192,3 +217,32 @@ void ProcessInput(GLFWwindow* window) {
     g_global_controller_->CameraRotate(Camera::Rotation::kLeft, delta_time);
   }
 }
+
+void LoadScene() {
+  g_scene = std::make_shared<Scene>();
+  auto material = std::make_shared<Material>(32);
+  material->SetShaderSource("vertex_shader.vs", "fragment_shader.fs");
+  g_scene->AddMaterial("Cube", material);
+
+  auto diffuse_texture = TextureCache::Get().GetTexture("container.png", TEXTURE_PATH, true);
+  auto specular_texture = TextureCache::Get().GetTexture("container.png", TEXTURE_PATH, true);
+
+  // Test Model
+  for (std::size_t i = 0; i < TestModel::cube_positions.size(); ++i) {
+    auto cube_model = std::make_shared<Model>(MeshCache::Get().GetMesh(TestModel::cube_vertices,
+                                                                        TestModel::cube_indices));
+    cube_model->SetDiffuseTexture(diffuse_texture);
+    cube_model->SetSpecularTexture(specular_texture);
+    glm::mat4 cube_transform = glm::mat4(1.0);
+    cube_transform = glm::translate(cube_transform, TestModel::cube_positions[i]);
+    cube_transform = glm::rotate(cube_transform, glm::radians(float(20 * i)), glm::vec3(1.0f, 0.3f, 0.5f));
+    cube_model->SetModelTransformation(cube_transform);
+    g_scene->AddModel("TestModel" + std::to_string(i), cube_model, "Cube");
+  }
+
+  auto plane_model = std::make_shared<Model>(MeshCache::Get().GetMesh(TestModel::plane_vertices,
+                                                                       TestModel::plane_indices));
+  plane_model->SetDiffuseTexture(diffuse_texture);
+  plane_model->SetSpecularTexture(specular_texture);
+  g_scene->AddModel("TestPlane", plane_model, "Cube");
+}
@@ -2,12 +2,43 @@
 
 #include "material.h"
 
+#include "gl_state_cache.h"
+#include "shader_library.h"
+
 Material::Material(float shininess, bool is_blinn_phong)
     : shininess_(shininess),
-      is_blinn_phong_(is_blinn_phong) {}
+      is_blinn_phong_(is_blinn_phong),
+      diffuse_unit_(GLStateCache::Get().AllocateTextureUnit()),
+      specular_unit_(GLStateCache::Get().AllocateTextureUnit()) {}
+
+Material::~Material() {
+  GLStateCache::Get().ReleaseTextureUnit(diffuse_unit_);
+  GLStateCache::Get().ReleaseTextureUnit(specular_unit_);
+}
+
+void Material::SetShaderSource(const std::string& vertex_shader_path, const std::string& fragment_shader_path) {
+  vertex_shader_path_ = vertex_shader_path;
+  fragment_shader_path_ = fragment_shader_path;
+  shader_variants_.clear();
+}
+
+std::shared_ptr<Shader> Material::GetRenderShader(const ShaderDefines& defines) {
+  std::string key;
+  for (auto&& [name, value] : defines) {
+    key += name + "=" + value + ";";
+  }
+
+  auto& shader = shader_variants_[key];
+  if (!shader) {
+    shader = ShaderLibrary::Get().GetShader(vertex_shader_path_, fragment_shader_path_, defines);
+  }
+  return shader;
+}
 
-void Material::SetRenderShader(const std::shared_ptr<Shader>& shader) {
-  shader_ = shader;
+ShaderDefines Material::GetShaderDefines() const {
+  return {
+    {"BLINN_PHONG", is_blinn_phong_ ? "true" : "false"},
+  };
 }
 
 void Material::SetShinieness(float shininess) {
@@ -3,7 +3,9 @@
 #ifndef MATERIAL_H_
 #define MATERIAL_H_
 
+#include <map>
 #include <memory>
+#include <string>
 
 #include <glad/glad.h>
 
@@ -13,9 +15,21 @@
 class Material {
  public:
   Material(float shininess = 32.0f, bool is_blinn_phong = true);
+  ~Material();
 
-  void SetRenderShader(const std::shared_ptr<Shader>& shader);
-  std::shared_ptr<Shader> GetRenderShader() const { return shader_; }
+  Material(const Material&) = delete;
+  Material& operator=(const Material&) = delete;
+
+  void SetShaderSource(const std::string& vertex_shader_path, const std::string& fragment_shader_path);
+
+  // Returns the program compiled with |defines|, compiling and caching it on
+  // first use. Empty defines give the uber shader.
+  std::shared_ptr<Shader> GetRenderShader(const ShaderDefines& defines = ShaderDefines());
+
+  // Defines selecting this material's code paths in a specialised variant.
+  ShaderDefines GetShaderDefines() const;
+
+  std::size_t GetShaderVariantCount() const { return shader_variants_.size(); }
 
   float GetShininess() const { return shininess_; }
   void SetShinieness(float shininess);
@@ -23,11 +37,20 @@ class Material {
   bool IsBlinnPhong() const { return is_blinn_phong_; }
   void SetBlinnPhong(bool blinn_phong);
 
+  GLuint GetDiffuseUnit() const { return diffuse_unit_; }
+  GLuint GetSpecularUnit() const { return specular_unit_; }
+
  private:
-  std::shared_ptr<Shader> shader_;
+  std::string vertex_shader_path_;
+  std::string fragment_shader_path_;
+
+  std::map<std::string, std::shared_ptr<Shader>> shader_variants_;
 
   float shininess_;
   bool is_blinn_phong_;
+
+  GLuint diffuse_unit_;
+  GLuint specular_unit_;
 };
 
 #endif // MATERIAL_H_
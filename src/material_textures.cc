@@ -0,0 +1,349 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "material_textures.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "mip_generator.h"
+#include "texture_streamer.h"
+
+void GetClientFormat(GLenum internal_format, GLenum* format, GLsizei* texel_bytes) {
+  switch (internal_format) {
+    case GL_R8:
+      *format = GL_RED;
+      *texel_bytes = 1;
+      break;
+    case GL_RG8:
+      *format = GL_RG;
+      *texel_bytes = 2;
+      break;
+    case GL_RGB8:
+    case GL_SRGB8:
+      *format = GL_RGB;
+      *texel_bytes = 3;
+      break;
+    default:
+      *format = GL_RGBA;
+      *texel_bytes = 4;
+      break;
+  }
+}
+
+MaterialTextures& MaterialTextures::Get() {
+  static MaterialTextures textures;
+  return textures;
+}
+
+MaterialTextures::MaterialTextures()
+    : bindless_(GLExtensions::has_bindless_texture),
+      texture_unit_(GLStateCache::Get().AllocateTextureUnit()) {
+  if (bindless_) {
+    handles_.assign(kMaxBindlessTextures, 0);
+
+    // std140 pads every uvec2 of the array to 16 bytes.
+    glGenBuffers(1, &handle_buffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, handle_buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, kMaxBindlessTextures * 16, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)Shader::UniformBlock::kMaterialTextures, handle_buffer_);
+  }
+}
+
+ShaderDefines MaterialTextures::GetShaderDefines() const {
+  if (bindless_) {
+    return {{"BINDLESS_TEXTURES", "1"}};
+  }
+  return ShaderDefines();
+}
+
+GLint MaterialTextures::GetLayer(const std::shared_ptr<Texture>& texture, GLuint* array) {
+  // Copies and handles can't follow the levels of a streamed texture, it
+  // joins once they are all resident and stays that way.
+  if (!texture || !texture->IsReady() || !TextureStreamer::Get().Pin(texture)) {
+    return -1;
+  }
+
+  auto iter = entries_.find(texture.get());
+  if (iter != entries_.end() && iter->second.texture.expired()) {
+    // A new texture at the address of a freed one.
+    Release(iter->second, false);
+    entries_.erase(iter);
+    iter = entries_.end();
+  }
+
+  if (iter == entries_.end()) {
+    Entry entry;
+    entry.texture = texture;
+    bool added = bindless_ ? AddHandle(*texture, &entry) : AddToBucket(*texture, &entry);
+    iter = entries_.emplace(texture.get(), entry).first;
+    if (!added) {
+      // Remembered with layer -1, so we don't retry every frame.
+      return -1;
+    }
+  }
+
+  auto& entry = iter->second;
+  if (!bindless_ && entry.bucket >= 0) {
+    *array = buckets_[entry.bucket].array;
+  }
+  return entry.layer;
+}
+
+void MaterialTextures::Update() {
+  for (auto iter = entries_.begin(); iter != entries_.end();) {
+    if (iter->second.texture.expired()) {
+      Release(iter->second, false);
+      iter = entries_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  if (handles_dirty_) {
+    std::vector<GLuint64> padded(kMaxBindlessTextures * 2, 0);
+    for (GLint i = 0; i < handle_count_; ++i) {
+      padded[i * 2] = handles_[i];
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, handle_buffer_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, handle_count_ * 16, padded.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    handles_dirty_ = false;
+  }
+}
+
+void MaterialTextures::Clear() {
+  for (auto&& [texture, entry] : entries_) {
+    Release(entry, !entry.texture.expired());
+  }
+  entries_.clear();
+
+  for (auto& bucket : buckets_) {
+    GLStateCache::Get().OnTextureDeleted(bucket.array);
+    glDeleteTextures(1, &bucket.array);
+  }
+  buckets_.clear();
+
+  if (handle_buffer_ != 0) {
+    glDeleteBuffers(1, &handle_buffer_);
+    handle_buffer_ = 0;
+  }
+}
+
+MaterialTextures::Stats MaterialTextures::GetStats() const {
+  Stats stats;
+  stats.textures = entries_.size();
+  stats.buckets = buckets_.size();
+  stats.copies = copies_;
+  for (auto& bucket : buckets_) {
+    stats.capacity += bucket.capacity;
+    for (auto bytes : bucket.level_bytes) {
+      stats.gpu_bytes += (std::size_t)bytes * bucket.capacity;
+    }
+  }
+  if (bindless_) {
+    stats.capacity = kMaxBindlessTextures;
+  }
+  return stats;
+}
+
+bool MaterialTextures::AddToBucket(const Texture& texture, Entry* entry) {
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, texture.GetID());
+
+  GLint width = 0, height = 0, internal_format = 0, compressed = GL_FALSE;
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+  if (width <= 0 || height <= 0) {
+    return false;
+  }
+
+  std::vector<GLsizei> level_bytes;
+  int level_count = MipGenerator::GetLevelCount(width, height);
+  for (int level = 0; level < level_count; ++level) {
+    GLint level_width = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &level_width);
+    if (level_width == 0) {
+      break;
+    }
+
+    if (compressed) {
+      GLint size = 0;
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+      level_bytes.push_back(size);
+    } else {
+      GLenum format;
+      GLsizei texel_bytes;
+      GetClientFormat(internal_format, &format, &texel_bytes);
+      level_bytes.push_back(std::max(width >> level, 1) * std::max(height >> level, 1) * texel_bytes);
+    }
+  }
+
+  int bucket_index = -1;
+  for (std::size_t i = 0; i < buckets_.size(); ++i) {
+    auto& bucket = buckets_[i];
+    if (bucket.width == width && bucket.height == height && bucket.internal_format == (GLenum)internal_format &&
+        bucket.level_bytes == level_bytes) {
+      bucket_index = (int)i;
+      break;
+    }
+  }
+  if (bucket_index < 0) {
+    Bucket bucket;
+    bucket.width = width;
+    bucket.height = height;
+    bucket.internal_format = internal_format;
+    bucket.compressed = compressed == GL_TRUE;
+    bucket.level_bytes = level_bytes;
+    buckets_.push_back(bucket);
+    bucket_index = (int)buckets_.size() - 1;
+  }
+
+  auto& bucket = buckets_[bucket_index];
+  GLint layer;
+  if (!bucket.free_layers.empty()) {
+    layer = bucket.free_layers.back();
+    bucket.free_layers.pop_back();
+  } else {
+    if (bucket.used == bucket.capacity) {
+      Grow(bucket);
+    }
+    layer = bucket.used++;
+  }
+
+  CopyLayers(bucket, texture.GetID(), GL_TEXTURE_2D, bucket.array, layer, 1);
+
+  entry->bucket = bucket_index;
+  entry->layer = layer;
+  return true;
+}
+
+bool MaterialTextures::AddHandle(const Texture& texture, Entry* entry) {
+  GLint index;
+  if (!free_handles_.empty()) {
+    index = free_handles_.back();
+    free_handles_.pop_back();
+  } else if (handle_count_ < kMaxBindlessTextures) {
+    index = handle_count_++;
+  } else {
+    std::cout << "DongZhong: " << "Out of bindless texture slots" << std::endl;
+    return false;
+  }
+
+  // The texture's parameters are frozen from here on.
+  entry->handle = GLExtensions::GetTextureHandle(texture.GetID());
+  GLExtensions::MakeTextureHandleResident(entry->handle);
+  entry->layer = index;
+
+  handles_[index] = entry->handle;
+  handles_dirty_ = true;
+  return true;
+}
+
+void MaterialTextures::Grow(Bucket& bucket) {
+  GLsizei capacity = std::max<GLsizei>(bucket.capacity * 2, 4);
+
+  GLuint array;
+  glGenTextures(1, &array);
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D_ARRAY, array);
+
+  GLenum format;
+  GLsizei texel_bytes;
+  GetClientFormat(bucket.internal_format, &format, &texel_bytes);
+  for (std::size_t level = 0; level < bucket.level_bytes.size(); ++level) {
+    GLsizei width = std::max(bucket.width >> level, 1);
+    GLsizei height = std::max(bucket.height >> level, 1);
+    if (bucket.compressed) {
+      glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, bucket.internal_format, width, height, capacity,
+                             0, bucket.level_bytes[level] * capacity, nullptr);
+    } else {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, bucket.internal_format, width, height, capacity,
+                   0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)bucket.level_bytes.size() - 1);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  if (bucket.array != 0) {
+    CopyLayers(bucket, bucket.array, GL_TEXTURE_2D_ARRAY, array, 0, bucket.used);
+    GLStateCache::Get().OnTextureDeleted(bucket.array);
+    glDeleteTextures(1, &bucket.array);
+  }
+
+  bucket.array = array;
+  bucket.capacity = capacity;
+}
+
+void MaterialTextures::CopyLayers(Bucket& bucket, GLuint source, GLenum source_target, GLuint target,
+                                  GLint target_layer, GLsizei depth) {
+  if (depth == 0) {
+    return;
+  }
+
+  auto& state = GLStateCache::Get();
+  GLenum format;
+  GLsizei texel_bytes;
+  GetClientFormat(bucket.internal_format, &format, &texel_bytes);
+
+  std::vector<unsigned char> pixels;
+  for (std::size_t level = 0; level < bucket.level_bytes.size(); ++level) {
+    GLsizei width = std::max(bucket.width >> level, 1);
+    GLsizei height = std::max(bucket.height >> level, 1);
+
+    if (GLExtensions::has_copy_image) {
+      GLExtensions::CopyImageSubData(source, source_target, (GLint)level, 0, 0, 0,
+                                     target, GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, target_layer,
+                                     width, height, depth);
+      continue;
+    }
+
+    // GL 3.3 has no texture to texture copy, go through client memory.
+    pixels.resize((std::size_t)bucket.level_bytes[level] * depth);
+    state.BindTexture(GLStateCache::kScratchTextureUnit, source_target, source);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (bucket.compressed) {
+      glGetCompressedTexImage(source_target, (GLint)level, pixels.data());
+    } else {
+      glGetTexImage(source_target, (GLint)level, format, GL_UNSIGNED_BYTE, pixels.data());
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    state.BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D_ARRAY, target);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (bucket.compressed) {
+      glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, target_layer, width, height, depth,
+                                bucket.internal_format, (GLsizei)pixels.size(), pixels.data());
+    } else {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, target_layer, width, height, depth,
+                      format, GL_UNSIGNED_BYTE, pixels.data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+
+  ++copies_;
+}
+
+void MaterialTextures::Release(Entry& entry, bool texture_alive) {
+  if (entry.layer < 0) {
+    return;
+  }
+
+  if (bindless_) {
+    // Deleting a texture deletes its handles too.
+    if (texture_alive) {
+      GLExtensions::MakeTextureHandleNonResident(entry.handle);
+    }
+    handles_[entry.layer] = 0;
+    free_handles_.push_back(entry.layer);
+    handles_dirty_ = true;
+  } else {
+    buckets_[entry.bucket].free_layers.push_back(entry.layer);
+  }
+  entry.layer = -1;
+}
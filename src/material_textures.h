@@ -0,0 +1,109 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef MATERIAL_TEXTURES_H_
+#define MATERIAL_TEXTURES_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "shader.h"
+#include "texture.h"
+
+// Gathers material textures so draws don't need their own texture binds.
+// With ARB_bindless_texture every texture gets a resident handle in the
+// MaterialTextures uniform block. Otherwise textures are copied into
+// GL_TEXTURE_2D_ARRAY buckets, one per size and format, and a whole pass
+// over same sized textures needs a single bind. Either way a texture is
+// addressed by its layer: an array layer or an index into the handles.
+class MaterialTextures {
+ public:
+  struct Stats {
+    std::size_t textures = 0;
+    std::size_t buckets = 0;
+    std::size_t capacity = 0;
+    std::size_t copies = 0;
+    std::size_t gpu_bytes = 0;
+  };
+
+  // Size of the handle array in fragment_shader.fs.
+  static const GLint kMaxBindlessTextures = 256;
+
+  static MaterialTextures& Get();
+
+  bool IsBindless() const { return bindless_; }
+
+  // Defines selecting the sampling path in the material shaders.
+  ShaderDefines GetShaderDefines() const;
+
+  // Layer of |texture|, added on first use. -1 while the texture is still
+  // loading, while it's streamed and missing levels or when it can't be
+  // added. In array mode |array| receives the array to bind on
+  // GetTextureUnit().
+  GLint GetLayer(const std::shared_ptr<Texture>& texture, GLuint* array);
+
+  GLuint GetTextureUnit() const { return texture_unit_; }
+
+  // Frees the layers of textures nobody uses any more and uploads new
+  // handles. Call once per frame before drawing.
+  void Update();
+
+  // Deletes the GL objects. Call before the context goes away.
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  struct Bucket {
+    GLuint array = 0;
+    GLsizei width;
+    GLsizei height;
+    GLenum internal_format;
+    bool compressed;
+    // Bytes of one layer of every level.
+    std::vector<GLsizei> level_bytes;
+    GLsizei capacity = 0;
+    GLsizei used = 0;
+    std::vector<GLint> free_layers;
+  };
+
+  struct Entry {
+    std::weak_ptr<Texture> texture;
+    int bucket = -1;
+    GLint layer = -1;
+    GLuint64 handle = 0;
+  };
+
+  MaterialTextures();
+
+  bool AddToBucket(const Texture& texture, Entry* entry);
+  bool AddHandle(const Texture& texture, Entry* entry);
+
+  void Grow(Bucket& bucket);
+
+  // Copies |depth| layers of every level from |source| to |bucket|, on the
+  // GPU when ARB_copy_image is available and through client memory if not.
+  void CopyLayers(Bucket& bucket, GLuint source, GLenum source_target, GLuint target, GLint target_layer,
+                  GLsizei depth);
+
+  void Release(Entry& entry, bool texture_alive);
+
+  bool bindless_;
+  GLuint texture_unit_;
+
+  std::unordered_map<const Texture*, Entry> entries_;
+
+  std::vector<Bucket> buckets_;
+
+  GLuint handle_buffer_ = 0;
+  std::vector<GLuint64> handles_;
+  std::vector<GLint> free_handles_;
+  GLint handle_count_ = 0;
+  bool handles_dirty_ = false;
+
+  std::size_t copies_ = 0;
+};
+
+#endif // MATERIAL_TEXTURES_H_
@@ -0,0 +1,91 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "mesh.h"
+
+#include <cstring>
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices)
+    : vertices_(std::move(vertices)),
+      indices_(std::move(indices)) {
+  cache_report_ = MeshOptimizer::Optimize(&vertices_, &indices_, &triangle_sources_);
+  vertex_count_ = vertices_.size();
+  index_count_ = indices_.size();
+
+  glm::vec3 min(0.0f), max(0.0f);
+  if (!vertices_.empty()) {
+    min = max = vertices_[0].GetPosition();
+  }
+  for (auto& vertex : vertices_) {
+    min = glm::min(min, vertex.GetPosition());
+    max = glm::max(max, vertex.GetPosition());
+  }
+  bounding_center_ = (min + max) * 0.5f;
+  bounding_radius_ = glm::length(max - min) * 0.5f;
+
+  Upload();
+}
+
+Mesh::~Mesh() {
+  GeometryBuffer::Get().Free(handle_);
+}
+
+bool Mesh::Upload() {
+  if (!HasGeometry()) {
+    return false;
+  }
+
+  auto& geometry = GeometryBuffer::Get();
+  geometry.Free(handle_);
+  packed_vertices_ = geometry.IsPackedVertices();
+  if (packed_vertices_) {
+    auto packed = PackVertices(vertices_, &position_scale_, &position_offset_);
+    handle_ = geometry.Allocate(packed.data(), packed.size(), indices_.data(), indices_.size());
+  } else {
+    position_scale_ = glm::vec3(1.0f);
+    position_offset_ = glm::vec3(0.0f);
+    handle_ = geometry.Allocate(vertices_.data(), vertices_.size(), indices_.data(), indices_.size());
+  }
+  return true;
+}
+
+bool Mesh::HasSameTriangles(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) const {
+  if (!HasGeometry() || indices.size() != indices_.size()) {
+    return false;
+  }
+  // Walks the CPU copy and looks up where each triangle came from, the
+  // corners of a triangle stay in place.
+  for (std::size_t t = 0; t < triangle_sources_.size(); ++t) {
+    const GLuint* source = &indices[triangle_sources_[t] * 3];
+    for (int corner = 0; corner < 3; ++corner) {
+      if (source[corner] >= vertices.size() ||
+          std::memcmp(&vertices[source[corner]], &vertices_[indices_[t * 3 + corner]], sizeof(Vertex)) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void Mesh::ReleaseGeometry() {
+  std::vector<Vertex>().swap(vertices_);
+  std::vector<GLuint>().swap(indices_);
+  std::vector<GLuint>().swap(triangle_sources_);
+}
+
+std::size_t Mesh::GetGPUBytes() const {
+  return vertex_count_ * (packed_vertices_ ? sizeof(PackedVertex) : sizeof(Vertex)) +
+         index_count_ * sizeof(GLuint);
+}
+
+std::size_t Mesh::GetCPUBytes() const {
+  return vertices_.capacity() * sizeof(Vertex) + (indices_.capacity() + triangle_sources_.capacity()) * sizeof(GLuint);
+}
+
+void Mesh::Draw(const std::shared_ptr<Shader>& shader) const {
+  shader->SetVec3("position_scale", position_scale_);
+  shader->SetVec3("position_offset", position_offset_);
+  auto range = GetRange();
+  GeometryBuffer::Get().Bind(range.page);
+  glDrawElementsBaseVertex(GL_TRIANGLES, index_count_, GL_UNSIGNED_INT,
+                           (void*)(range.first_index * sizeof(GLuint)), range.base_vertex);
+}
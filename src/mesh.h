@@ -0,0 +1,87 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "geometry_buffer.h"
+#include "mesh_optimizer.h"
+#include "shader.h"
+#include "vertex.h"
+
+// Geometry on the GPU, shared by every Model drawing it. Lives in a range
+// of GeometryBuffer, which is freed together with it. Get meshes from
+// MeshCache rather than constructing them, so identical geometry is
+// uploaded once.
+class Mesh {
+ public:
+  // |vertices| and |indices| are reordered by MeshOptimizer first.
+  Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices);
+  ~Mesh();
+
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+
+  // Bounding sphere in object space.
+  glm::vec3 GetBoundingCenter() const { return bounding_center_; }
+  float GetBoundingRadius() const { return bounding_radius_; }
+
+  // Writes the geometry to GeometryBuffer in its current vertex format,
+  // after GeometryBuffer::SetPackedVertices(). Needs the CPU copy, returns
+  // false once it's released.
+  bool Upload();
+  bool IsPackedVertices() const { return packed_vertices_; }
+
+  // Frees the CPU copy of the geometry, only the buffers stay.
+  bool HasGeometry() const { return !vertices_.empty(); }
+  void ReleaseGeometry();
+
+  // Whether |vertices| and |indices| describe the triangles of the CPU
+  // copy, in the order the constructor got them. Needs the CPU copy.
+  bool HasSameTriangles(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) const;
+
+  std::size_t GetVertexCount() const { return vertex_count_; }
+  std::size_t GetIndexCount() const { return index_count_; }
+  std::size_t GetTriangleCount() const { return index_count_ / 3; }
+  std::size_t GetGPUBytes() const;
+  std::size_t GetCPUBytes() const;
+
+  // Where the geometry is now, GeometryBuffer::Update() may move it.
+  GeometryBuffer::Range GetRange() const { return GeometryBuffer::Get().GetRange(handle_); }
+
+  // Dequantisation of packed positions, identity for float ones.
+  glm::vec3 GetPositionScale() const { return position_scale_; }
+  glm::vec3 GetPositionOffset() const { return position_offset_; }
+
+  // Vertex cache efficiency before and after the constructor reordered the
+  // geometry.
+  const MeshOptimizer::Report& GetCacheReport() const { return cache_report_; }
+
+  // Sets the dequantisation uniforms of |shader| too.
+  void Draw(const std::shared_ptr<Shader>& shader) const;
+
+ private:
+  std::vector<Vertex> vertices_;
+  std::vector<GLuint> indices_;
+  // Input triangle of every triangle in |indices_|, released with them.
+  std::vector<GLuint> triangle_sources_;
+  std::size_t vertex_count_;
+  std::size_t index_count_;
+  MeshOptimizer::Report cache_report_;
+
+  GeometryBuffer::Handle handle_ = GeometryBuffer::kInvalidHandle;
+
+  bool packed_vertices_ = false;
+  glm::vec3 position_scale_;
+  glm::vec3 position_offset_;
+
+  glm::vec3 bounding_center_;
+  float bounding_radius_;
+};
+
+#endif // MESH_H_
@@ -0,0 +1,139 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "mesh_cache.h"
+
+#include <iostream>
+
+#include "geometry_buffer.h"
+#include "hash.h"
+
+MeshCache& MeshCache::Get() {
+  static MeshCache cache;
+  return cache;
+}
+
+std::shared_ptr<Mesh> MeshCache::GetMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+  ++stats_.requests;
+
+  std::uint64_t hash = HashBytes(vertices.data(), vertices.size() * sizeof(Vertex));
+  hash = HashBytes(indices.data(), indices.size() * sizeof(GLuint), hash);
+
+  auto& meshes = meshes_[Key{hash, vertices.size(), indices.size()}];
+  for (auto& mesh : meshes) {
+    if (!mesh->HasGeometry() || mesh->HasSameTriangles(vertices, indices)) {
+      ++stats_.hits;
+      return mesh;
+    }
+  }
+  if (!meshes.empty()) {
+    std::cout << "DongZhong: " << "Mesh hash collision, " << vertices.size() << " vertices and "
+              << indices.size() << " indices" << std::endl;
+    ++stats_.collisions;
+  }
+
+  auto mesh = std::make_shared<Mesh>(vertices, indices);
+  if (release_geometry_) {
+    mesh->ReleaseGeometry();
+  }
+  meshes.push_back(mesh);
+  ++stats_.uploads;
+  return mesh;
+}
+
+bool MeshCache::IsPackedVertices() const {
+  return GeometryBuffer::Get().IsPackedVertices();
+}
+
+bool MeshCache::SetPackedVertices(bool packed_vertices) {
+  auto& geometry = GeometryBuffer::Get();
+  if (packed_vertices == geometry.IsPackedVertices()) {
+    return true;
+  }
+  if (release_geometry_) {
+    return false;
+  }
+  geometry.SetPackedVertices(packed_vertices);
+  for (auto&& [key, meshes] : meshes_) {
+    for (auto& mesh : meshes) {
+      mesh->Upload();
+    }
+  }
+  return true;
+}
+
+void MeshCache::ReleaseGeometry() {
+  release_geometry_ = true;
+  for (auto&& [key, meshes] : meshes_) {
+    for (auto& mesh : meshes) {
+      mesh->ReleaseGeometry();
+    }
+  }
+}
+
+std::size_t MeshCache::EvictUnused() {
+  std::size_t freed_bytes = 0;
+  for (auto iter = meshes_.begin(); iter != meshes_.end();) {
+    auto& meshes = iter->second;
+    for (auto mesh = meshes.begin(); mesh != meshes.end();) {
+      if (mesh->use_count() == 1) {
+        freed_bytes += (*mesh)->GetGPUBytes();
+        ++stats_.evicted;
+        mesh = meshes.erase(mesh);
+      } else {
+        ++mesh;
+      }
+    }
+    if (meshes.empty()) {
+      iter = meshes_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  return freed_bytes;
+}
+
+void MeshCache::Clear() {
+  meshes_.clear();
+}
+
+MeshCache::Usage MeshCache::GetUsage() const {
+  Usage usage;
+  double transformed_before = 0.0, transformed_after = 0.0;
+  for (auto&& [key, meshes] : meshes_) {
+    for (auto& mesh : meshes) {
+      // The cache's own reference doesn't count as an instance.
+      std::size_t instances = mesh.use_count() - 1;
+      ++usage.meshes;
+      usage.instances += instances;
+      usage.vertices += mesh->GetVertexCount();
+      usage.triangles += mesh->GetTriangleCount();
+      usage.gpu_bytes += mesh->GetGPUBytes();
+      usage.unshared_gpu_bytes += mesh->GetGPUBytes() * instances;
+      usage.cpu_bytes += mesh->GetCPUBytes();
+
+      const auto& report = mesh->GetCacheReport();
+      transformed_before += report.before.acmr * mesh->GetTriangleCount();
+      transformed_after += report.after.acmr * mesh->GetTriangleCount();
+    }
+  }
+
+  if (usage.triangles > 0) {
+    usage.cache.before.acmr = transformed_before / usage.triangles;
+    usage.cache.after.acmr = transformed_after / usage.triangles;
+  }
+  if (usage.vertices > 0) {
+    usage.cache.before.atvr = transformed_before / usage.vertices;
+    usage.cache.after.atvr = transformed_after / usage.vertices;
+  }
+  return usage;
+}
+
+void MeshCache::PrintReport() const {
+  auto usage = GetUsage();
+  std::cout << "DongZhong: " << "Mesh cache: "
+            << stats_.requests << " requests, " << stats_.hits << " hits, "
+            << stats_.uploads << " uploads, " << stats_.evicted << " evicted, " << stats_.collisions << " collisions, "
+            << usage.meshes << " resident for " << usage.instances << " instances ("
+            << usage.gpu_bytes / 1024 << " KB on the GPU instead of " << usage.unshared_gpu_bytes / 1024
+            << " KB, " << usage.cpu_bytes / 1024 << " KB on the CPU)" << std::endl;
+}
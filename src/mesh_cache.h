@@ -0,0 +1,100 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+
+// Shares meshes by content: requesting geometry already uploaded returns
+// the same Mesh, so models built from the same vertices cost one set of
+// buffers. Entries nobody else references any more are dropped by
+// EvictUnused().
+//
+// Meshes are found by a hash of their geometry. While a mesh still has its
+// CPU copy a hit is confirmed triangle by triangle, and colliding geometry
+// is kept next to it under the same key. After ReleaseGeometry() only
+// hashes and sizes are compared, and a collision would return another
+// model's geometry.
+class MeshCache {
+ public:
+  struct Stats {
+    std::size_t requests = 0;
+    std::size_t hits = 0;
+    std::size_t uploads = 0;
+    std::size_t evicted = 0;
+    // Hash hits whose geometry turned out different.
+    std::size_t collisions = 0;
+  };
+
+  // Over the meshes resident now.
+  struct Usage {
+    std::size_t meshes = 0;
+    std::size_t instances = 0;
+    std::size_t vertices = 0;
+    std::size_t triangles = 0;
+    std::size_t gpu_bytes = 0;
+    // What one copy per instance would take.
+    std::size_t unshared_gpu_bytes = 0;
+    std::size_t cpu_bytes = 0;
+    // Triangle and vertex weighted, see MeshOptimizer::CacheStats.
+    MeshOptimizer::Report cache;
+  };
+
+  static MeshCache& Get();
+
+  std::shared_ptr<Mesh> GetMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+
+  // Vertex format of every mesh, see GeometryBuffer. Switching uploads all
+  // meshes again, so it needs their CPU geometry.
+  bool IsPackedVertices() const;
+  bool SetPackedVertices(bool packed_vertices);
+
+  // Frees the CPU geometry of every mesh, and of later ones right after
+  // upload. Their vertex format is fixed from then on.
+  bool IsGeometryReleased() const { return release_geometry_; }
+  void ReleaseGeometry();
+
+  // Frees meshes only the cache still holds. Returns the bytes released.
+  std::size_t EvictUnused();
+
+  // Drops every entry. Call before the context goes away.
+  void Clear();
+
+  Stats GetStats() const { return stats_; }
+  Usage GetUsage() const;
+
+  void PrintReport() const;
+
+ private:
+  // Hashes can collide, the sizes make it even less likely. GetMesh()
+  // checks the geometry where it can.
+  struct Key {
+    std::uint64_t hash;
+    std::size_t vertex_count;
+    std::size_t index_count;
+
+    bool operator<(const Key& other) const {
+      return std::tie(hash, vertex_count, index_count) <
+             std::tie(other.hash, other.vertex_count, other.index_count);
+    }
+  };
+
+  MeshCache() = default;
+
+  // More than one mesh only on hash collisions.
+  std::map<Key, std::vector<std::shared_ptr<Mesh>>> meshes_;
+
+  bool release_geometry_ = false;
+
+  Stats stats_;
+};
+
+#endif // MESH_CACHE_H_
@@ -0,0 +1,301 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <deque>
+
+// FIFO cache, returns the number of misses of one triangle.
+class CacheSimulator {
+ public:
+  CacheSimulator(std::size_t vertex_count, int cache_size)
+      : cache_size_(cache_size), timestamps_(vertex_count, 0) {}
+
+  void Reset() { time_ += cache_size_ + 1; }
+
+  int Add(const GLuint* triangle) {
+    int misses = 0;
+    for (int i = 0; i < 3; ++i) {
+      GLuint v = triangle[i];
+      if (time_ - timestamps_[v] > static_cast<unsigned>(cache_size_)) {
+        timestamps_[v] = time_++;
+        ++misses;
+      }
+    }
+    return misses;
+  }
+
+ private:
+  int cache_size_;
+  // Starts past any cache size so that every vertex misses first.
+  unsigned time_ = 1u << 16;
+  std::vector<unsigned> timestamps_;
+};
+
+MeshOptimizer::Report MeshOptimizer::Optimize(std::vector<Vertex>* vertices, std::vector<GLuint>* indices,
+                                              std::vector<GLuint>* triangle_sources) {
+  Report report;
+  report.before = AnalyzeVertexCache(*indices, vertices->size());
+
+  std::vector<std::size_t> clusters;
+  *indices = OptimizeVertexCache(*indices, vertices->size(), kCacheSize, &clusters, triangle_sources);
+  *indices = OptimizeOverdraw(*indices, *vertices, clusters, triangle_sources);
+  OptimizeVertexFetch(vertices, indices);
+
+  report.after = AnalyzeVertexCache(*indices, vertices->size());
+  return report;
+}
+
+std::vector<GLuint> MeshOptimizer::OptimizeVertexCache(const std::vector<GLuint>& indices,
+                                                       std::size_t vertex_count, int cache_size,
+                                                       std::vector<std::size_t>* clusters,
+                                                       std::vector<GLuint>* triangle_sources) {
+  const std::size_t triangle_count = indices.size() / 3;
+  std::vector<GLuint> result;
+  result.reserve(triangle_count * 3);
+  if (clusters) {
+    clusters->clear();
+  }
+  if (triangle_sources) {
+    triangle_sources->clear();
+    triangle_sources->reserve(triangle_count);
+  }
+  if (triangle_count == 0) {
+    return result;
+  }
+
+  // Triangles around every vertex, and how many of them are still to be
+  // emitted.
+  std::vector<int> live(vertex_count, 0);
+  for (std::size_t i = 0; i < triangle_count * 3; ++i) {
+    ++live[indices[i]];
+  }
+  std::vector<std::size_t> adjacency_offsets(vertex_count + 1, 0);
+  for (std::size_t v = 0; v < vertex_count; ++v) {
+    adjacency_offsets[v + 1] = adjacency_offsets[v] + live[v];
+  }
+  std::vector<GLuint> adjacency(adjacency_offsets[vertex_count]);
+  std::vector<std::size_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+  for (std::size_t t = 0; t < triangle_count; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      adjacency[fill[indices[t * 3 + k]]++] = static_cast<GLuint>(t);
+    }
+  }
+
+  std::vector<int> timestamps(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<GLuint> dead_ends;
+  std::vector<GLuint> candidates;
+  int time = cache_size + 1;
+  std::size_t cursor = 0;
+  int fan = indices[0];
+  bool new_cluster = true;
+
+  while (fan >= 0) {
+    candidates.clear();
+    for (std::size_t a = adjacency_offsets[fan]; a < adjacency_offsets[fan + 1]; ++a) {
+      GLuint t = adjacency[a];
+      if (emitted[t]) {
+        continue;
+      }
+      if (new_cluster && clusters) {
+        clusters->push_back(result.size() / 3);
+      }
+      new_cluster = false;
+      for (int k = 0; k < 3; ++k) {
+        GLuint v = indices[t * 3 + k];
+        result.push_back(v);
+        dead_ends.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - timestamps[v] > cache_size) {
+          timestamps[v] = time++;
+        }
+      }
+      emitted[t] = true;
+      if (triangle_sources) {
+        triangle_sources->push_back(t);
+      }
+    }
+
+    // The candidate still in the cache after fanning it, with the oldest
+    // entry, wins. Otherwise the cache is lost and a new cluster starts.
+    fan = -1;
+    int best = -1;
+    for (GLuint v : candidates) {
+      if (live[v] <= 0) {
+        continue;
+      }
+      int priority = 0;
+      if (time - timestamps[v] + 2 * live[v] <= cache_size) {
+        priority = time - timestamps[v];
+      }
+      if (priority > best) {
+        best = priority;
+        fan = static_cast<int>(v);
+      }
+    }
+    if (fan >= 0) {
+      continue;
+    }
+    new_cluster = true;
+    while (!dead_ends.empty()) {
+      GLuint v = dead_ends.back();
+      dead_ends.pop_back();
+      if (live[v] > 0) {
+        fan = static_cast<int>(v);
+        break;
+      }
+    }
+    while (fan < 0 && cursor < vertex_count) {
+      if (live[cursor] > 0) {
+        fan = static_cast<int>(cursor);
+      }
+      ++cursor;
+    }
+  }
+  return result;
+}
+
+std::vector<GLuint> MeshOptimizer::OptimizeOverdraw(const std::vector<GLuint>& indices,
+                                                    const std::vector<Vertex>& vertices,
+                                                    const std::vector<std::size_t>& clusters,
+                                                    std::vector<GLuint>* triangle_sources, float threshold) {
+  const std::size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0 || clusters.empty()) {
+    return indices;
+  }
+
+  // Tipsify only cuts where the cache is lost, which leaves few and large
+  // clusters. Split them further wherever the triangles so far already
+  // reach the cluster's ACMR; a fresh cache there costs little.
+  std::vector<std::size_t> boundaries;
+  CacheSimulator cache(vertices.size(), kCacheSize);
+  for (std::size_t c = 0; c < clusters.size(); ++c) {
+    std::size_t begin = clusters[c];
+    std::size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+
+    cache.Reset();
+    int misses = 0;
+    for (std::size_t t = begin; t < end; ++t) {
+      misses += cache.Add(&indices[t * 3]);
+    }
+    float limit = static_cast<float>(misses) / (end - begin) * threshold;
+
+    cache.Reset();
+    boundaries.push_back(begin);
+    std::size_t start = begin;
+    misses = 0;
+    for (std::size_t t = begin; t < end; ++t) {
+      misses += cache.Add(&indices[t * 3]);
+      if (t + 1 < end && static_cast<float>(misses) / (t - start + 1) <= limit) {
+        start = t + 1;
+        boundaries.push_back(start);
+        misses = 0;
+        cache.Reset();
+      }
+    }
+  }
+
+  glm::vec3 mesh_center(0.0f);
+  float mesh_area = 0.0f;
+  struct Cluster {
+    std::size_t begin;
+    std::size_t end;
+    float sort_key;
+  };
+  std::vector<Cluster> sorted;
+  std::vector<glm::vec3> centers;
+  std::vector<glm::vec3> normals;
+  for (std::size_t c = 0; c < boundaries.size(); ++c) {
+    std::size_t begin = boundaries[c];
+    std::size_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : triangle_count;
+    glm::vec3 center(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (std::size_t t = begin; t < end; ++t) {
+      glm::vec3 p0 = vertices[indices[t * 3]].GetPosition();
+      glm::vec3 p1 = vertices[indices[t * 3 + 1]].GetPosition();
+      glm::vec3 p2 = vertices[indices[t * 3 + 2]].GetPosition();
+      glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+      float a = glm::length(n) * 0.5f;
+      center += (p0 + p1 + p2) * (a / 3.0f);
+      normal += n;
+      area += a;
+    }
+    mesh_center += center;
+    mesh_area += area;
+    centers.push_back(area > 0.0f ? center / area : vertices[indices[begin * 3]].GetPosition());
+    float length = glm::length(normal);
+    normals.push_back(length > 0.0f ? normal / length : glm::vec3(0.0f));
+    sorted.push_back({begin, end, 0.0f});
+  }
+  if (mesh_area > 0.0f) {
+    mesh_center /= mesh_area;
+  }
+
+  // Clusters far out along their own normal are likely in front of the rest
+  // of the mesh from every direction they are visible from.
+  for (std::size_t c = 0; c < sorted.size(); ++c) {
+    sorted[c].sort_key = glm::dot(centers[c] - mesh_center, normals[c]);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+  std::vector<GLuint> result;
+  result.reserve(indices.size());
+  for (const Cluster& cluster : sorted) {
+    result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+  }
+  if (triangle_sources) {
+    std::vector<GLuint> sources;
+    sources.reserve(triangle_count);
+    for (const Cluster& cluster : sorted) {
+      sources.insert(sources.end(), triangle_sources->begin() + cluster.begin,
+                     triangle_sources->begin() + cluster.end);
+    }
+    *triangle_sources = std::move(sources);
+  }
+  return result;
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<GLuint>* indices) {
+  const GLuint kUnused = ~0u;
+  std::vector<GLuint> remap(vertices->size(), kUnused);
+  std::vector<Vertex> result;
+  result.reserve(vertices->size());
+  for (GLuint& index : *indices) {
+    if (remap[index] == kUnused) {
+      remap[index] = static_cast<GLuint>(result.size());
+      result.push_back((*vertices)[index]);
+    }
+    index = remap[index];
+  }
+  *vertices = std::move(result);
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<GLuint>& indices,
+                                                            std::size_t vertex_count, int cache_size) {
+  CacheStats stats;
+  const std::size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return stats;
+  }
+
+  CacheSimulator cache(vertex_count, cache_size);
+  std::vector<bool> referenced(vertex_count, false);
+  std::size_t misses = 0;
+  std::size_t unique = 0;
+  for (std::size_t t = 0; t < triangle_count; ++t) {
+    misses += cache.Add(&indices[t * 3]);
+    for (int k = 0; k < 3; ++k) {
+      if (!referenced[indices[t * 3 + k]]) {
+        referenced[indices[t * 3 + k]] = true;
+        ++unique;
+      }
+    }
+  }
+  stats.acmr = static_cast<float>(misses) / triangle_count;
+  stats.atvr = static_cast<float>(misses) / unique;
+  return stats;
+}
@@ -0,0 +1,66 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "vertex.h"
+
+// Reorders triangle lists before upload, GL free so it runs headless:
+//  1. Tipsify (Sander et al. 2007) orders triangles for the post-transform
+//     vertex cache and cuts the result into clusters.
+//  2. Clusters are sorted so outward facing ones on the outside of the mesh
+//     come first, which lets them occlude the rest and reduces overdraw.
+//  3. Vertices are renumbered in order of first use, so fetches walk the
+//     vertex buffer linearly. Unreferenced vertices are dropped.
+class MeshOptimizer {
+ public:
+  // Simulated FIFO cache.
+  struct CacheStats {
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is
+    // the ideal for large grids, 3 the worst.
+    float acmr = 0.0f;
+    // Average transform to vertex ratio, transformed per referenced vertex.
+    // 1 is the ideal.
+    float atvr = 0.0f;
+  };
+
+  struct Report {
+    CacheStats before;
+    CacheStats after;
+  };
+
+  static const int kCacheSize = 16;
+
+  // Runs all three stages. |triangle_sources| receives the input triangle
+  // every output triangle came from; their corners keep their order.
+  static Report Optimize(std::vector<Vertex>* vertices, std::vector<GLuint>* indices,
+                         std::vector<GLuint>* triangle_sources = nullptr);
+
+  // Tipsify. |clusters| receives the first triangle of every cluster,
+  // |triangle_sources| the input triangle of every output one.
+  static std::vector<GLuint> OptimizeVertexCache(const std::vector<GLuint>& indices, std::size_t vertex_count,
+                                                 int cache_size = kCacheSize,
+                                                 std::vector<std::size_t>* clusters = nullptr,
+                                                 std::vector<GLuint>* triangle_sources = nullptr);
+
+  // Sorts the |clusters| of |indices|, keeping the triangle order inside
+  // each. |triangle_sources| is reordered along with the triangles when
+  // given. |threshold| is how much worse than the cluster's own ACMR a split
+  // cluster may get.
+  static std::vector<GLuint> OptimizeOverdraw(const std::vector<GLuint>& indices,
+                                              const std::vector<Vertex>& vertices,
+                                              const std::vector<std::size_t>& clusters,
+                                              std::vector<GLuint>* triangle_sources = nullptr,
+                                              float threshold = 1.05f);
+
+  static void OptimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<GLuint>* indices);
+
+  static CacheStats AnalyzeVertexCache(const std::vector<GLuint>& indices, std::size_t vertex_count,
+                                       int cache_size = kCacheSize);
+};
+
+#endif // MESH_OPTIMIZER_H_
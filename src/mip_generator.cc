@@ -0,0 +1,419 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+// AVX is picked at run time, so the default build uses it too.
+#if defined(MIP_GENERATOR_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define MIP_GENERATOR_AVX
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MIP_GENERATOR_AVX_TARGET
+#else
+#define MIP_GENERATOR_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif
+
+const int kMaxTaps = 8;
+const int kEncodeTableSize = 16384;
+// Smaller levels aren't worth handing to the pool.
+const std::size_t kParallelTexels = 64 * 1024;
+
+struct Kernel {
+  int tap_count;
+  // Source texel of tap k for destination texel x is 2x + first_offset + k.
+  int first_offset;
+  float weights[kMaxTaps];
+};
+
+// Zeroth order modified Bessel function of the first kind.
+double BesselI0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 32; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+Kernel MakeKernel(MipGenerator::Filter filter) {
+  Kernel kernel;
+  if (filter == MipGenerator::Filter::kBox) {
+    kernel.tap_count = 2;
+    kernel.first_offset = 0;
+    kernel.weights[0] = kernel.weights[1] = 0.5f;
+    return kernel;
+  }
+
+  // Taps sit 0.5, 1.5, 2.5 and 3.5 source texels either side of the
+  // destination centre, i.e. up to 1.75 destination texels away.
+  const double kAlpha = 4.0;
+  const double kRadius = 2.0;
+  const double kPi = 3.14159265358979323846;
+  kernel.tap_count = 8;
+  kernel.first_offset = -3;
+  double weights[kMaxTaps];
+  double sum = 0.0;
+  for (int k = 0; k < 8; ++k) {
+    double t = (k - 3.5) / 2.0;
+    double sinc = std::sin(kPi * t) / (kPi * t);
+    double ratio = t / kRadius;
+    double window = BesselI0(kAlpha * std::sqrt(1.0 - ratio * ratio)) / BesselI0(kAlpha);
+    weights[k] = sinc * window;
+    sum += weights[k];
+  }
+  for (int k = 0; k < 8; ++k) {
+    kernel.weights[k] = (float)(weights[k] / sum);
+  }
+  return kernel;
+}
+
+const std::array<float, 256>& GetDecodeTable() {
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> values;
+    for (int i = 0; i < 256; ++i) {
+      double c = i / 255.0;
+      values[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+    return values;
+  }();
+  return table;
+}
+
+const std::array<unsigned char, kEncodeTableSize>& GetEncodeTable() {
+  static const std::array<unsigned char, kEncodeTableSize> table = [] {
+    std::array<unsigned char, kEncodeTableSize> values;
+    for (int i = 0; i < kEncodeTableSize; ++i) {
+      double l = (double)i / (kEncodeTableSize - 1);
+      double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+      values[i] = (unsigned char)std::lround(std::clamp(c, 0.0, 1.0) * 255.0);
+    }
+    return values;
+  }();
+  return table;
+}
+
+bool HasAvx() {
+#if defined(MIP_GENERATOR_AVX) && defined(_MSC_VER) && !defined(__clang__)
+  // AVX and OSXSAVE, and the OS saving the YMM registers.
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+#elif defined(MIP_GENERATOR_AVX)
+  return __builtin_cpu_supports("avx");
+#else
+  return false;
+#endif
+}
+
+bool UseAvx() {
+  static const bool use_avx = HasAvx();
+  return use_avx;
+}
+
+void ForEachRow(ThreadPool* pool, int rows, std::size_t texels,
+                const std::function<void(std::size_t, std::size_t)>& body) {
+  if (pool && texels >= kParallelTexels) {
+    pool->ParallelFor(rows, body);
+  } else {
+    body(0, rows);
+  }
+}
+
+#if defined(MIP_GENERATOR_AVX)
+// AccumulateRows() eight floats at a time, returns how many it did.
+MIP_GENERATOR_AVX_TARGET std::size_t AccumulateRowsAvx(const float* const* rows, const float* weights,
+                                                       int tap_count, float* out, std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(rows[0] + i));
+    for (int k = 1; k < tap_count; ++k) {
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+    }
+    _mm256_storeu_ps(out + i, sum);
+  }
+  return i;
+}
+
+// FilterSpan() with the same tap of two neighbouring output texels in one
+// register. Their source texels are two apart, so a pair of loads covers
+// two taps. |tap_count| is even.
+MIP_GENERATOR_AVX_TARGET int FilterSpanAvx(const float* row, const Kernel& kernel, int x_begin, int x_end,
+                                           float* out) {
+  __m256 weights[kMaxTaps];
+  for (int k = 0; k < kernel.tap_count; ++k) {
+    weights[k] = _mm256_set1_ps(kernel.weights[k]);
+  }
+
+  int x = x_begin;
+  for (; x + 2 <= x_end; x += 2) {
+    const float* taps = row + (2 * x + kernel.first_offset) * 4;
+    __m256 low = _mm256_loadu_ps(taps);
+    __m256 high = _mm256_loadu_ps(taps + 8);
+    __m256 sum = _mm256_mul_ps(weights[0], _mm256_permute2f128_ps(low, high, 0x20));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(weights[1], _mm256_permute2f128_ps(low, high, 0x31)));
+    for (int k = 2; k < kernel.tap_count; k += 2) {
+      low = _mm256_loadu_ps(taps + k * 4);
+      high = _mm256_loadu_ps(taps + k * 4 + 8);
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(weights[k], _mm256_permute2f128_ps(low, high, 0x20)));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(weights[k + 1], _mm256_permute2f128_ps(low, high, 0x31)));
+    }
+    _mm256_storeu_ps(out + x * 4, sum);
+  }
+  return x;
+}
+#endif
+
+// out[i] = sum over taps of weights[k] * rows[k][i], for |count| floats.
+void AccumulateRows(const float* const* rows, const float* weights, int tap_count, float* out, std::size_t count) {
+  std::size_t i = 0;
+#if defined(MIP_GENERATOR_AVX)
+  if (UseAvx()) {
+    i = AccumulateRowsAvx(rows, weights, tap_count, out, count);
+  }
+#endif
+#if defined(MIP_GENERATOR_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+    for (int k = 1; k < tap_count; ++k) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+    }
+    _mm_storeu_ps(out + i, sum);
+  }
+#endif
+  for (; i < count; ++i) {
+    float sum = weights[0] * rows[0][i];
+    for (int k = 1; k < tap_count; ++k) {
+      float product = weights[k] * rows[k][i];
+      sum = sum + product;
+    }
+    out[i] = sum;
+  }
+}
+
+// Output texels [x_begin, x_end) of one row of the horizontal pass, all of
+// whose taps lie inside |row|. Returns where it stopped; the rest is left
+// to the caller.
+int FilterSpan(const float* row, const Kernel& kernel, int x_begin, int x_end, float* out) {
+  int x = x_begin;
+#if defined(MIP_GENERATOR_AVX)
+  if (UseAvx()) {
+    x = FilterSpanAvx(row, kernel, x, x_end, out);
+  }
+#endif
+#if defined(MIP_GENERATOR_SSE2)
+  __m128 weights[kMaxTaps];
+  for (int k = 0; k < kernel.tap_count; ++k) {
+    weights[k] = _mm_set1_ps(kernel.weights[k]);
+  }
+  for (; x + 2 <= x_end; x += 2) {
+    const float* taps = row + (2 * x + kernel.first_offset) * 4;
+    __m128 sum0 = _mm_mul_ps(weights[0], _mm_loadu_ps(taps));
+    __m128 sum1 = _mm_mul_ps(weights[0], _mm_loadu_ps(taps + 8));
+    for (int k = 1; k < kernel.tap_count; ++k) {
+      sum0 = _mm_add_ps(sum0, _mm_mul_ps(weights[k], _mm_loadu_ps(taps + k * 4)));
+      sum1 = _mm_add_ps(sum1, _mm_mul_ps(weights[k], _mm_loadu_ps(taps + k * 4 + 8)));
+    }
+    _mm_storeu_ps(out + x * 4, sum0);
+    _mm_storeu_ps(out + x * 4 + 4, sum1);
+  }
+#endif
+  return x;
+}
+
+// One row of the horizontal pass, halving |width| RGBA float texels.
+// Output texels [inner_begin, inner_end) have all their taps inside |row|.
+void FilterRow(const float* row, int width, const Kernel& kernel, int inner_begin, int inner_end, float* out) {
+  int out_width = std::max(width / 2, 1);
+  if (width == 1) {
+    std::memcpy(out, row, 4 * sizeof(float));
+    return;
+  }
+
+  int inner = FilterSpan(row, kernel, inner_begin, inner_end, out);
+  const float* taps[kMaxTaps];
+  for (int x = 0; x < out_width; ++x) {
+    if (x == inner_begin) {
+      x = inner;
+      if (x >= out_width) {
+        break;
+      }
+    }
+    for (int k = 0; k < kernel.tap_count; ++k) {
+      int source_x = std::clamp(2 * x + kernel.first_offset + k, 0, width - 1);
+      taps[k] = row + source_x * 4;
+    }
+    AccumulateRows(taps, kernel.weights, kernel.tap_count, out + x * 4, 4);
+  }
+}
+
+// Halves |width| x |height| RGBA float texels into |out|. |get_row(y,
+// buffer)| returns source row y, converted into |buffer| if it has to be.
+// Each worker keeps the rows it filtered horizontally in a ring of
+// |kernel.tap_count| rows, which the vertical pass reads while they're
+// still in the cache.
+template <typename GetRow>
+void Downsample(const GetRow& get_row, int width, int height, const Kernel& kernel, std::vector<float>& out,
+                ThreadPool* pool) {
+  int out_width = std::max(width / 2, 1);
+  int out_height = std::max(height / 2, 1);
+  std::size_t out_row_floats = (std::size_t)out_width * 4;
+  out.resize(out_row_floats * out_height);
+
+  int inner_begin = std::min((1 - kernel.first_offset) / 2, out_width);
+  int inner_end = inner_begin;
+  if (width - kernel.tap_count - kernel.first_offset >= 0) {
+    inner_end = std::clamp((width - kernel.tap_count - kernel.first_offset) / 2 + 1, inner_begin, out_width);
+  }
+
+  ForEachRow(pool, out_height, (std::size_t)width * height, [&](std::size_t begin, std::size_t end) {
+    std::vector<float> buffer;
+    if (height == 1) {
+      FilterRow(get_row(0, buffer), width, kernel, inner_begin, inner_end, out.data());
+      return;
+    }
+
+    int ring_size = kernel.tap_count;
+    std::vector<float> ring(out_row_floats * ring_size);
+    std::vector<int> ring_rows(ring_size, -1);
+    const float* taps[kMaxTaps];
+    for (std::size_t y = begin; y < end; ++y) {
+      for (int k = 0; k < kernel.tap_count; ++k) {
+        int source_y = std::clamp(2 * (int)y + kernel.first_offset + k, 0, height - 1);
+        int slot = source_y % ring_size;
+        float* filtered = ring.data() + slot * out_row_floats;
+        if (ring_rows[slot] != source_y) {
+          FilterRow(get_row(source_y, buffer), width, kernel, inner_begin, inner_end, filtered);
+          ring_rows[slot] = source_y;
+        }
+        taps[k] = filtered;
+      }
+      AccumulateRows(taps, kernel.weights, kernel.tap_count, out.data() + y * out_row_floats, out_row_floats);
+    }
+  });
+}
+
+void Encode(const std::vector<float>& texels, int channels, bool srgb, std::vector<unsigned char>& out,
+            ThreadPool* pool) {
+  auto& table = GetEncodeTable();
+  std::size_t count = texels.size() / 4;
+  out.resize(count * channels);
+
+  // Colour of sRGB images goes through |table|, the rest is scaled to bytes.
+  bool use_table[4] = {false, false, false, false};
+  float scales[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+  for (int c = 0; c < 3 && srgb; ++c) {
+    use_table[c] = true;
+    scales[c] = kEncodeTableSize - 1;
+  }
+
+  const std::size_t kRowTexels = 4096;
+  int rows = (int)((count + kRowTexels - 1) / kRowTexels);
+  ForEachRow(pool, rows, count, [&](std::size_t begin, std::size_t end) {
+    std::size_t last = std::min(end * kRowTexels, count);
+#if defined(MIP_GENERATOR_SSE2)
+    __m128 scale = _mm_loadu_ps(scales);
+#endif
+    for (std::size_t i = begin * kRowTexels; i < last; ++i) {
+      int values[4];
+#if defined(MIP_GENERATOR_SSE2)
+      __m128 texel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texels.data() + i * 4), _mm_setzero_ps()),
+                                _mm_set1_ps(1.0f));
+      texel = _mm_add_ps(_mm_mul_ps(texel, scale), _mm_set1_ps(0.5f));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(values), _mm_cvttps_epi32(texel));
+#else
+      for (int c = 0; c < 4; ++c) {
+        values[c] = (int)(std::clamp(texels[i * 4 + c], 0.0f, 1.0f) * scales[c] + 0.5f);
+      }
+#endif
+      unsigned char* texel_out = out.data() + i * channels;
+      for (int c = 0; c < channels; ++c) {
+        texel_out[c] = use_table[c] ? table[values[c]] : (unsigned char)values[c];
+      }
+    }
+  });
+}
+
+int MipGenerator::GetLevelCount(int width, int height) {
+  int levels = 1;
+  while (width > 1 || height > 1) {
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+    ++levels;
+  }
+  return levels;
+}
+
+std::vector<std::vector<unsigned char>> MipGenerator::GenerateChain(const unsigned char* pixels,
+                                                                    int width, int height, int channels,
+                                                                    bool srgb, Filter filter,
+                                                                    ThreadPool* pool) {
+  srgb = srgb && channels >= 3;
+  Kernel kernel = MakeKernel(filter);
+
+  std::vector<std::vector<unsigned char>> levels;
+  levels.emplace_back(pixels, pixels + (std::size_t)width * height * channels);
+
+  // Level 0 is converted to float a row at a time, as the first
+  // horizontal pass reads it. Each further level is filtered from the
+  // previous one at full float precision.
+  std::array<float, 256> linear;
+  for (int i = 0; i < 256; ++i) {
+    linear[i] = i / 255.0f;
+  }
+  const float* decode[4] = {linear.data(), linear.data(), linear.data(), linear.data()};
+  for (int c = 0; c < 3 && srgb; ++c) {
+    decode[c] = GetDecodeTable().data();
+  }
+  auto decode_row = [&](int y, std::vector<float>& buffer) -> const float* {
+    buffer.resize((std::size_t)width * 4);
+    const unsigned char* row = pixels + (std::size_t)y * width * channels;
+    float* texel = buffer.data();
+    if (channels == 4) {
+      for (int x = 0; x < width; ++x, row += 4, texel += 4) {
+        texel[0] = decode[0][row[0]];
+        texel[1] = decode[1][row[1]];
+        texel[2] = decode[2][row[2]];
+        texel[3] = decode[3][row[3]];
+      }
+      return buffer.data();
+    }
+    for (int x = 0; x < width; ++x, row += channels, texel += 4) {
+      texel[0] = texel[1] = texel[2] = 0.0f;
+      texel[3] = 1.0f;
+      for (int c = 0; c < channels; ++c) {
+        texel[c] = decode[c][row[c]];
+      }
+    }
+    return buffer.data();
+  };
+
+  std::vector<float> current, next;
+  while (width > 1 || height > 1) {
+    if (levels.size() == 1) {
+      Downsample(decode_row, width, height, kernel, next, pool);
+    } else {
+      auto level_row = [&](int y, std::vector<float>&) { return current.data() + (std::size_t)y * width * 4; };
+      Downsample(level_row, width, height, kernel, next, pool);
+    }
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+    current.swap(next);
+
+    levels.emplace_back();
+    Encode(current, channels, srgb, levels.back(), pool);
+  }
+
+  return levels;
+}
@@ -0,0 +1,32 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef MIP_GENERATOR_H_
+#define MIP_GENERATOR_H_
+
+#include <vector>
+
+#include "thread_pool.h"
+
+// Builds mip chains on the CPU instead of glGenerateMipmap: sRGB colour is
+// filtered in linear space, and the result is the same on every driver and
+// every run. Filtering uses AVX where the CPU has it, SSE2 otherwise, and a
+// scalar fallback, all doing the same operations in the same order.
+class MipGenerator {
+ public:
+  enum class Filter {
+    kBox,     // 2x2 average.
+    kKaiser,  // 8 tap Kaiser windowed sinc, sharper minification.
+  };
+
+  static int GetLevelCount(int width, int height);
+
+  // Every level from |pixels| (tightly packed, |channels| bytes per texel)
+  // down to 1x1, level 0 first. |srgb| applies to the colour channels of RGB
+  // and RGBA images. Rows are spread over |pool| when given.
+  static std::vector<std::vector<unsigned char>> GenerateChain(const unsigned char* pixels,
+                                                               int width, int height, int channels,
+                                                               bool srgb, Filter filter = Filter::kKaiser,
+                                                               ThreadPool* pool = nullptr);
+};
+
+#endif // MIP_GENERATOR_H_
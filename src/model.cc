@@ -2,13 +2,16 @@
 
 #include "model.h"
 
-Model::Model(const std::vector<Vertex>& vertices,
-             const std::vector<GLuint>& indices)
-    : vertices_(vertices),
-      indices_(indices),
-      model_trans_(glm::mat4(1.0f)) {
-  Setup();
-}
+#include <algorithm>
+
+#include "gl_state_cache.h"
+#include "material_textures.h"
+#include "texture_streamer.h"
+
+Model::Model(const std::shared_ptr<Mesh>& mesh)
+    : mesh_(mesh),
+      model_trans_(glm::mat4(1.0f)),
+      normal_matrix_(glm::mat3(1.0f)) {}
 
 void Model::SetDiffuseTexture(const std::shared_ptr<Texture>& diffuse) {
   diffuse1_ = diffuse;
@@ -20,54 +23,74 @@ void Model::SetSpecularTexture(const std::shared_ptr<Texture>& specular) {
 
 void Model::SetModelTransformation(const glm::mat4& model_trans) {
   model_trans_ = model_trans;
+  normal_matrix_ = glm::transpose(glm::inverse(glm::mat3(model_trans)));
 }
 
-void Model::Render(const std::shared_ptr<Material>& material,
-                   const std::shared_ptr<GlobalController>& global_controller,
-                   const std::shared_ptr<LightController>& light_controller) {
-  auto shader = material->GetRenderShader();
+void Model::SetModelTransformation(const glm::mat4& model_trans, const glm::mat3& normal_matrix) {
+  model_trans_ = model_trans;
+  normal_matrix_ = normal_matrix;
+}
 
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, diffuse1_->GetID());
-  glActiveTexture(GL_TEXTURE2);
-  glBindTexture(GL_TEXTURE_2D, specular1_->GetID());
+glm::vec3 Model::GetBoundingCenter() const {
+  return glm::vec3(model_trans_ * glm::vec4(mesh_->GetBoundingCenter(), 1.0f));
+}
 
-  shader->SetInt("material.diffuse1", 1);
-  shader->SetInt("material.specular1", 2);
-  shader->SetBool("material.is_blinn_phong", material->IsBlinnPhong());
-  shader->SetFloat("material.shininess", (float)material->GetShininess());
+float Model::GetBoundingRadius() const {
+  float scale = std::max({glm::length(glm::vec3(model_trans_[0])),
+                          glm::length(glm::vec3(model_trans_[1])),
+                          glm::length(glm::vec3(model_trans_[2]))});
+  return mesh_->GetBoundingRadius() * scale;
+}
 
-  light_controller->ApplyLighting(shader, global_controller);
+void Model::StreamTextures(float screen_size) {
+  auto& streamer = TextureStreamer::Get();
+  streamer.Request(diffuse1_, screen_size);
+  streamer.Request(specular1_, screen_size);
+}
 
+void Model::Render(const std::shared_ptr<Material>& material, const std::shared_ptr<Shader>& shader) {
+  ApplyMaterial(material, shader);
   Draw(shader);
 }
 
+void Model::ApplyMaterial(const std::shared_ptr<Material>& material, const std::shared_ptr<Shader>& shader) const {
+  auto& state = GLStateCache::Get();
+  auto& textures = MaterialTextures::Get();
+
+  // Both textures have to live in the same array to share its bind.
+  GLuint diffuse_array = 0, specular_array = 0;
+  GLint diffuse_layer = textures.GetLayer(diffuse1_, &diffuse_array);
+  GLint specular_layer = textures.GetLayer(specular1_, &specular_array);
+  if (diffuse_layer < 0 || specular_layer < 0 || diffuse_array != specular_array) {
+    diffuse_layer = -1;
+    specular_layer = -1;
+  }
+
+  if (diffuse_layer >= 0) {
+    if (!textures.IsBindless()) {
+      state.BindTexture(textures.GetTextureUnit(), GL_TEXTURE_2D_ARRAY, diffuse_array);
+    }
+  } else {
+    state.BindTexture(material->GetDiffuseUnit(), GL_TEXTURE_2D, diffuse1_->GetID());
+    state.BindTexture(material->GetSpecularUnit(), GL_TEXTURE_2D, specular1_->GetID());
+  }
+
+  shader->SetInt("material.diffuse1", material->GetDiffuseUnit());
+  shader->SetInt("material.specular1", material->GetSpecularUnit());
+  shader->SetInt("material.diffuse_layer", diffuse_layer);
+  shader->SetInt("material.specular_layer", specular_layer);
+  shader->SetInt("material_textures", textures.GetTextureUnit());
+  shader->SetBool("material.is_blinn_phong", material->IsBlinnPhong());
+  shader->SetFloat("material.shininess", (float)material->GetShininess());
+}
+
 void Model::Draw(const std::shared_ptr<Shader>& shader) {
   shader->SetMat4("model", model_trans_);
-  glBindVertexArray(vao_);
-  glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+  shader->SetMat3("normal_matrix", normal_matrix_);
+  mesh_->Draw(shader);
 }
 
-void Model::Setup() {
-  glGenVertexArrays(1, &vao_);
-  glGenBuffers(1, &vbo_);
-  glGenBuffers(1, &ebo_);
-
-  glBindVertexArray(vao_);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-  glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), &vertices_[0], GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(GLuint), &indices_[0], GL_STATIC_DRAW);
-
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(GLfloat)));
-
-  glBindVertexArray(0);
+InstanceData Model::GetInstanceData() const {
+  return {model_trans_, normal_matrix_,
+          mesh_->GetPositionScale(), mesh_->GetPositionOffset()};
 }
@@ -4,21 +4,21 @@
 #define MODEL_H_
 
 #include <memory>
-#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include "global_controller.h"
-#include "light_controller.h"
+#include "instance_buffer.h"
 #include "material.h"
+#include "mesh.h"
 #include "texture.h"
-#include "vertex.h"
 
+// An instance of a shared Mesh, with its own textures and transform.
 class Model {
  public:
-  Model(const std::vector<Vertex>& vertices,
-        const std::vector<GLuint>& indices);
+  explicit Model(const std::shared_ptr<Mesh>& mesh);
+
+  std::shared_ptr<Mesh> GetMesh() const { return mesh_; }
 
   void SetDiffuseTexture(const std::shared_ptr<Texture>& diffuse);
   std::shared_ptr<Texture> GetDiffuseTexture() const { return diffuse1_; }
@@ -27,28 +27,37 @@ class Model {
   std::shared_ptr<Texture> GetSpecularTexture() const { return specular1_; }
 
   glm::mat4 GetModelTranformation() const { return model_trans_; }
+  // Also computes the normal matrix, so shaders don't invert per vertex.
   void SetModelTransformation(const glm::mat4& model_trans);
+  // With a normal matrix computed already, e.g. by TransformHierarchy.
+  void SetModelTransformation(const glm::mat4& model_trans, const glm::mat3& normal_matrix);
+  glm::mat3 GetNormalMatrix() const { return normal_matrix_; }
 
-  void Render(const std::shared_ptr<Material>& material,
-              const std::shared_ptr<GlobalController>& global_controller,
-              const std::shared_ptr<LightController>& light_controller);
+  // Bounding sphere in world space.
+  glm::vec3 GetBoundingCenter() const;
+  float GetBoundingRadius() const;
 
-  void Draw(const std::shared_ptr<Shader>& shader);
+  // Asks TextureStreamer for the texture detail |screen_size| pixels need.
+  void StreamTextures(float screen_size);
 
- private:
-  void Setup();
+  void Render(const std::shared_ptr<Material>& material, const std::shared_ptr<Shader>& shader);
 
-  GLuint vao_;
-  GLuint vbo_;
-  GLuint ebo_;
+  // Binds the textures and sets the material uniforms, which every model
+  // with the same material and textures shares.
+  void ApplyMaterial(const std::shared_ptr<Material>& material, const std::shared_ptr<Shader>& shader) const;
 
-  std::vector<Vertex> vertices_;
-  std::vector<GLuint> indices_;
+  void Draw(const std::shared_ptr<Shader>& shader);
+
+  InstanceData GetInstanceData() const;
+
+ private:
+  std::shared_ptr<Mesh> mesh_;
 
   std::shared_ptr<Texture> diffuse1_;
   std::shared_ptr<Texture> specular1_;
 
   glm::mat4 model_trans_;
+  glm::mat3 normal_matrix_;
 };
 
 #endif // MODEL_H_
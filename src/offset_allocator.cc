@@ -0,0 +1,230 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "offset_allocator.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+int FindLowestBit(std::uint32_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return (int)index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+int FindHighestBit(std::uint32_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse(&index, value);
+  return (int)index;
+#else
+  return 31 - __builtin_clz(value);
+#endif
+}
+
+float OffsetAllocator::Stats::GetFragmentation() const {
+  std::uint32_t free = size - used;
+  if (free == 0) {
+    return 0.0f;
+  }
+  return 1.0f - (float)largest_free / (float)free;
+}
+
+OffsetAllocator::OffsetAllocator(std::uint32_t size)
+    : size_(size) {
+  std::fill(std::begin(bins_), std::end(bins_), kInvalid);
+  if (size_ > 0) {
+    InsertFree(NewNode(0, size_));
+  }
+}
+
+OffsetAllocator::Allocation OffsetAllocator::Allocate(std::uint32_t size) {
+  size = std::max(size, 1u);
+  int first_level, second_level;
+  if (!FindBin(size, &first_level, &second_level)) {
+    return Allocation();
+  }
+
+  std::uint32_t node = bins_[first_level * kSecondLevelCount + second_level];
+  RemoveFree(node);
+
+  // The rest of the range stays free, right behind the allocation.
+  if (nodes_[node].size > size) {
+    std::uint32_t rest = NewNode(nodes_[node].offset + size, nodes_[node].size - size);
+    nodes_[node].size = size;
+    nodes_[rest].neighbor_prev = node;
+    nodes_[rest].neighbor_next = nodes_[node].neighbor_next;
+    if (nodes_[rest].neighbor_next != kInvalid) {
+      nodes_[nodes_[rest].neighbor_next].neighbor_prev = rest;
+    }
+    nodes_[node].neighbor_next = rest;
+    InsertFree(rest);
+  }
+
+  nodes_[node].used = true;
+  used_ += size;
+  ++allocations_;
+
+  Allocation allocation;
+  allocation.offset = nodes_[node].offset;
+  allocation.node = node;
+  return allocation;
+}
+
+void OffsetAllocator::Free(Allocation allocation) {
+  if (!allocation.IsValid()) {
+    return;
+  }
+
+  std::uint32_t node = allocation.node;
+  used_ -= nodes_[node].size;
+  --allocations_;
+  nodes_[node].used = false;
+
+  // Absorb free neighbours, their nodes go back to the pool.
+  std::uint32_t prev = nodes_[node].neighbor_prev;
+  if (prev != kInvalid && !nodes_[prev].used) {
+    RemoveFree(prev);
+    nodes_[node].offset = nodes_[prev].offset;
+    nodes_[node].size += nodes_[prev].size;
+    nodes_[node].neighbor_prev = nodes_[prev].neighbor_prev;
+    if (nodes_[node].neighbor_prev != kInvalid) {
+      nodes_[nodes_[node].neighbor_prev].neighbor_next = node;
+    }
+    unused_nodes_.push_back(prev);
+  }
+  std::uint32_t next = nodes_[node].neighbor_next;
+  if (next != kInvalid && !nodes_[next].used) {
+    RemoveFree(next);
+    nodes_[node].size += nodes_[next].size;
+    nodes_[node].neighbor_next = nodes_[next].neighbor_next;
+    if (nodes_[node].neighbor_next != kInvalid) {
+      nodes_[nodes_[node].neighbor_next].neighbor_prev = node;
+    }
+    unused_nodes_.push_back(next);
+  }
+
+  InsertFree(node);
+}
+
+std::uint32_t OffsetAllocator::GetAllocationSize(Allocation allocation) const {
+  return allocation.IsValid() ? nodes_[allocation.node].size : 0;
+}
+
+OffsetAllocator::Stats OffsetAllocator::GetStats() const {
+  Stats stats;
+  stats.size = size_;
+  stats.used = used_;
+  stats.allocations = allocations_;
+  stats.free_ranges = free_ranges_;
+
+  // The largest range is in the highest non-empty bin.
+  if (first_level_bitmap_ != 0) {
+    int first_level = FindHighestBit(first_level_bitmap_);
+    int second_level = FindHighestBit(second_level_bitmaps_[first_level]);
+    for (std::uint32_t node = bins_[first_level * kSecondLevelCount + second_level]; node != kInvalid;
+         node = nodes_[node].bin_next) {
+      stats.largest_free = std::max(stats.largest_free, nodes_[node].size);
+    }
+  }
+  return stats;
+}
+
+void OffsetAllocator::MapSize(std::uint32_t size, int* first_level, int* second_level) {
+  if (size < (std::uint32_t)kSecondLevelCount) {
+    *first_level = 0;
+    *second_level = (int)size;
+  } else {
+    int high_bit = FindHighestBit(size);
+    *first_level = high_bit - kSecondLevelBits + 1;
+    *second_level = (int)((size >> (high_bit - kSecondLevelBits)) ^ kSecondLevelCount);
+  }
+}
+
+bool OffsetAllocator::FindBin(std::uint32_t size, int* first_level, int* second_level) const {
+  // Round up to the next bin boundary, so that any range of the bin fits.
+  if (size >= (std::uint32_t)kSecondLevelCount) {
+    std::uint32_t round = (1u << (FindHighestBit(size) - kSecondLevelBits)) - 1;
+    if (size > 0xFFFFFFFF - round) {
+      return false;
+    }
+    size += round;
+  }
+  MapSize(size, first_level, second_level);
+
+  std::uint32_t second_level_map = second_level_bitmaps_[*first_level] & (0xFFu << *second_level);
+  if (second_level_map == 0) {
+    if (*first_level + 1 >= kFirstLevelCount) {
+      return false;
+    }
+    std::uint32_t first_level_map = first_level_bitmap_ & (0xFFFFFFFFu << (*first_level + 1));
+    if (first_level_map == 0) {
+      return false;
+    }
+    *first_level = FindLowestBit(first_level_map);
+    second_level_map = second_level_bitmaps_[*first_level];
+  }
+  *second_level = FindLowestBit(second_level_map);
+  return true;
+}
+
+std::uint32_t OffsetAllocator::NewNode(std::uint32_t offset, std::uint32_t size) {
+  std::uint32_t node;
+  if (!unused_nodes_.empty()) {
+    node = unused_nodes_.back();
+    unused_nodes_.pop_back();
+    nodes_[node] = Node();
+  } else {
+    node = (std::uint32_t)nodes_.size();
+    nodes_.emplace_back();
+  }
+  nodes_[node].offset = offset;
+  nodes_[node].size = size;
+  return node;
+}
+
+void OffsetAllocator::InsertFree(std::uint32_t node) {
+  int first_level, second_level;
+  MapSize(nodes_[node].size, &first_level, &second_level);
+  std::uint32_t& head = bins_[first_level * kSecondLevelCount + second_level];
+
+  nodes_[node].bin_prev = kInvalid;
+  nodes_[node].bin_next = head;
+  if (head != kInvalid) {
+    nodes_[head].bin_prev = node;
+  }
+  head = node;
+
+  first_level_bitmap_ |= 1u << first_level;
+  second_level_bitmaps_[first_level] |= (std::uint8_t)(1u << second_level);
+  ++free_ranges_;
+}
+
+void OffsetAllocator::RemoveFree(std::uint32_t node) {
+  int first_level, second_level;
+  MapSize(nodes_[node].size, &first_level, &second_level);
+  std::uint32_t& head = bins_[first_level * kSecondLevelCount + second_level];
+
+  if (nodes_[node].bin_prev != kInvalid) {
+    nodes_[nodes_[node].bin_prev].bin_next = nodes_[node].bin_next;
+  } else {
+    head = nodes_[node].bin_next;
+  }
+  if (nodes_[node].bin_next != kInvalid) {
+    nodes_[nodes_[node].bin_next].bin_prev = nodes_[node].bin_prev;
+  }
+
+  if (head == kInvalid) {
+    second_level_bitmaps_[first_level] &= (std::uint8_t)~(1u << second_level);
+    if (second_level_bitmaps_[first_level] == 0) {
+      first_level_bitmap_ &= ~(1u << first_level);
+    }
+  }
+  --free_ranges_;
+}
@@ -0,0 +1,87 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef OFFSET_ALLOCATOR_H_
+#define OFFSET_ALLOCATOR_H_
+
+#include <cstdint>
+#include <vector>
+
+// Hands out ranges of [0, size) in abstract units, e.g. blocks of a GL
+// buffer, and touches no memory itself. TLSF: free ranges sit in bins by
+// size, two levels of bitmaps find a fitting bin, and freed ranges merge
+// with free neighbours, all in constant time.
+class OffsetAllocator {
+ public:
+  static constexpr std::uint32_t kNoSpace = 0xFFFFFFFF;
+
+  struct Allocation {
+    std::uint32_t offset = kNoSpace;
+    // Identifies the range for Free().
+    std::uint32_t node = kNoSpace;
+
+    bool IsValid() const { return offset != kNoSpace; }
+  };
+
+  struct Stats {
+    std::uint32_t size = 0;
+    std::uint32_t used = 0;
+    std::uint32_t allocations = 0;
+    std::uint32_t free_ranges = 0;
+    std::uint32_t largest_free = 0;
+
+    // 0 when all free space is one range, towards 1 the more it's split.
+    float GetFragmentation() const;
+  };
+
+  explicit OffsetAllocator(std::uint32_t size);
+
+  // Returns an invalid allocation when no free range fits |size|.
+  Allocation Allocate(std::uint32_t size);
+  void Free(Allocation allocation);
+
+  std::uint32_t GetAllocationSize(Allocation allocation) const;
+
+  Stats GetStats() const;
+
+ private:
+  // Eight bins per power of two.
+  static const int kSecondLevelBits = 3;
+  static const int kSecondLevelCount = 1 << kSecondLevelBits;
+  static const int kFirstLevelCount = 32 - kSecondLevelBits + 1;
+  static constexpr std::uint32_t kInvalid = 0xFFFFFFFF;
+
+  struct Node {
+    std::uint32_t offset = 0;
+    std::uint32_t size = 0;
+    bool used = false;
+    // Free list of the node's bin.
+    std::uint32_t bin_prev = kInvalid;
+    std::uint32_t bin_next = kInvalid;
+    // Adjacent ranges by offset.
+    std::uint32_t neighbor_prev = kInvalid;
+    std::uint32_t neighbor_next = kInvalid;
+  };
+
+  // The bin holding ranges of |size|, rounded down.
+  static void MapSize(std::uint32_t size, int* first_level, int* second_level);
+  // A bin whose ranges are all at least |size| long, searching upwards.
+  bool FindBin(std::uint32_t size, int* first_level, int* second_level) const;
+
+  std::uint32_t NewNode(std::uint32_t offset, std::uint32_t size);
+  void InsertFree(std::uint32_t node);
+  void RemoveFree(std::uint32_t node);
+
+  std::uint32_t size_;
+  std::uint32_t used_ = 0;
+  std::uint32_t allocations_ = 0;
+  std::uint32_t free_ranges_ = 0;
+
+  std::uint32_t first_level_bitmap_ = 0;
+  std::uint8_t second_level_bitmaps_[kFirstLevelCount] = {};
+  std::uint32_t bins_[kFirstLevelCount * kSecondLevelCount];
+
+  std::vector<Node> nodes_;
+  std::vector<std::uint32_t> unused_nodes_;
+};
+
+#endif // OFFSET_ALLOCATOR_H_
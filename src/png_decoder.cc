@@ -0,0 +1,719 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "png_decoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PNG_DECODER_SSE2
+#endif
+
+const int kFastBits = 10;
+const int kMaxCodeLength = 15;
+
+// Match copies may write this far past the end of the output.
+const std::size_t kOutputSlack = 32;
+
+// Smaller images aren't worth handing to the pool.
+const std::size_t kParallelBytes = 256 * 1024;
+
+const std::uint16_t kLengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+const std::uint8_t kLengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+const std::uint16_t kDistanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+const std::uint8_t kDistanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+// Two level lookup: the next kFastBits input bits index |entries|, codes
+// that are longer continue in a subtable indexed by the bits after those.
+// Entries hold the code length in bits 0-3 and flags in bits 4-7. Literals
+// carry their byte, lengths and distances their base value in bits 16-31
+// and the number of extra bits in bits 8-11. Subtable links hold the
+// subtable's offset in bits 16-31 and its index bits in bits 0-3.
+struct HuffmanTable {
+  enum class Kind {
+    kCodeLengths,
+    kLiteralLength,
+    kDistance,
+  };
+
+  static constexpr std::uint32_t kSubtable = 0x10;
+  static constexpr std::uint32_t kLiteral = 0x20;
+  static constexpr std::uint32_t kEndOfBlock = 0x40;
+  static constexpr std::uint32_t kInvalid = 0x80;
+
+  // Enough for 288 codes of up to 15 bits, every one in its own subtable.
+  std::uint32_t entries[(1 << kFastBits) + 288 * (1 << (kMaxCodeLength - kFastBits))];
+};
+
+// Deflate packs codes starting from their first bit, reading is little endian.
+struct BitReader {
+  const unsigned char* in;
+  const unsigned char* end;
+  std::uint64_t bits = 0;
+  int count = 0;
+  // Zero bytes made up past the end.
+  std::size_t overrun = 0;
+
+  // Leaves at least 56 bits buffered. The fast path loads a whole word, the
+  // bits past |count| are the next byte and are loaded again identically.
+  void Refill() {
+    if (end - in >= 8) {
+      std::uint64_t word;
+      std::memcpy(&word, in, 8);
+      bits |= word << count;
+      in += (63 - count) >> 3;
+      count |= 56;
+    } else {
+      while (count <= 56) {
+        if (in < end) {
+          bits |= (std::uint64_t)*in++ << count;
+        } else {
+          ++overrun;
+        }
+        count += 8;
+      }
+    }
+  }
+
+  void Consume(int n) {
+    bits >>= n;
+    count -= n;
+  }
+
+  std::uint32_t Take(int n) {
+    std::uint32_t value = (std::uint32_t)(bits & ((1ull << n) - 1));
+    Consume(n);
+    return value;
+  }
+};
+
+std::uint32_t ReadBigEndian(const unsigned char* p) {
+  return ((std::uint32_t)p[0] << 24) | ((std::uint32_t)p[1] << 16) | ((std::uint32_t)p[2] << 8) | p[3];
+}
+
+int ReverseBits(int code, int length) {
+  int reversed = 0;
+  for (int i = 0; i < length; ++i) {
+    reversed = (reversed << 1) | ((code >> i) & 1);
+  }
+  return reversed;
+}
+
+// What decoding |symbol| yields, without the code length.
+std::uint32_t GetSymbolEntry(HuffmanTable::Kind kind, int symbol) {
+  if (kind == HuffmanTable::Kind::kCodeLengths) {
+    return (std::uint32_t)symbol << 16;
+  }
+  if (kind == HuffmanTable::Kind::kDistance) {
+    if (symbol >= 30) {
+      return HuffmanTable::kInvalid;
+    }
+    return ((std::uint32_t)kDistanceBase[symbol] << 16) | ((std::uint32_t)kDistanceExtra[symbol] << 8);
+  }
+  if (symbol < 256) {
+    return ((std::uint32_t)symbol << 16) | HuffmanTable::kLiteral;
+  }
+  if (symbol == 256) {
+    return HuffmanTable::kEndOfBlock;
+  }
+  if (symbol >= 286) {
+    return HuffmanTable::kInvalid;
+  }
+  return ((std::uint32_t)kLengthBase[symbol - 257] << 16) | ((std::uint32_t)kLengthExtra[symbol - 257] << 8);
+}
+
+bool BuildHuffmanTable(const std::uint8_t* lengths, int count, HuffmanTable::Kind kind, HuffmanTable* table) {
+  int counts[kMaxCodeLength + 1] = {};
+  for (int i = 0; i < count; ++i) {
+    ++counts[lengths[i]];
+  }
+  counts[0] = 0;
+
+  // Incomplete codes are allowed, over-subscribed ones aren't.
+  int left = 1;
+  for (int length = 1; length <= kMaxCodeLength; ++length) {
+    left = (left << 1) - counts[length];
+    if (left < 0) {
+      return false;
+    }
+  }
+
+  int next_code[kMaxCodeLength + 1];
+  int code = 0;
+  for (int length = 1; length <= kMaxCodeLength; ++length) {
+    next_code[length] = code;
+    code = (code + counts[length]) << 1;
+  }
+
+  int codes[288];
+  int subtable_lengths[1 << kFastBits] = {};
+  for (int symbol = 0; symbol < count; ++symbol) {
+    int length = lengths[symbol];
+    if (length == 0) {
+      continue;
+    }
+    codes[symbol] = ReverseBits(next_code[length]++, length);
+    if (length > kFastBits) {
+      int& subtable_length = subtable_lengths[codes[symbol] & ((1 << kFastBits) - 1)];
+      subtable_length = std::max(subtable_length, length - kFastBits);
+    }
+  }
+
+  std::fill(table->entries, table->entries + (1 << kFastBits), HuffmanTable::kInvalid);
+  std::uint32_t next_subtable = 1 << kFastBits;
+  for (int prefix = 0; prefix < (1 << kFastBits); ++prefix) {
+    if (subtable_lengths[prefix] != 0) {
+      table->entries[prefix] = (next_subtable << 16) | HuffmanTable::kSubtable | subtable_lengths[prefix];
+      std::fill(table->entries + next_subtable, table->entries + next_subtable + (1 << subtable_lengths[prefix]),
+                HuffmanTable::kInvalid);
+      next_subtable += 1 << subtable_lengths[prefix];
+    }
+  }
+
+  for (int symbol = 0; symbol < count; ++symbol) {
+    int length = lengths[symbol];
+    if (length == 0) {
+      continue;
+    }
+    if (length <= kFastBits) {
+      std::uint32_t entry = GetSymbolEntry(kind, symbol) | length;
+      for (int i = codes[symbol]; i < (1 << kFastBits); i += 1 << length) {
+        table->entries[i] = entry;
+      }
+    } else {
+      int prefix = codes[symbol] & ((1 << kFastBits) - 1);
+      std::uint32_t* subtable = table->entries + (table->entries[prefix] >> 16);
+      int sub_length = length - kFastBits;
+      std::uint32_t entry = GetSymbolEntry(kind, symbol) | sub_length;
+      for (int i = codes[symbol] >> kFastBits; i < (1 << subtable_lengths[prefix]); i += 1 << sub_length) {
+        subtable[i] = entry;
+      }
+    }
+  }
+  return true;
+}
+
+// Decodes and consumes the next code, the buffer has to hold at least 15
+// bits. Unused codes give kInvalid.
+inline std::uint32_t DecodeEntry(BitReader& reader, const HuffmanTable& table) {
+  std::uint32_t entry = table.entries[reader.bits & ((1 << kFastBits) - 1)];
+  if (entry & HuffmanTable::kSubtable) {
+    reader.Consume(kFastBits);
+    entry = table.entries[(entry >> 16) + (reader.bits & ((1u << (entry & 15)) - 1))];
+  }
+  reader.Consume(entry & 15);
+  return entry;
+}
+
+const HuffmanTable& GetFixedTable(bool distance) {
+  static const HuffmanTable* tables = [] {
+    static HuffmanTable fixed[2];
+    std::uint8_t lengths[288];
+    std::fill(lengths, lengths + 144, 8);
+    std::fill(lengths + 144, lengths + 256, 9);
+    std::fill(lengths + 256, lengths + 280, 7);
+    std::fill(lengths + 280, lengths + 288, 8);
+    BuildHuffmanTable(lengths, 288, HuffmanTable::Kind::kLiteralLength, &fixed[0]);
+    std::fill(lengths, lengths + 30, 5);
+    BuildHuffmanTable(lengths, 30, HuffmanTable::Kind::kDistance, &fixed[1]);
+    return fixed;
+  }();
+  return tables[distance];
+}
+
+bool ReadDynamicTables(BitReader& reader, HuffmanTable* litlen, HuffmanTable* distance) {
+  static const std::uint8_t kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+  reader.Refill();
+  int litlen_count = (int)reader.Take(5) + 257;
+  int distance_count = (int)reader.Take(5) + 1;
+  int code_length_count = (int)reader.Take(4) + 4;
+
+  std::uint8_t code_lengths[19] = {};
+  for (int i = 0; i < code_length_count; ++i) {
+    reader.Refill();
+    code_lengths[kOrder[i]] = (std::uint8_t)reader.Take(3);
+  }
+  HuffmanTable code_length_table;
+  if (!BuildHuffmanTable(code_lengths, 19, HuffmanTable::Kind::kCodeLengths, &code_length_table)) {
+    return false;
+  }
+
+  std::uint8_t lengths[288 + 32];
+  int total = litlen_count + distance_count;
+  for (int n = 0; n < total;) {
+    reader.Refill();
+    std::uint32_t entry = DecodeEntry(reader, code_length_table);
+    if (entry & HuffmanTable::kInvalid) {
+      return false;
+    }
+    int symbol = (int)(entry >> 16);
+    if (symbol < 16) {
+      lengths[n++] = (std::uint8_t)symbol;
+      continue;
+    }
+
+    int repeat;
+    std::uint8_t value = 0;
+    if (symbol == 16) {
+      if (n == 0) {
+        return false;
+      }
+      value = lengths[n - 1];
+      repeat = 3 + (int)reader.Take(2);
+    } else if (symbol == 17) {
+      repeat = 3 + (int)reader.Take(3);
+    } else {
+      repeat = 11 + (int)reader.Take(7);
+    }
+    if (n + repeat > total) {
+      return false;
+    }
+    std::memset(lengths + n, value, repeat);
+    n += repeat;
+  }
+
+  if (lengths[256] == 0) {
+    return false;
+  }
+  return BuildHuffmanTable(lengths, litlen_count, HuffmanTable::Kind::kLiteralLength, litlen) &&
+         BuildHuffmanTable(lengths + litlen_count, distance_count, HuffmanTable::Kind::kDistance, distance);
+}
+
+// Copies whole chunks, possibly past |length|, into the output slack.
+void CopyMatch(unsigned char* out, std::size_t distance, int length) {
+  const unsigned char* from = out - distance;
+  unsigned char* end = out + length;
+#if defined(PNG_DECODER_SSE2)
+  if (distance >= 16) {
+    do {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_loadu_si128(reinterpret_cast<const __m128i*>(from)));
+      out += 16;
+      from += 16;
+    } while (out < end);
+    return;
+  }
+#endif
+  if (distance >= 8) {
+    do {
+      std::uint64_t word;
+      std::memcpy(&word, from, 8);
+      std::memcpy(out, &word, 8);
+      out += 8;
+      from += 8;
+    } while (out < end);
+  } else if (distance == 1) {
+    std::memset(out, *from, length);
+  } else {
+    do {
+      *out++ = *from++;
+    } while (out < end);
+  }
+}
+
+bool InflateBlock(BitReader& reader, const HuffmanTable& litlen, const HuffmanTable& distance,
+                  unsigned char* out_begin, unsigned char** out_pointer, unsigned char* out_end) {
+  unsigned char* out = *out_pointer;
+  for (;;) {
+    // 56 bits cover a length and a distance with their extra bits.
+    reader.Refill();
+    std::uint32_t entry = DecodeEntry(reader, litlen);
+    if (entry & HuffmanTable::kLiteral) {
+      if (out == out_end) {
+        return false;
+      }
+      *out++ = (unsigned char)(entry >> 16);
+      continue;
+    }
+    if (entry & (HuffmanTable::kEndOfBlock | HuffmanTable::kInvalid)) {
+      if (entry & HuffmanTable::kInvalid) {
+        return false;
+      }
+      break;
+    }
+    int length = (int)(entry >> 16) + (int)reader.Take((entry >> 8) & 15);
+
+    entry = DecodeEntry(reader, distance);
+    if (entry & HuffmanTable::kInvalid) {
+      return false;
+    }
+    std::size_t match_distance = (entry >> 16) + reader.Take((entry >> 8) & 15);
+
+    if (match_distance > (std::size_t)(out - out_begin) || length > out_end - out) {
+      return false;
+    }
+    CopyMatch(out, match_distance, length);
+    out += length;
+  }
+
+  *out_pointer = out;
+  return reader.overrun <= 8;
+}
+
+bool InflateStored(BitReader& reader, unsigned char** out_pointer, unsigned char* out_end) {
+  // Stored blocks start on a byte boundary, the buffer only holds whole
+  // bytes after that.
+  reader.Consume(reader.count & 7);
+  reader.Refill();
+  std::size_t length = reader.Take(16);
+  std::size_t complement = reader.Take(16);
+  if (length != (~complement & 0xffff) || length > (std::size_t)(out_end - *out_pointer)) {
+    return false;
+  }
+
+  unsigned char* out = *out_pointer;
+  while (length > 0 && reader.count >= 8) {
+    *out++ = (unsigned char)reader.Take(8);
+    --length;
+  }
+  if (length > 0) {
+    if ((std::size_t)(reader.end - reader.in) < length) {
+      return false;
+    }
+    std::memcpy(out, reader.in, length);
+    out += length;
+    reader.in += length;
+    reader.bits = 0;
+  }
+
+  *out_pointer = out;
+  return true;
+}
+
+int Paeth(int a, int b, int c) {
+  int pa = std::abs(b - c);
+  int pb = std::abs(a - c);
+  int pc = std::abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+#if defined(PNG_DECODER_SSE2)
+template <int kBpp>
+__m128i LoadPixel(const unsigned char* p) {
+  int value = 0;
+  std::memcpy(&value, p, kBpp);
+  return _mm_cvtsi32_si128(value);
+}
+
+template <int kBpp>
+void StorePixel(unsigned char* p, __m128i pixel) {
+  int value = _mm_cvtsi128_si32(pixel);
+  std::memcpy(p, &value, kBpp);
+}
+
+__m128i Select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__m128i Abs16(__m128i x) {
+  return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+// Whole pixels at once for 3 and 4 byte pixels, the left neighbour chain
+// keeps them sequential within the row.
+template <int kBpp>
+void UnfilterPixels(int filter, const unsigned char* src, const unsigned char* prev, unsigned char* dst,
+                    std::size_t stride) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero;
+  if (filter == 1) {
+    for (std::size_t i = 0; i < stride; i += kBpp) {
+      a = _mm_add_epi8(LoadPixel<kBpp>(src + i), a);
+      StorePixel<kBpp>(dst + i, a);
+    }
+  } else if (filter == 3) {
+    const __m128i one = _mm_set1_epi8(1);
+    for (std::size_t i = 0; i < stride; i += kBpp) {
+      __m128i b = LoadPixel<kBpp>(prev + i);
+      __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+      a = _mm_add_epi8(LoadPixel<kBpp>(src + i), average);
+      StorePixel<kBpp>(dst + i, a);
+    }
+  } else {
+    // Paeth in 16 bits, ties favour a, then b, then c.
+    __m128i c = zero;
+    for (std::size_t i = 0; i < stride; i += kBpp) {
+      __m128i b = _mm_unpacklo_epi8(LoadPixel<kBpp>(prev + i), zero);
+      __m128i pa = _mm_sub_epi16(b, c);
+      __m128i pb = _mm_sub_epi16(a, c);
+      __m128i pc = Abs16(_mm_add_epi16(pa, pb));
+      pa = Abs16(pa);
+      pb = Abs16(pb);
+      __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      __m128i nearest = Select(_mm_cmpeq_epi16(smallest, pa), a,
+                               Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+      __m128i pixel = _mm_add_epi8(LoadPixel<kBpp>(src + i), _mm_packus_epi16(nearest, nearest));
+      StorePixel<kBpp>(dst + i, pixel);
+      a = _mm_unpacklo_epi8(pixel, zero);
+      c = b;
+    }
+  }
+}
+#endif
+
+void UnfilterRow(int filter, const unsigned char* src, const unsigned char* prev, unsigned char* dst,
+                 std::size_t stride, int bpp) {
+  switch (filter) {
+    case 0:
+      std::memcpy(dst, src, stride);
+      return;
+    case 2: {
+      std::size_t i = 0;
+#if defined(PNG_DECODER_SSE2)
+      for (; i + 16 <= stride; i += 16) {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), sum);
+      }
+#endif
+      for (; i < stride; ++i) {
+        dst[i] = (unsigned char)(src[i] + prev[i]);
+      }
+      return;
+    }
+    default:
+      break;
+  }
+
+#if defined(PNG_DECODER_SSE2)
+  if (bpp == 3) {
+    UnfilterPixels<3>(filter, src, prev, dst, stride);
+    return;
+  }
+  if (bpp == 4) {
+    UnfilterPixels<4>(filter, src, prev, dst, stride);
+    return;
+  }
+#endif
+
+  for (std::size_t i = 0; i < stride; ++i) {
+    int a = i >= (std::size_t)bpp ? dst[i - bpp] : 0;
+    int c = i >= (std::size_t)bpp ? prev[i - bpp] : 0;
+    int predicted;
+    if (filter == 1) {
+      predicted = a;
+    } else if (filter == 3) {
+      predicted = (a + prev[i]) >> 1;
+    } else {
+      predicted = Paeth(a, prev[i], c);
+    }
+    dst[i] = (unsigned char)(src[i] + predicted);
+  }
+}
+
+bool Unfilter(const std::vector<unsigned char>& raw, int height, std::size_t stride, int bpp,
+              unsigned char* pixels, ThreadPool* pool, int* row_runs) {
+  // A run starts at every row which doesn't look at the row above.
+  std::vector<int> run_starts;
+  for (int y = 0; y < height; ++y) {
+    int filter = raw[y * (stride + 1)];
+    if (filter > 4) {
+      return false;
+    }
+    if (y == 0 || filter <= 1) {
+      run_starts.push_back(y);
+    }
+  }
+  *row_runs = (int)run_starts.size();
+
+  std::vector<unsigned char> zero_row(stride, 0);
+  auto unfilter_runs = [&](std::size_t begin, std::size_t end) {
+    for (std::size_t run = begin; run < end; ++run) {
+      int last_row = run + 1 < run_starts.size() ? run_starts[run + 1] : height;
+      for (int y = run_starts[run]; y < last_row; ++y) {
+        const unsigned char* src = raw.data() + y * (stride + 1);
+        const unsigned char* prev = y == 0 ? zero_row.data() : pixels + (y - 1) * stride;
+        UnfilterRow(src[0], src + 1, prev, pixels + y * stride, stride, bpp);
+      }
+    }
+  };
+
+  if (pool && raw.size() >= kParallelBytes && run_starts.size() > 1) {
+    pool->ParallelFor(run_starts.size(), unfilter_runs);
+  } else {
+    unfilter_runs(0, run_starts.size());
+  }
+  return true;
+}
+
+bool PngDecoder::Load(const std::string& path, Image* image, ThreadPool* pool) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return Decode(data.data(), data.size(), image, pool);
+}
+
+bool PngDecoder::Decode(const unsigned char* data, std::size_t size, Image* image, ThreadPool* pool) {
+  static const unsigned char kSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  if (size < 8 || std::memcmp(data, kSignature, 8) != 0) {
+    return false;
+  }
+
+  // Like stb_image, chunk CRCs and the zlib checksum aren't verified.
+  int width = 0, height = 0, color_type = -1;
+  unsigned char palette[256][4];
+  int palette_size = 0;
+  bool has_transparency = false;
+  std::vector<unsigned char> compressed;
+  for (std::size_t pos = 8; pos + 12 <= size;) {
+    std::uint32_t length = ReadBigEndian(data + pos);
+    const unsigned char* type = data + pos + 4;
+    const unsigned char* chunk = data + pos + 8;
+    if (length > size - pos - 12) {
+      return false;
+    }
+
+    if (std::memcmp(type, "IHDR", 4) == 0) {
+      if (length != 13) {
+        return false;
+      }
+      width = (int)ReadBigEndian(chunk);
+      height = (int)ReadBigEndian(chunk + 4);
+      color_type = chunk[9];
+      // 8 bit, deflate, adaptive filtering, not interlaced.
+      if (chunk[8] != 8 || chunk[10] != 0 || chunk[11] != 0 || chunk[12] != 0) {
+        return false;
+      }
+    } else if (std::memcmp(type, "PLTE", 4) == 0) {
+      palette_size = std::min<int>(length / 3, 256);
+      for (int i = 0; i < palette_size; ++i) {
+        std::memcpy(palette[i], chunk + i * 3, 3);
+        palette[i][3] = 255;
+      }
+    } else if (std::memcmp(type, "tRNS", 4) == 0) {
+      // stb_image adds an alpha channel to RGB and grey images, leave those
+      // to it.
+      if (color_type != 3) {
+        return false;
+      }
+      for (int i = 0; i < std::min<int>(length, palette_size); ++i) {
+        palette[i][3] = chunk[i];
+      }
+      has_transparency = true;
+    } else if (std::memcmp(type, "IDAT", 4) == 0) {
+      compressed.insert(compressed.end(), chunk, chunk + length);
+    } else if (std::memcmp(type, "IEND", 4) == 0) {
+      break;
+    } else if ((type[0] & 32) == 0) {
+      // Unknown critical chunk.
+      return false;
+    }
+    pos += 12 + length;
+  }
+
+  int bpp;
+  switch (color_type) {
+    case 0: bpp = 1; break;
+    case 2: bpp = 3; break;
+    case 3: bpp = 1; break;
+    case 4: bpp = 2; break;
+    case 6: bpp = 4; break;
+    default: return false;
+  }
+  if (width <= 0 || height <= 0 || (std::size_t)width * height > (1u << 28) ||
+      (color_type == 3 && palette_size == 0)) {
+    return false;
+  }
+
+  std::size_t stride = (std::size_t)width * bpp;
+  std::vector<unsigned char> raw;
+  if (!Inflate(compressed.data(), compressed.size(), height * (stride + 1), &raw)) {
+    return false;
+  }
+
+  std::vector<unsigned char> scanlines(height * stride);
+  if (!Unfilter(raw, height, stride, bpp, scanlines.data(), pool, &image->row_runs)) {
+    return false;
+  }
+
+  image->width = width;
+  image->height = height;
+  if (color_type != 3) {
+    image->channels = bpp;
+    image->pixels = std::move(scanlines);
+    return true;
+  }
+
+  // Indices past the palette come out black.
+  for (int i = palette_size; i < 256; ++i) {
+    palette[i][0] = palette[i][1] = palette[i][2] = 0;
+    palette[i][3] = 255;
+  }
+  int channels = has_transparency ? 4 : 3;
+  image->channels = channels;
+  image->pixels.resize((std::size_t)width * height * channels);
+  auto expand_rows = [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * width; i < end * width; ++i) {
+      std::memcpy(&image->pixels[i * channels], palette[scanlines[i]], channels);
+    }
+  };
+  if (pool && raw.size() >= kParallelBytes) {
+    pool->ParallelFor(height, expand_rows);
+  } else {
+    expand_rows(0, height);
+  }
+  return true;
+}
+
+bool PngDecoder::Inflate(const unsigned char* data, std::size_t size, std::size_t output_size,
+                         std::vector<unsigned char>* output) {
+  if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 32) != 0) {
+    return false;
+  }
+
+  output->resize(output_size + kOutputSlack);
+  unsigned char* out_begin = output->data();
+  unsigned char* out = out_begin;
+  unsigned char* out_end = out_begin + output_size;
+
+  BitReader reader{data + 2, data + size};
+  HuffmanTable litlen, distance;
+  for (bool final_block = false; !final_block;) {
+    reader.Refill();
+    final_block = reader.Take(1) != 0;
+    int type = (int)reader.Take(2);
+
+    bool ok;
+    if (type == 0) {
+      ok = InflateStored(reader, &out, out_end);
+    } else if (type == 1) {
+      ok = InflateBlock(reader, GetFixedTable(false), GetFixedTable(true), out_begin, &out, out_end);
+    } else if (type == 2) {
+      ok = ReadDynamicTables(reader, &litlen, &distance) &&
+           InflateBlock(reader, litlen, distance, out_begin, &out, out_end);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+
+  if (out != out_end) {
+    return false;
+  }
+  output->resize(output_size);
+  return true;
+}
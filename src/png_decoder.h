@@ -0,0 +1,45 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef PNG_DECODER_H_
+#define PNG_DECODER_H_
+
+#include <string>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Decodes the PNGs textures are usually saved as, 8 bit and not interlaced,
+// faster than stb_image. Inflate keeps 64 bits buffered, decodes Huffman
+// codes through lookup tables and copies matches 8 or 16 bytes at a time.
+// Filters are undone with SSE2 for 3 and 4 byte pixels.
+//
+// Rows filtered with Up, Average or Paeth need the row above already
+// unfiltered, so rows only run in parallel from a row filtered with None or
+// Sub (or the first one) up to the next such row. How much that gives
+// depends on the encoder's filter choice. Inflate itself stays sequential.
+//
+// Anything else returns false, callers fall back to stb_image. Channels
+// match stbi_load(..., 0), palette images become RGB or RGBA.
+class PngDecoder {
+ public:
+  struct Image {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+    // Runs of rows which could be unfiltered independently.
+    int row_runs = 0;
+  };
+
+  static bool Load(const std::string& path, Image* image, ThreadPool* pool = nullptr);
+
+  // Rows are spread over |pool| for large images.
+  static bool Decode(const unsigned char* data, std::size_t size, Image* image, ThreadPool* pool = nullptr);
+
+  // Inflates the zlib stream |data| into |output|, which must come out as
+  // exactly |output_size| bytes.
+  static bool Inflate(const unsigned char* data, std::size_t size, std::size_t output_size,
+                      std::vector<unsigned char>* output);
+};
+
+#endif // PNG_DECODER_H_
@@ -4,9 +4,22 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
-
-Scene::Scene() {
+#include <tuple>
+
+#include "geometry_buffer.h"
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "material_textures.h"
+#include "mesh_cache.h"
+#include "shader_library.h"
+#include "test_model.h"
+
+Scene::Scene()
+    : cube_transforms_(&frame_pool_) {
   InitShadowMisc();
 }
 
@@ -18,6 +31,154 @@ void Scene::AddModel(const std::string& name, const std::shared_ptr<Model>& mode
   models_[name] = std::make_pair(model, material_name);
 }
 
+void Scene::SetDenseMeshes(bool enabled) {
+  const int kGridSize = 4;
+
+  if (enabled == dense_meshes_ || models_.empty()) {
+    return;
+  }
+  dense_meshes_ = enabled;
+
+  if (!enabled) {
+    RemoveModels("DenseMesh");
+    return;
+  }
+
+  // 131k vertices and 262k triangles each.
+  std::vector<Vertex> vertices;
+  std::vector<GLuint> indices;
+  TestModel::MakeSphere(0.6f, 256, 512, &vertices, &indices);
+
+  auto mesh = MeshCache::Get().GetMesh(vertices, indices);
+  auto& [first_model, material_name] = models_.begin()->second;
+  auto diffuse = first_model->GetDiffuseTexture();
+  auto specular = first_model->GetSpecularTexture();
+  auto material = material_name;
+  for (int i = 0; i < kGridSize * kGridSize; ++i) {
+    auto model = std::make_shared<Model>(mesh);
+    model->SetDiffuseTexture(diffuse);
+    model->SetSpecularTexture(specular);
+    glm::vec3 position((i % kGridSize - 1.5f) * 1.5f, 3.0f + (i / kGridSize) * 1.5f, -6.0f);
+    model->SetModelTransformation(glm::translate(glm::mat4(1.0f), position));
+    AddModel("DenseMesh" + std::to_string(i), model, material);
+  }
+}
+
+void Scene::SetCubeField(int count) {
+  const float kSpacing = 0.4f;
+
+  if (count == cube_field_size_ || models_.empty()) {
+    return;
+  }
+  cube_field_size_ = count;
+  RemoveModels("CubeField");
+  cube_transforms_.Clear();
+  cube_slab_nodes_.clear();
+  cube_nodes_.clear();
+  if (count == 0) {
+    return;
+  }
+
+  auto mesh = MeshCache::Get().GetMesh(TestModel::cube_vertices, TestModel::cube_indices);
+  auto& [first_model, material_name] = models_.begin()->second;
+  auto diffuse = first_model->GetDiffuseTexture();
+  auto specular = first_model->GetSpecularTexture();
+  auto material = material_name;
+  int side = (int)std::ceil(std::cbrt((float)count));
+  auto root = cube_transforms_.AddNode();
+  for (int slab = 0; slab * side * side < count; ++slab) {
+    // Turning about its centre.
+    auto node = cube_transforms_.AddNode(root);
+    cube_transforms_.SetTranslation(node, glm::vec3(0.0f, side * 0.5f, -slab - 8.0f) * kSpacing);
+    cube_slab_nodes_.push_back(node);
+  }
+  glm::vec3 axis = glm::normalize(glm::vec3(0.3f, 1.0f, 0.5f));
+  for (int i = 0; i < count; ++i) {
+    auto model = std::make_shared<Model>(mesh);
+    model->SetDiffuseTexture(diffuse);
+    model->SetSpecularTexture(specular);
+    auto node = cube_transforms_.AddNode(cube_slab_nodes_[i / (side * side)]);
+    glm::vec3 position(i % side - side * 0.5f, i / side % side - side * 0.5f, 0.0f);
+    cube_transforms_.SetLocal(node, position * kSpacing, glm::angleAxis((float)i, axis),
+                              glm::vec3(kSpacing * 0.5f));
+    cube_nodes_.emplace_back(node, model);
+    AddModel("CubeField" + std::to_string(i), model, material);
+  }
+  UpdateCubeField();
+}
+
+void Scene::UpdateCubeField() {
+  if (animate_cube_field_) {
+    float time = (float)ImGui::GetTime();
+    for (std::size_t slab = 0; slab < cube_slab_nodes_.size(); ++slab) {
+      float speed = 0.2f + 0.1f * (slab % 4);
+      cube_transforms_.SetRotation(cube_slab_nodes_[slab],
+                                   glm::angleAxis(time * speed, glm::vec3(0.0f, 0.0f, 1.0f)));
+    }
+  }
+
+  cube_transforms_.Update();
+  for (auto& [node, model] : cube_nodes_) {
+    if (cube_transforms_.IsUpdated(node)) {
+      model->SetModelTransformation(cube_transforms_.GetWorldMatrix(node), cube_transforms_.GetNormalMatrix(node));
+    }
+  }
+}
+
+void Scene::RemoveModels(const std::string& prefix) {
+  for (auto iter = models_.begin(); iter != models_.end();) {
+    if (iter->first.rfind(prefix, 0) == 0) {
+      iter = models_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void Scene::BuildDrawRuns() {
+  // Meshes last, so that the commands of a run are adjacent. A run can't
+  // span GeometryBuffer pages.
+  using BatchKey = std::tuple<const Material*, const Texture*, const Texture*, int, const Mesh*>;
+
+  std::map<BatchKey, std::vector<const std::pair<std::shared_ptr<Model>, std::string>*>> groups;
+  for (auto&& [name, model_pair] : models_) {
+    auto material = materials_.find(model_pair.second);
+    if (material == materials_.end()) {
+      continue;
+    }
+    const auto& model = model_pair.first;
+    BatchKey key(material->second.get(), model->GetDiffuseTexture().get(),
+                 model->GetSpecularTexture().get(), model->GetMesh()->GetRange().page, model->GetMesh().get());
+    groups[key].push_back(&model_pair);
+  }
+
+  std::vector<InstanceData> instances;
+  std::vector<DrawElementsIndirectCommand> commands;
+  instances.reserve(models_.size());
+  draw_runs_.clear();
+  const BatchKey* run_key = nullptr;
+  for (auto&& [key, members] : groups) {
+    if (!run_key || std::get<0>(key) != std::get<0>(*run_key) || std::get<1>(key) != std::get<1>(*run_key) ||
+        std::get<2>(key) != std::get<2>(*run_key) || std::get<3>(key) != std::get<3>(*run_key)) {
+      draw_runs_.push_back({&members.front()->second, members.front()->first.get(), std::get<3>(key),
+                            commands.size(), 0});
+      run_key = &key;
+    }
+    ++draw_runs_.back().command_count;
+
+    const Mesh* mesh = std::get<4>(key);
+    auto range = mesh->GetRange();
+    commands.push_back({(GLuint)mesh->GetIndexCount(), (GLuint)members.size(), range.first_index,
+                        range.base_vertex, (GLuint)instances.size()});
+    for (auto* model_pair : members) {
+      instances.push_back(model_pair->first->GetInstanceData());
+    }
+  }
+  instance_buffer_.Upload(instances);
+  draw_commands_.Upload(commands);
+  draw_command_count_ = commands.size();
+}
+
 void Scene::GenerateShadowMap(const std::shared_ptr<GlobalController>& global_controller,
                               const std::shared_ptr<LightController>& light_controller) {
   // [Note] Assume first direct light, if exist.
@@ -47,11 +208,22 @@ void Scene::GenerateShadowMap(const std::shared_ptr<GlobalController>& global_co
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);*/
 
+  auto& state = GLStateCache::Get();
   for (auto&& [name, direct_light] : light_controller->GetDirectLights()) {
-    glViewport(0, 0, Light::kShadowWidth, Light::kShadowHeight);
-    glBindFramebuffer(GL_FRAMEBUFFER, direct_light->GetShadowFBO());
+    state.Viewport(0, 0, Light::kShadowWidth, Light::kShadowHeight);
+    state.BindFramebuffer(direct_light->GetShadowFBO());
     glClear(GL_DEPTH_BUFFER_BIT);
 
+    if (instancing_) {
+      instanced_shadow_shader_->Use();
+      instanced_shadow_shader_->SetMat4("light_space_trans", direct_light->GetLightSpaceTrans());
+
+      for (auto& run : draw_runs_) {
+        draw_calls_ += draw_commands_.Draw(instance_buffer_, run.page, run.first_command, run.command_count);
+      }
+      continue;
+    }
+
     shadow_shader_->Use();
 
     shadow_shader_->SetMat4("light_space_trans", direct_light->GetLightSpaceTrans());
@@ -59,60 +231,120 @@ void Scene::GenerateShadowMap(const std::shared_ptr<GlobalController>& global_co
     for (auto&& [name, model_pair] : models_) {
       model_pair.first->Draw(shadow_shader_);
     }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    draw_calls_ += models_.size();
   }
+  state.BindFramebuffer(0);
 }
 
 void Scene::Render(const std::shared_ptr<GlobalController>& global_controller,
                    const std::shared_ptr<LightController>& light_controller) {
+  global_controller->UpdateFrameConstants();
+
+  UpdateCubeField();
+
+  auto submit_start = std::chrono::steady_clock::now();
+  draw_calls_ = 0;
+  if (instancing_) {
+    BuildDrawRuns();
+  }
+
   if (global_controller->IsShadowEnabled()) {
     GenerateShadowMap(global_controller, light_controller);
   }
 
+  auto& state = GLStateCache::Get();
   auto screen_size = global_controller->GetScreenSize();
-  glViewport(0, 0, screen_size.x, screen_size.y);
+  state.Viewport(0, 0, screen_size.x, screen_size.y);
 
-  glEnable(GL_DEPTH_TEST);
+  state.SetDepthTest(true);
   auto clear_color = global_controller->GetClearColor();
   glClearColor(clear_color.r, clear_color.g, clear_color.b, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   global_controller->RenderCoords();
 
-  if (global_controller->IsShadowEnabled()) {
-    for (auto&& [name, model_pair] : models_) {
-      auto material = materials_[model_pair.second];
-      auto shader = material->GetRenderShader();
+  light_controller->ApplyLighting(global_controller);
 
-      ApplyAndSetShaderGlobal(shader, global_controller);
+  // Pick the shader variant of every material once per frame. Specialised
+  // variants get the current feature switches compiled in.
+  ShaderDefines frame_defines;
+  if (specialized_shaders_) {
+    frame_defines = global_controller->GetShaderDefines();
+    frame_defines.merge(light_controller->GetShaderDefines());
+    frame_defines["SPECIALIZED"] = "1";
+  }
+  frame_defines.merge(MaterialTextures::Get().GetShaderDefines());
+  if (MeshCache::Get().IsPackedVertices()) {
+    frame_defines["PACKED_VERTICES"] = "1";
+  }
+  if (instancing_) {
+    frame_defines["INSTANCED"] = "1";
+  }
+  if (per_vertex_transforms_) {
+    frame_defines["PER_VERTEX_TRANSFORMS"] = "1";
+  }
 
-      unsigned int i = 0;
+  MaterialTextures::Get().Update();
+
+  std::map<std::string, std::shared_ptr<Shader>> material_shaders;
+  for (auto&& [name, material] : materials_) {
+    ShaderDefines defines = frame_defines;
+    if (specialized_shaders_) {
+      defines.merge(material->GetShaderDefines());
+    }
+    material_shaders[name] = material->GetRenderShader(defines);
+  }
+
+  // Texture detail follows the models' projected size, in pixels.
+  glm::mat4 view = global_controller->GetViewMatrix();
+  float projection_scale = global_controller->GetProjectionMatrix()[1][1] * global_controller->GetScreenSize().y;
+  for (auto&& [name, model_pair] : models_) {
+    auto& model = model_pair.first;
+    float distance = std::max(-(view * glm::vec4(model->GetBoundingCenter(), 1.0f)).z, 0.1f);
+    model->StreamTextures(model->GetBoundingRadius() * projection_scale / distance);
+  }
+
+  auto apply_globals = [&](const std::shared_ptr<Shader>& shader) {
+    ApplyAndSetShaderGlobal(shader, global_controller);
+
+    shader->SetBool("shadow_enable", global_controller->IsShadowEnabled());
+    if (global_controller->IsShadowEnabled()) {
       for (auto&& [name, direct_light] : light_controller->GetDirectLights()) {
         shader->SetMat4("light_space_trans", direct_light->GetLightSpaceTrans());
 
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, direct_light->GetShadowMap());
-        shader->SetInt("shadow_map", i);
-        shader->SetBool("shadow_enable", true);
-        ++i;
+        state.BindTexture(direct_light->GetShadowUnit(), GL_TEXTURE_2D, direct_light->GetShadowMap());
+        shader->SetInt("shadow_map", direct_light->GetShadowUnit());
       }
+    }
+  };
 
-      model_pair.first->Render(material, global_controller, light_controller);
+  state.SetRasterizerDiscard(discard_rasterization_);
+  opaque_timer_.Begin();
+
+  if (instancing_) {
+    for (auto& run : draw_runs_) {
+      auto material = materials_[*run.material_name];
+      auto shader = material_shaders[*run.material_name];
+
+      apply_globals(shader);
+      run.model->ApplyMaterial(material, shader);
+      draw_calls_ += draw_commands_.Draw(instance_buffer_, run.page, run.first_command, run.command_count);
     }
   } else {
     for (auto&& [name, model_pair] : models_) {
       auto material = materials_[model_pair.second];
-      auto shader = material->GetRenderShader();
-
-      ApplyAndSetShaderGlobal(shader, global_controller);
+      auto shader = material_shaders[model_pair.second];
 
-      shader->SetBool("shadow_enable", false);
-
-      model_pair.first->Render(material, global_controller, light_controller);
+      apply_globals(shader);
+      model_pair.first->Render(material, shader);
     }
+    draw_calls_ += models_.size();
   }
 
+  opaque_timer_.End();
+  state.SetRasterizerDiscard(false);
+  submit_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submit_start).count();
+
   if (global_controller->IsDisplayingShadowMap()) {
     DisplayShadowMap(light_controller);
   }
@@ -122,7 +354,79 @@ void Scene::Config() {
   ImGui::PushID("Materials");
   ImGui::Begin("Materials");
 
-  std::size_t i = 0;
+  ImGui::Checkbox("Specialized shaders", &specialized_shaders_);
+  ImGui::Text("Opaque pass GPU time: %.3f ms", opaque_timer_.GetElapsedMs());
+
+  ImGui::Checkbox("Instancing", &instancing_);
+  ImGui::BeginDisabled(!instancing_ || !GLExtensions::has_multi_draw_indirect);
+  bool indirect = draw_commands_.IsIndirect();
+  if (ImGui::Checkbox("Multi-draw indirect", &indirect)) {
+    draw_commands_.SetIndirect(indirect);
+  }
+  ImGui::EndDisabled();
+  static const int kCubeFieldSizes[] = {0, 10, 100, 1000, 10000, 100000};
+  static const char* kCubeFieldNames[] = {"None", "10", "100", "1k", "10k", "100k"};
+  int cube_field = std::find(std::begin(kCubeFieldSizes), std::end(kCubeFieldSizes), cube_field_size_) -
+                   std::begin(kCubeFieldSizes);
+  if (ImGui::Combo("Cube field", &cube_field, kCubeFieldNames, IM_ARRAYSIZE(kCubeFieldNames))) {
+    SetCubeField(kCubeFieldSizes[cube_field]);
+  }
+  ImGui::Checkbox("Animate cube field", &animate_cube_field_);
+  auto transform_stats = cube_transforms_.GetStats();
+  ImGui::Text("Transforms (%s): %zu nodes, %zu levels, %zu updated in %.3f ms", TransformHierarchy::GetSimdName(),
+              transform_stats.nodes, transform_stats.levels, transform_stats.updated, transform_stats.update_ms);
+  ImGui::Text("Draw calls: %zu for %zu models, CPU submit %.3f ms", draw_calls_, models_.size(), submit_ms_);
+  if (instancing_) {
+    ImGui::Text("Draw runs: %zu, %zu commands", draw_runs_.size(), draw_command_count_);
+  }
+
+  auto& meshes = MeshCache::Get();
+  bool packed_vertices = meshes.IsPackedVertices();
+  ImGui::BeginDisabled(meshes.IsGeometryReleased());
+  if (ImGui::Checkbox("Packed vertices", &packed_vertices)) {
+    meshes.SetPackedVertices(packed_vertices);
+  }
+  ImGui::EndDisabled();
+  bool dense_meshes = dense_meshes_;
+  if (ImGui::Checkbox("Dense mesh scene", &dense_meshes)) {
+    SetDenseMeshes(dense_meshes);
+    meshes.EvictUnused();
+  }
+  ImGui::Checkbox("Per-vertex transforms (baseline)", &per_vertex_transforms_);
+  ImGui::Checkbox("Discard rasterization (vertex-bound timing)", &discard_rasterization_);
+  if (!meshes.IsGeometryReleased() && ImGui::Button("Release CPU geometry")) {
+    meshes.ReleaseGeometry();
+  }
+  auto mesh_usage = meshes.GetUsage();
+  auto geometry_stats = GeometryBuffer::Get().GetStats();
+  ImGui::Text("Geometry buffer: %zu pages, %.2f/%.2f MB used, %zu ranges, %zu free (%.0f%% fragmented)",
+              geometry_stats.pages, geometry_stats.used_bytes / (1024.0 * 1024.0),
+              geometry_stats.capacity_bytes / (1024.0 * 1024.0), geometry_stats.allocations,
+              geometry_stats.free_ranges, geometry_stats.fragmentation * 100.0f);
+  ImGui::Text("Compaction: %zu pages added, %zu released, %.2f MB moved", geometry_stats.pages_added,
+              geometry_stats.pages_released, geometry_stats.moved_bytes / (1024.0 * 1024.0));
+  ImGui::Text("Meshes: %zu for %zu models, %zu vertices", mesh_usage.meshes, mesh_usage.instances,
+              mesh_usage.vertices);
+  ImGui::Text("Geometry: %.2f MB on the GPU (%.2f MB unshared), %.2f MB on the CPU",
+              mesh_usage.gpu_bytes / (1024.0 * 1024.0), mesh_usage.unshared_gpu_bytes / (1024.0 * 1024.0),
+              mesh_usage.cpu_bytes / (1024.0 * 1024.0));
+  ImGui::Text("Vertex cache (FIFO %d): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", MeshOptimizer::kCacheSize,
+              mesh_usage.cache.before.acmr, mesh_usage.cache.after.acmr,
+              mesh_usage.cache.before.atvr, mesh_usage.cache.after.atvr);
+
+  auto& textures = MaterialTextures::Get();
+  auto texture_stats = textures.GetStats();
+  if (textures.IsBindless()) {
+    ImGui::Text("Material textures: bindless, %zu/%zu handles resident",
+                texture_stats.textures, texture_stats.capacity);
+  } else {
+    ImGui::Text("Material textures: %zu in %zu arrays (%zu layers, %.1f MB), %zu copies",
+                texture_stats.textures, texture_stats.buckets, texture_stats.capacity,
+                texture_stats.gpu_bytes / (1024.0 * 1024.0), texture_stats.copies);
+  }
+
+  ImGui::Separator();
+
   for (auto&& [name, material] : materials_) {
     if (material) {
       ImGui::PushID(name.c_str());
@@ -145,6 +449,8 @@ void Scene::Config() {
       if (ImGui::RadioButton("128", material->GetShininess() == 128)) { material->SetShinieness(128); } ImGui::SameLine();
       if (ImGui::RadioButton("256", material->GetShininess() == 256)) { material->SetShinieness(256); }
 
+      ImGui::Text("Shader variants: %zu", material->GetShaderVariantCount());
+
       ImGui::Separator();
 
       ImGui::PopID();
@@ -156,13 +462,15 @@ void Scene::Config() {
 }
 
 void Scene::InitShadowMisc() {
-  shadow_shader_ = std::make_shared<Shader>("shadow_shader.vs", "shadow_shader.fs");
+  shadow_shader_ = ShaderLibrary::Get().GetShader("shadow_shader.vs", "shadow_shader.fs");
+  instanced_shadow_shader_ = ShaderLibrary::Get().GetShader("shadow_shader.vs", "shadow_shader.fs",
+                                                            {{"INSTANCED", "1"}});
 
   // Shadow display
   glGenVertexArrays(1, &shadow_display_vao_);
   glGenBuffers(1, &shadow_display_vbo_);
 
-  glBindVertexArray(shadow_display_vao_);
+  GLStateCache::Get().BindVertexArray(shadow_display_vao_);
 
   glBindBuffer(GL_ARRAY_BUFFER, shadow_display_vbo_);
 
@@ -184,9 +492,9 @@ void Scene::InitShadowMisc() {
   glEnableVertexAttribArray(2);
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, (void*)(6 * sizeof(GLfloat)));
 
-  glBindVertexArray(0);
+  GLStateCache::Get().BindVertexArray(0);
 
-  shadow_display_shader_ = std::make_shared<Shader>("vertex_shader.vs", "shadow_display.fs");
+  shadow_display_shader_ = ShaderLibrary::Get().GetShader("vertex_shader.vs", "shadow_display.fs");
 }
 
 void Scene::DisplayShadowMap(const std::shared_ptr<LightController>& light_controller) {
@@ -228,9 +536,6 @@ void Scene::ApplyAndSetShaderGlobal(const std::shared_ptr<Shader>& shader,
                                     const std::shared_ptr<GlobalController>& global_controller) {
   shader->Use();
 
+  // Camera matrices come from the FrameConstants block.
   shader->SetBool("gamma", global_controller->IsGammaEnabled());
-  shader->SetMat4("view", global_controller->GetViewMatrix());
-  auto screen_size = global_controller->GetScreenSize();
-  shader->SetMat4("project", glm::perspective(glm::radians(45.0f), (float)screen_size.x / screen_size.y, 0.1f, 100.0f));
-  shader->SetVec3("view_position", global_controller->GetCameraPosition());
 }
@@ -5,13 +5,19 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 
 #include "global_controller.h"
+#include "gpu_timer.h"
+#include "draw_command_buffer.h"
+#include "instance_buffer.h"
 #include "light_controller.h"
 #include "material.h"
 #include "model.h"
+#include "thread_pool.h"
+#include "transform_hierarchy.h"
 #include "vertex.h"
 
 class Scene {
@@ -31,14 +37,47 @@ class Scene {
 
   void Config();
 
+  // Adds or removes a grid of finely tessellated spheres, to measure vertex
+  // throughput. They use the material and textures of the first model.
+  void SetDenseMeshes(bool enabled);
+
+  // Replaces the grid of small cubes measuring draw submission with one of
+  // |count| cubes, 0 removes it.
+  void SetCubeField(int count);
+
  private:
   void InitShadowMisc();
   void DisplayShadowMap(const std::shared_ptr<LightController>& light_controller);
 
+  // Turns the slabs of the cube field while animated, and hands the cubes
+  // their new transforms.
+  void UpdateCubeField();
+
+  // Drops the models whose names start with |prefix|.
+  void RemoveModels(const std::string& prefix);
+
+  // Models sharing material and textures, drawn together whatever their
+  // meshes as long as those share a GeometryBuffer page: one draw command
+  // per mesh, instancing its models.
+  struct DrawRun {
+    const std::string* material_name;
+    // Supplies the material state of the run.
+    const Model* model;
+    // Of GeometryBuffer.
+    int page;
+    std::size_t first_command;
+    std::size_t command_count;
+  };
+
+  // Groups the models into |draw_runs_| and uploads their instance data
+  // and draw commands.
+  void BuildDrawRuns();
+
   void ApplyAndSetShaderGlobal(const std::shared_ptr<Shader>& shader,
                                const std::shared_ptr<GlobalController>& global_controller);
 
   std::shared_ptr<Shader> shadow_shader_;
+  std::shared_ptr<Shader> instanced_shadow_shader_;
 
   GLuint shadow_display_vao_;
   GLuint shadow_display_vbo_;
@@ -47,6 +86,32 @@ class Scene {
   std::map<std::string, std::shared_ptr<Material>> materials_;
 
   std::map<std::string, std::pair<std::shared_ptr<Model>, std::string>> models_;
+
+  bool specialized_shaders_ = true;
+  bool dense_meshes_ = false;
+  // Vertex benchmark: the old per-vertex matrix work, and rasterisation
+  // discarded so the opaque pass time is the vertex stage only.
+  bool per_vertex_transforms_ = false;
+  bool discard_rasterization_ = false;
+  int cube_field_size_ = 0;
+  bool animate_cube_field_ = false;
+  // Shared by the per-frame work of the scene, e.g. transform updates.
+  ThreadPool frame_pool_;
+  // A root, a node per slab of the cube field and one per cube.
+  TransformHierarchy cube_transforms_;
+  std::vector<TransformHierarchy::Node> cube_slab_nodes_;
+  std::vector<std::pair<TransformHierarchy::Node, std::shared_ptr<Model>>> cube_nodes_;
+  GpuTimer opaque_timer_;
+
+  bool instancing_ = true;
+  InstanceBuffer instance_buffer_;
+  DrawCommandBuffer draw_commands_;
+  std::vector<DrawRun> draw_runs_;
+  std::size_t draw_command_count_ = 0;
+
+  // Of the last frame, shadow passes included.
+  std::size_t draw_calls_ = 0;
+  double submit_ms_ = 0.0;
 };
 
 #endif // SCENE_H_
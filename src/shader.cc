@@ -2,131 +2,492 @@
 
 #include "shader.h"
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <string>
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
-Shader::Shader(const char* vertex_shader_path, const char* fragment_shader_path) {
-  std::string direction(SHADER_PATH);
-  std::string vs_path = direction + std::string(vertex_shader_path);
-  std::string fs_path = direction + std::string(fragment_shader_path);
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "hash.h"
+#include "shader_library.h"
 
+std::size_t Shader::avoided_lookup_count_ = 0;
+Shader::UploadStats Shader::frame_upload_stats_;
+Shader::BuildStats Shader::build_stats_;
+std::set<Shader*> Shader::live_shaders_;
+
+Shader::Shader(const char* vertex_shader_path, const char* fragment_shader_path,
+               const ShaderDefines& defines)
+    : vertex_shader_path_(vertex_shader_path),
+      fragment_shader_path_(fragment_shader_path),
+      defines_(defines) {
   std::string vertex_code;
   std::string fragment_code;
+  ReadSources(vertex_code, fragment_code);
 
-  std::ifstream vertex_file;
-  std::ifstream fragment_file;
-
-  vertex_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fragment_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  try {
-    vertex_file.open(vs_path);
-    fragment_file.open(fs_path);
-
-    std::stringstream v_shader_stream, f_shader_stream;
-    v_shader_stream << vertex_file.rdbuf();
-    f_shader_stream << fragment_file.rdbuf();
+  auto start = std::chrono::steady_clock::now();
 
-    vertex_file.close();
-    fragment_file.close();
-
-    vertex_code = v_shader_stream.str();
-    fragment_code = f_shader_stream.str();
-  } catch (std::ifstream::failure& e) {
-    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+  std::string binary_path = GetBinaryCachePath(vertex_code, fragment_code);
+  bool from_cache = LoadProgramBinary(binary_path);
+  if (!from_cache) {
+    CompileAndLink();
+    SaveProgramBinary(binary_path);
   }
 
-  const char* v_shader_code = vertex_code.c_str();
-  const char* f_shader_code = fragment_code.c_str();
-
-  GLint success;
-  char info_log[512];
-  GLuint v_shader, f_shader;
-
-  v_shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(v_shader, 1, &v_shader_code, nullptr);
-  glCompileShader(v_shader);
-
-  glGetShaderiv(v_shader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(v_shader, 512, nullptr, info_log);
-    std::cout << "DongZhong: " << "Vertex shader compile error: " << info_log;
+  double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (from_cache) {
+    ++build_stats_.cache_hits;
+    build_stats_.cache_ms += elapsed_ms;
+  } else {
+    ++build_stats_.compiled;
+    build_stats_.compile_ms += elapsed_ms;
   }
 
-  f_shader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(f_shader, 1, &f_shader_code, nullptr);
-  glCompileShader(f_shader);
+  ReflectUniforms();
+  BindUniformBlocks();
 
-  glGetShaderiv(f_shader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(f_shader, 512, nullptr, info_log);
-    std::cout << "DongZhong: " << "Vertex shader compile error: " << info_log;
-  }
-
-  program_ = glCreateProgram();
-  glAttachShader(program_, v_shader);
-  glAttachShader(program_, f_shader);
-  glLinkProgram(program_);
-
-  glGetProgramiv(program_, GL_LINK_STATUS, &success);
-  if (!success) {
-    glGetProgramInfoLog(program_, 512, nullptr, info_log);
-    std::cout << "DongZhong: " << "Program link error: " << info_log;
-  }
+  live_shaders_.insert(this);
+}
 
-  glDeleteShader(v_shader);
-  glDeleteShader(f_shader);
+Shader::~Shader() {
+  live_shaders_.erase(this);
+  DiscardReload();
+  GLStateCache::Get().OnProgramDeleted(program_);
+  glDeleteProgram(program_);
 }
 
 void Shader::Use() const {
-  glUseProgram(program_);
+  GLStateCache::Get().UseProgram(program_);
+}
+
+Shader::Uniform Shader::GetUniform(const std::string& name) const {
+  ++avoided_lookup_count_;
+  auto it = uniform_slot_indices_.find(name);
+  if (it == uniform_slot_indices_.end()) {
+    // Not an active uniform, the driver would have returned -1 as well.
+    return Uniform();
+  }
+  return Uniform{it->second};
 }
 
 void Shader::SetBool(const std::string& name, bool value) const {
-  glUniform1i(glGetUniformLocation(program_, name.c_str()), (int)value);
+  SetBool(GetUniform(name), value);
+}
+
+void Shader::SetBool(Uniform uniform, bool value) const {
+  SetInt(uniform, (int)value);
 }
 
 void Shader::SetInt(const std::string& name, int value) const {
-  glUniform1i(glGetUniformLocation(program_, name.c_str()), value);
+  SetInt(GetUniform(name), value);
+}
+
+void Shader::SetInt(Uniform uniform, int value) const {
+  GLint location = PrepareUpload(uniform, &value, sizeof(value));
+  if (location >= 0) {
+    glUniform1i(location, value);
+  }
 }
 
 void Shader::SetFloat(const std::string& name, float value) const {
-  glUniform1f(glGetUniformLocation(program_, name.c_str()), value);
+  SetFloat(GetUniform(name), value);
+}
+
+void Shader::SetFloat(Uniform uniform, float value) const {
+  GLint location = PrepareUpload(uniform, &value, sizeof(value));
+  if (location >= 0) {
+    glUniform1f(location, value);
+  }
 }
 
 void Shader::SetVec2(const std::string& name, const glm::vec2& value) const {
-  glUniform2fv(glGetUniformLocation(program_, name.c_str()), 1, glm::value_ptr(value));
+  SetVec2(GetUniform(name), value);
+}
+
+void Shader::SetVec2(Uniform uniform, const glm::vec2& value) const {
+  GLint location = PrepareUpload(uniform, glm::value_ptr(value), sizeof(value));
+  if (location >= 0) {
+    glUniform2fv(location, 1, glm::value_ptr(value));
+  }
 }
 
 void Shader::SetVec2(const std::string& name, float x, float y) const {
-  glUniform2f(glGetUniformLocation(program_, name.c_str()), x, y);
+  SetVec2(GetUniform(name), glm::vec2(x, y));
 }
 
 void Shader::SetVec3(const std::string& name, const glm::vec3& value) const {
-  glUniform3fv(glGetUniformLocation(program_, name.c_str()), 1, glm::value_ptr(value));
+  SetVec3(GetUniform(name), value);
+}
+
+void Shader::SetVec3(Uniform uniform, const glm::vec3& value) const {
+  GLint location = PrepareUpload(uniform, glm::value_ptr(value), sizeof(value));
+  if (location >= 0) {
+    glUniform3fv(location, 1, glm::value_ptr(value));
+  }
 }
 
 void Shader::SetVec3(const std::string& name, float x, float y, float z) const {
-  glUniform3f(glGetUniformLocation(program_, name.c_str()), x, y, z);
+  SetVec3(GetUniform(name), glm::vec3(x, y, z));
 }
 
 void Shader::SetVec4(const std::string& name, const glm::vec4& value) const {
-  glUniform4fv(glGetUniformLocation(program_, name.c_str()), 1, glm::value_ptr(value));
+  SetVec4(GetUniform(name), value);
+}
+
+void Shader::SetVec4(Uniform uniform, const glm::vec4& value) const {
+  GLint location = PrepareUpload(uniform, glm::value_ptr(value), sizeof(value));
+  if (location >= 0) {
+    glUniform4fv(location, 1, glm::value_ptr(value));
+  }
 }
 
 void Shader::SetVec4(const std::string& name, float x, float y, float z, float w) const {
-  glUniform4f(glGetUniformLocation(program_, name.c_str()), x, y, z, w);
+  SetVec4(GetUniform(name), glm::vec4(x, y, z, w));
 }
 
 void Shader::SetMat2(const std::string& name, const glm::mat2& value) const {
-  glUniformMatrix2fv(glGetUniformLocation(program_, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+  SetMat2(GetUniform(name), value);
+}
+
+void Shader::SetMat2(Uniform uniform, const glm::mat2& value) const {
+  GLint location = PrepareUpload(uniform, glm::value_ptr(value), sizeof(value));
+  if (location >= 0) {
+    glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value));
+  }
 }
 
 void Shader::SetMat3(const std::string& name, const glm::mat3& value) const {
-  glUniformMatrix3fv(glGetUniformLocation(program_, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+  SetMat3(GetUniform(name), value);
+}
+
+void Shader::SetMat3(Uniform uniform, const glm::mat3& value) const {
+  GLint location = PrepareUpload(uniform, glm::value_ptr(value), sizeof(value));
+  if (location >= 0) {
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+  }
 }
 
 void Shader::SetMat4(const std::string& name, const glm::mat4& value) const {
-  glUniformMatrix4fv(glGetUniformLocation(program_, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+  SetMat4(GetUniform(name), value);
+}
+
+void Shader::SetMat4(Uniform uniform, const glm::mat4& value) const {
+  GLint location = PrepareUpload(uniform, glm::value_ptr(value), sizeof(value));
+  if (location >= 0) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+  }
+}
+
+void Shader::ResetFrameUploadStats() {
+  frame_upload_stats_ = UploadStats();
+}
+
+void Shader::ReloadSources(const std::set<std::string>& changed_files) {
+  for (Shader* shader : live_shaders_) {
+    if (changed_files.count(shader->vertex_shader_path_) > 0 ||
+        changed_files.count(shader->fragment_shader_path_) > 0) {
+      shader->BeginReload();
+    }
+  }
+}
+
+void Shader::PollReloads() {
+  for (Shader* shader : live_shaders_) {
+    if (shader->reload_.program != 0) {
+      shader->PollReload();
+    }
+  }
+}
+
+bool Shader::ReadSources(std::string& vertex_code, std::string& fragment_code) const {
+  auto& library = ShaderLibrary::Get();
+  vertex_code = library.GetStageCode(vertex_shader_path_, defines_);
+  fragment_code = library.GetStageCode(fragment_shader_path_, defines_);
+  return !vertex_code.empty() && !fragment_code.empty();
+}
+
+bool Shader::CheckProgram(GLuint program) {
+  GLint success;
+  char info_log[512];
+
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    glGetProgramInfoLog(program, 512, nullptr, info_log);
+    std::cout << "DongZhong: " << "Program link error: " << info_log;
+  }
+  return success;
+}
+
+GLuint Shader::CreateProgram(GLuint v_shader, GLuint f_shader) {
+  GLuint program = glCreateProgram();
+  if (GLExtensions::has_program_binary) {
+    GLExtensions::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  if (v_shader != 0) {
+    glAttachShader(program, v_shader);
+  }
+  if (f_shader != 0) {
+    glAttachShader(program, f_shader);
+  }
+  glLinkProgram(program);
+
+  return program;
+}
+
+void Shader::CompileAndLink() {
+  // The stages belong to the library and are shared with other programs.
+  auto& library = ShaderLibrary::Get();
+  GLuint v_shader = library.GetStage(GL_VERTEX_SHADER, vertex_shader_path_, defines_);
+  GLuint f_shader = library.GetStage(GL_FRAGMENT_SHADER, fragment_shader_path_, defines_);
+
+  program_ = CreateProgram(v_shader, f_shader);
+  CheckProgram(program_);
+
+  if (v_shader != 0) {
+    glDetachShader(program_, v_shader);
+  }
+  if (f_shader != 0) {
+    glDetachShader(program_, f_shader);
+  }
+}
+
+void Shader::BeginReload() {
+  DiscardReload();
+
+  std::string vertex_code;
+  std::string fragment_code;
+  if (!ReadSources(vertex_code, fragment_code)) {
+    return;
+  }
+
+  // Nothing here waits for the driver, the status is only looked at once the
+  // compile has finished, see PollReload().
+  reload_.binary_path = GetBinaryCachePath(vertex_code, fragment_code);
+  reload_.vertex_shader = ShaderLibrary::CreateStage(GL_VERTEX_SHADER, vertex_code);
+  reload_.fragment_shader = ShaderLibrary::CreateStage(GL_FRAGMENT_SHADER, fragment_code);
+  reload_.program = CreateProgram(reload_.vertex_shader, reload_.fragment_shader);
+  reload_.frames_waited = 0;
+}
+
+void Shader::PollReload() {
+  if (GLExtensions::has_parallel_shader_compile) {
+    GLint completed = GL_FALSE;
+    glGetProgramiv(reload_.program, GL_COMPLETION_STATUS_KHR, &completed);
+    if (!completed) {
+      return;
+    }
+  } else if (reload_.frames_waited++ < kReloadWaitFrames) {
+    // Without the extension any status query blocks until the compile is
+    // done, give the driver's own threads a head start.
+    return;
+  }
+
+  bool vertex_ok = ShaderLibrary::CheckStage(reload_.vertex_shader, GL_VERTEX_SHADER);
+  bool fragment_ok = ShaderLibrary::CheckStage(reload_.fragment_shader, GL_FRAGMENT_SHADER);
+  if (!vertex_ok || !fragment_ok || !CheckProgram(reload_.program)) {
+    std::cout << "DongZhong: " << "Reloading " << vertex_shader_path_ << " + " << fragment_shader_path_
+              << " failed, keeping the previous program" << std::endl;
+    ++build_stats_.reload_failed;
+    DiscardReload();
+    return;
+  }
+
+  // Swap at the frame boundary. Uniform handles survive since slots are kept
+  // by name, their cached values are dropped by ReflectUniforms().
+  GLStateCache::Get().OnProgramDeleted(program_);
+  glDeleteProgram(program_);
+  program_ = reload_.program;
+  reload_.program = 0;
+
+  SaveProgramBinary(reload_.binary_path);
+  ReflectUniforms();
+  BindUniformBlocks();
+  DiscardReload();
+
+  ++build_stats_.reloaded;
+}
+
+void Shader::DiscardReload() {
+  if (reload_.program != 0) {
+    glDeleteProgram(reload_.program);
+  }
+  if (reload_.vertex_shader != 0) {
+    glDeleteShader(reload_.vertex_shader);
+  }
+  if (reload_.fragment_shader != 0) {
+    glDeleteShader(reload_.fragment_shader);
+  }
+  reload_ = PendingReload();
+}
+
+std::string Shader::GetBinaryCachePath(const std::string& vertex_code, const std::string& fragment_code) {
+  if (!GLExtensions::has_program_binary) {
+    return std::string();
+  }
+
+  // Binaries are only valid for the driver which produced them.
+  std::string key = vertex_code + '\0' + fragment_code + '\0' +
+                    reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + '\0' +
+                    reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+  std::uint64_t hash = HashString(key);
+
+  char file_name[32];
+  std::snprintf(file_name, sizeof(file_name), "%016llx.bin", (unsigned long long)hash);
+  return std::string(SHADER_CACHE_PATH) + file_name;
+}
+
+bool Shader::LoadProgramBinary(const std::string& path) {
+  if (path.empty()) {
+    return false;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  GLenum format = 0;
+  file.read(reinterpret_cast<char*>(&format), sizeof(format));
+  if (!file) {
+    return false;
+  }
+  std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (binary.empty()) {
+    return false;
+  }
+
+  program_ = glCreateProgram();
+  GLExtensions::ProgramBinary(program_, format, binary.data(), (GLsizei)binary.size());
+
+  // Drivers reject binaries after an update, fall back to a full compile.
+  GLint success = GL_FALSE;
+  glGetProgramiv(program_, GL_LINK_STATUS, &success);
+  if (!success) {
+    glDeleteProgram(program_);
+    program_ = 0;
+    ++build_stats_.cache_rejected;
+    return false;
+  }
+
+  return true;
+}
+
+void Shader::SaveProgramBinary(const std::string& path) const {
+  if (path.empty()) {
+    return;
+  }
+
+  GLint success = GL_FALSE;
+  glGetProgramiv(program_, GL_LINK_STATUS, &success);
+  GLint length = 0;
+  glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (!success || length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  GLExtensions::GetProgramBinary(program_, length, nullptr, &format, binary.data());
+
+  std::error_code error;
+  std::filesystem::create_directories(SHADER_CACHE_PATH, error);
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    std::cout << "DongZhong: " << "Failed to write program binary: " << path << std::endl;
+    return;
+  }
+  file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  file.write(binary.data(), binary.size());
+}
+
+void Shader::ReflectUniforms() {
+  // Keep the slots of names seen before, so handles stay valid after a reload.
+  for (auto& slot : uniform_slots_) {
+    slot = UniformSlot();
+  }
+
+  GLint uniform_count = 0;
+  GLint max_name_length = 0;
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &uniform_count);
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+  std::vector<GLchar> name_buffer(max_name_length + 1);
+  for (GLint i = 0; i < uniform_count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type;
+    glGetActiveUniform(program_, i, (GLsizei)name_buffer.size(), &length, &size, &type, name_buffer.data());
+
+    std::string name(name_buffer.data(), length);
+    GLint location = glGetUniformLocation(program_, name.c_str());
+    if (location < 0) {
+      // Members of uniform blocks have no location.
+      continue;
+    }
+    AddUniform(name, location);
+
+    // Arrays of basic types are reported once as "name[0]". Register the bare
+    // name and every element so callers can use either spelling.
+    const std::string kArraySuffix = "[0]";
+    if (name.size() > kArraySuffix.size() &&
+        name.compare(name.size() - kArraySuffix.size(), kArraySuffix.size(), kArraySuffix) == 0) {
+      std::string base = name.substr(0, name.size() - kArraySuffix.size());
+      uniform_slot_indices_[base] = uniform_slot_indices_[name];
+      for (GLint element = 1; element < size; ++element) {
+        std::string element_name = base + "[" + std::to_string(element) + "]";
+        AddUniform(element_name, glGetUniformLocation(program_, element_name.c_str()));
+      }
+    }
+  }
+}
+
+void Shader::BindUniformBlocks() {
+  static const std::pair<const char*, UniformBlock> kBlocks[] = {
+    {"Lights", UniformBlock::kLights},
+    {"FrameConstants", UniformBlock::kFrameConstants},
+    {"MaterialTextures", UniformBlock::kMaterialTextures},
+  };
+
+  for (auto&& [name, binding] : kBlocks) {
+    GLuint index = glGetUniformBlockIndex(program_, name);
+    if (index != GL_INVALID_INDEX) {
+      glUniformBlockBinding(program_, index, (GLuint)binding);
+    }
+  }
+}
+
+void Shader::AddUniform(const std::string& name, GLint location) {
+  auto [it, inserted] = uniform_slot_indices_.try_emplace(name, (GLint)uniform_slots_.size());
+  if (inserted) {
+    uniform_slots_.emplace_back();
+  }
+  uniform_slots_[it->second].location = location;
+}
+
+GLint Shader::PrepareUpload(Uniform uniform, const void* value, std::size_t size) const {
+  if (uniform.slot < 0) {
+    return -1;
+  }
+
+  auto& slot = uniform_slots_[uniform.slot];
+  if (slot.location < 0) {
+    return -1;
+  }
+  if (slot.size == size && std::memcmp(slot.data.data(), value, size) == 0) {
+    ++frame_upload_stats_.skipped;
+    return -1;
+  }
+
+  std::memcpy(slot.data.data(), value, size);
+  slot.size = size;
+  ++frame_upload_stats_.issued;
+  return slot.location;
 }
@@ -3,7 +3,12 @@
 #ifndef SHADER_H_
 #define SHADER_H_
 
+#include <array>
+#include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -11,39 +16,173 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #define SHADER_PATH "/Users/bilibili/DongZhong/myCodes/LearnOpenGL/res/shaders/"
+#define SHADER_CACHE_PATH SHADER_PATH "../../cache/shaders/"
+
+// Preprocessor definitions injected right after the #version line, used to
+// compile specialised variants of one source.
+using ShaderDefines = std::map<std::string, std::string>;
 
 class Shader {
  public:
-  Shader(const char* vertex_shader_path, const char* fragment_shader_path);
+  // Fixed binding points of the uniform blocks shared by every program.
+  enum class UniformBlock : GLuint {
+    kLights = 0,
+    kFrameConstants = 1,
+    kMaterialTextures = 2,
+  };
+
+  // Pre-resolved uniform handle, stays valid when the program is reloaded. A
+  // default constructed one is silently ignored by the setters, the same as
+  // an inactive uniform.
+  struct Uniform {
+    GLint slot = -1;
+  };
+
+  struct UploadStats {
+    std::size_t issued = 0;
+    std::size_t skipped = 0;
+  };
+
+  // Programs compiled from source versus loaded from the binary cache, with
+  // the wall time spent on each.
+  struct BuildStats {
+    std::size_t compiled = 0;
+    std::size_t cache_hits = 0;
+    std::size_t cache_rejected = 0;
+    double compile_ms = 0.0;
+    double cache_ms = 0.0;
+    std::size_t reloaded = 0;
+    std::size_t reload_failed = 0;
+  };
+
+  Shader(const char* vertex_shader_path, const char* fragment_shader_path,
+         const ShaderDefines& defines = ShaderDefines());
+  ~Shader();
+
+  Shader(const Shader&) = delete;
+  Shader& operator=(const Shader&) = delete;
 
   void Use() const;
 
+  Uniform GetUniform(const std::string& name) const;
+
   void SetBool(const std::string& name, bool value) const;
+  void SetBool(Uniform uniform, bool value) const;
 
   void SetInt(const std::string& name, int value) const;
+  void SetInt(Uniform uniform, int value) const;
 
   void SetFloat(const std::string& name, float value) const;
+  void SetFloat(Uniform uniform, float value) const;
 
   void SetVec2(const std::string& name, const glm::vec2& value) const;
+  void SetVec2(Uniform uniform, const glm::vec2& value) const;
 
   void SetVec2(const std::string& name, float x, float y) const;
 
   void SetVec3(const std::string& name, const glm::vec3& value) const;
+  void SetVec3(Uniform uniform, const glm::vec3& value) const;
 
   void SetVec3(const std::string& name, float x, float y, float z) const;
 
   void SetVec4(const std::string& name, const glm::vec4& value) const;
+  void SetVec4(Uniform uniform, const glm::vec4& value) const;
 
   void SetVec4(const std::string& name, float x, float y, float z, float w) const;
 
   void SetMat2(const std::string& name, const glm::mat2& value) const;
+  void SetMat2(Uniform uniform, const glm::mat2& value) const;
 
   void SetMat3(const std::string& name, const glm::mat3& value) const;
+  void SetMat3(Uniform uniform, const glm::mat3& value) const;
 
   void SetMat4(const std::string& name, const glm::mat4& value) const;
+  void SetMat4(Uniform uniform, const glm::mat4& value) const;
+
+  // Number of glGetUniformLocation calls answered by the reflection cache,
+  // summed over all programs.
+  static std::size_t GetAvoidedLookupCount() { return avoided_lookup_count_; }
+
+  // glUniform* calls issued and skipped because the program already held the
+  // value, summed over all programs since the last reset.
+  static UploadStats GetFrameUploadStats() { return frame_upload_stats_; }
+  static void ResetFrameUploadStats();
+
+  static BuildStats GetBuildStats() { return build_stats_; }
+
+  // Starts recompiling every live program built from one of |changed_files|
+  // (names relative to SHADER_PATH). Doesn't wait for the driver.
+  static void ReloadSources(const std::set<std::string>& changed_files);
+
+  // Swaps in the reloaded programs whose compile finished. Call at a frame
+  // boundary. A program which fails to build keeps the previous one.
+  static void PollReloads();
 
  private:
+  // Location of a reflected uniform and a CPU side copy of the last value
+  // uploaded to it. Big enough for a mat4, the largest type we set.
+  struct UniformSlot {
+    GLint location = -1;
+    std::array<unsigned char, sizeof(glm::mat4)> data;
+    std::size_t size = 0;
+  };
+
+  // Program being rebuilt in the background after its sources changed.
+  struct PendingReload {
+    GLuint program = 0;
+    GLuint vertex_shader = 0;
+    GLuint fragment_shader = 0;
+    std::string binary_path;
+    std::size_t frames_waited = 0;
+  };
+
+  // Frames to leave the driver alone when it can't report compile progress.
+  static const std::size_t kReloadWaitFrames = 2;
+
+  bool ReadSources(std::string& vertex_code, std::string& fragment_code) const;
+
+  static GLuint CreateProgram(GLuint v_shader, GLuint f_shader);
+  static bool CheckProgram(GLuint program);
+
+  void CompileAndLink();
+
+  void BeginReload();
+  void PollReload();
+  void DiscardReload();
+
+  // Program binaries are cached on disk, keyed by the final source text and
+  // the driver. An empty path means the driver can't hand out binaries.
+  static std::string GetBinaryCachePath(const std::string& vertex_code, const std::string& fragment_code);
+  bool LoadProgramBinary(const std::string& path);
+  void SaveProgramBinary(const std::string& path) const;
+
+  void ReflectUniforms();
+
+  void BindUniformBlocks();
+
+  void AddUniform(const std::string& name, GLint location);
+
+  // Returns the location to upload |value| to, or -1 when |uniform| is
+  // inactive or already holds |value|.
+  GLint PrepareUpload(Uniform uniform, const void* value, std::size_t size) const;
+
+  std::string vertex_shader_path_;
+  std::string fragment_shader_path_;
+  ShaderDefines defines_;
+
   GLuint program_;
+
+  PendingReload reload_;
+
+  std::unordered_map<std::string, GLint> uniform_slot_indices_;
+
+  mutable std::vector<UniformSlot> uniform_slots_;
+
+  static std::size_t avoided_lookup_count_;
+  static UploadStats frame_upload_stats_;
+  static BuildStats build_stats_;
+
+  static std::set<Shader*> live_shaders_;
 };
 
 #endif // SHADER_H_
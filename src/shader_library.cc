@@ -0,0 +1,188 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "shader_library.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+ShaderLibrary& ShaderLibrary::Get() {
+  static ShaderLibrary library;
+  return library;
+}
+
+std::shared_ptr<Shader> ShaderLibrary::GetShader(const std::string& vertex_shader_path,
+                                                 const std::string& fragment_shader_path,
+                                                 const ShaderDefines& defines) {
+  // Key on the defines the stages actually see, so variants differing only in
+  // unused switches share one program.
+  std::string key = vertex_shader_path + "|" + fragment_shader_path;
+  for (auto&& path : {vertex_shader_path, fragment_shader_path}) {
+    if (const std::string* source = GetSource(path)) {
+      key += "|" + MakeKey(FilterDefines(*source, defines));
+    }
+  }
+
+  auto& program = programs_[key];
+  if (auto shader = program.lock()) {
+    ++stats_.program_hits;
+    return shader;
+  }
+
+  auto shader = std::make_shared<Shader>(vertex_shader_path.c_str(), fragment_shader_path.c_str(), defines);
+  program = shader;
+  ++stats_.programs_created;
+  return shader;
+}
+
+std::string ShaderLibrary::GetStageCode(const std::string& path, const ShaderDefines& defines) {
+  const std::string* source = GetSource(path);
+  if (!source) {
+    return std::string();
+  }
+  return InjectDefines(*source, FilterDefines(*source, defines));
+}
+
+GLuint ShaderLibrary::GetStage(GLenum type, const std::string& path, const ShaderDefines& defines) {
+  const std::string* source = GetSource(path);
+  if (!source) {
+    return 0;
+  }
+
+  auto stage_defines = FilterDefines(*source, defines);
+  StageKey key{type, path, MakeKey(stage_defines)};
+  auto it = stages_.find(key);
+  if (it != stages_.end()) {
+    ++stats_.stage_hits;
+    return it->second;
+  }
+
+  GLuint stage = CreateStage(type, InjectDefines(*source, stage_defines));
+  ++stats_.stages_compiled;
+  if (!CheckStage(stage, type)) {
+    glDeleteShader(stage);
+    return 0;
+  }
+
+  stages_[key] = stage;
+  return stage;
+}
+
+void ShaderLibrary::Invalidate(const std::set<std::string>& changed_files) {
+  for (auto&& path : changed_files) {
+    sources_.erase(path);
+  }
+
+  for (auto it = stages_.begin(); it != stages_.end(); ) {
+    if (changed_files.count(it->first.path) > 0) {
+      glDeleteShader(it->second);
+      it = stages_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ShaderLibrary::Clear() {
+  for (auto&& [key, stage] : stages_) {
+    glDeleteShader(stage);
+  }
+  stages_.clear();
+  sources_.clear();
+  programs_.clear();
+}
+
+void ShaderLibrary::PrintReport() const {
+  std::cout << "DongZhong: " << "Shader library: "
+            << stats_.sources_read << " files read (" << stats_.source_hits << " reused), "
+            << stats_.stages_compiled << " stages compiled (" << stats_.stage_hits << " reused), "
+            << stats_.programs_created << " programs created (" << stats_.program_hits << " reused), "
+            << stats_.stage_hits + stats_.program_hits << " compiles saved" << std::endl;
+}
+
+GLuint ShaderLibrary::CreateStage(GLenum type, const std::string& code) {
+  const char* shader_code = code.c_str();
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &shader_code, nullptr);
+  glCompileShader(shader);
+
+  return shader;
+}
+
+bool ShaderLibrary::CheckStage(GLuint shader, GLenum type) {
+  GLint success;
+  char info_log[512];
+
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    glGetShaderInfoLog(shader, 512, nullptr, info_log);
+    const char* label = type == GL_VERTEX_SHADER ? "Vertex" : "Fragment";
+    std::cout << "DongZhong: " << label << " shader compile error: " << info_log;
+  }
+  return success;
+}
+
+std::string ShaderLibrary::InjectDefines(const std::string& code, const ShaderDefines& defines) {
+  if (defines.empty()) {
+    return code;
+  }
+
+  // The #version directive has to stay first.
+  std::size_t version_end = 0;
+  if (code.compare(0, 8, "#version") == 0) {
+    version_end = code.find('\n');
+    version_end = version_end == std::string::npos ? code.size() : version_end + 1;
+  }
+
+  std::string injected;
+  for (auto&& [name, value] : defines) {
+    injected += "#define " + name + " " + value + "\n";
+  }
+  // Keep the line numbers of compile errors pointing at the source file.
+  injected += version_end > 0 ? "#line 2\n" : "#line 1\n";
+
+  return code.substr(0, version_end) + injected + code.substr(version_end);
+}
+
+const std::string* ShaderLibrary::GetSource(const std::string& path) {
+  auto it = sources_.find(path);
+  if (it != sources_.end()) {
+    ++stats_.source_hits;
+    return &it->second;
+  }
+
+  std::ifstream file;
+  file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  try {
+    file.open(std::string(SHADER_PATH) + path);
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    file.close();
+
+    ++stats_.sources_read;
+    return &(sources_[path] = stream.str());
+  } catch (std::ifstream::failure& e) {
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << " " << e.what() << std::endl;
+    return nullptr;
+  }
+}
+
+ShaderDefines ShaderLibrary::FilterDefines(const std::string& source, const ShaderDefines& defines) {
+  ShaderDefines used;
+  for (auto&& [name, value] : defines) {
+    if (source.find(name) != std::string::npos) {
+      used[name] = value;
+    }
+  }
+  return used;
+}
+
+std::string ShaderLibrary::MakeKey(const ShaderDefines& defines) {
+  std::string key;
+  for (auto&& [name, value] : defines) {
+    key += name + "=" + value + ";";
+  }
+  return key;
+}
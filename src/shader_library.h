@@ -0,0 +1,87 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef SHADER_LIBRARY_H_
+#define SHADER_LIBRARY_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+
+#include <glad/glad.h>
+
+#include "shader.h"
+
+// Shares shader work between programs: source files are read once, compiled
+// stage objects are cached by (path, stage, defines) and reused by every
+// program linking them, and requesting an existing program returns it.
+class ShaderLibrary {
+ public:
+  struct Stats {
+    std::size_t sources_read = 0;
+    std::size_t source_hits = 0;
+    std::size_t stages_compiled = 0;
+    std::size_t stage_hits = 0;
+    std::size_t programs_created = 0;
+    std::size_t program_hits = 0;
+  };
+
+  static ShaderLibrary& Get();
+
+  std::shared_ptr<Shader> GetShader(const std::string& vertex_shader_path,
+                                    const std::string& fragment_shader_path,
+                                    const ShaderDefines& defines = ShaderDefines());
+
+  // Source of |path| (relative to SHADER_PATH) with the defines it refers to
+  // injected. Empty if the file can't be read.
+  std::string GetStageCode(const std::string& path, const ShaderDefines& defines);
+
+  // Compiled shader object, owned by the library. Returns 0 on failure.
+  GLuint GetStage(GLenum type, const std::string& path, const ShaderDefines& defines);
+
+  // Forgets sources and stages built from |changed_files|.
+  void Invalidate(const std::set<std::string>& changed_files);
+
+  // Deletes the cached GL objects. Call before the context goes away.
+  void Clear();
+
+  Stats GetStats() const { return stats_; }
+
+  void PrintReport() const;
+
+  static GLuint CreateStage(GLenum type, const std::string& code);
+  static bool CheckStage(GLuint shader, GLenum type);
+
+  static std::string InjectDefines(const std::string& code, const ShaderDefines& defines);
+
+ private:
+  ShaderLibrary() = default;
+
+  const std::string* GetSource(const std::string& path);
+
+  // Only the defines a stage actually mentions take part in its key, so e.g.
+  // the vertex stage is shared by all fragment shader variants.
+  static ShaderDefines FilterDefines(const std::string& source, const ShaderDefines& defines);
+
+  static std::string MakeKey(const ShaderDefines& defines);
+
+  std::map<std::string, std::string> sources_;
+
+  struct StageKey {
+    GLenum type;
+    std::string path;
+    std::string defines;
+
+    bool operator<(const StageKey& other) const {
+      return std::tie(type, path, defines) < std::tie(other.type, other.path, other.defines);
+    }
+  };
+  std::map<StageKey, GLuint> stages_;
+
+  std::map<std::string, std::weak_ptr<Shader>> programs_;
+
+  Stats stats_;
+};
+
+#endif // SHADER_LIBRARY_H_
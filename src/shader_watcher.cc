@@ -0,0 +1,113 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "shader_watcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "shader.h"
+#include "shader_library.h"
+
+const int kPollIntervalMs = 100;
+
+ShaderWatcher::ShaderWatcher(const std::string& directory)
+    : directory_(directory),
+      running_(true) {
+  thread_ = std::thread(&ShaderWatcher::Run, this);
+}
+
+ShaderWatcher::~ShaderWatcher() {
+  running_ = false;
+  thread_.join();
+}
+
+void ShaderWatcher::Update() {
+  std::set<std::string> changed_files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    changed_files.swap(changed_files_);
+  }
+
+  if (!changed_files.empty()) {
+    ShaderLibrary::Get().Invalidate(changed_files);
+    Shader::ReloadSources(changed_files);
+  }
+  Shader::PollReloads();
+}
+
+#ifdef __linux__
+
+void ShaderWatcher::Run() {
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0 || inotify_add_watch(fd, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    std::cout << "DongZhong: " << "Failed to watch " << directory_ << std::endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return;
+  }
+
+  alignas(inotify_event) char buffer[4096];
+  while (running_) {
+    pollfd poll_fd = {fd, POLLIN, 0};
+    if (poll(&poll_fd, 1, kPollIntervalMs) <= 0) {
+      continue;
+    }
+
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (char* ptr = buffer; ptr < buffer + length; ) {
+      auto* event = reinterpret_cast<inotify_event*>(ptr);
+      if (event->len > 0) {
+        changed_files_.insert(event->name);
+      }
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
+
+  close(fd);
+}
+
+#else
+
+void ShaderWatcher::Run() {
+  auto scan = [this]() {
+    std::map<std::string, std::filesystem::file_time_type> write_times;
+    std::error_code error;
+    for (auto&& entry : std::filesystem::directory_iterator(directory_, error)) {
+      if (entry.is_regular_file(error)) {
+        write_times[entry.path().filename().string()] = entry.last_write_time(error);
+      }
+    }
+    return write_times;
+  };
+
+  auto write_times = scan();
+  while (running_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kPollIntervalMs));
+
+    auto current = scan();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto&& [name, time] : current) {
+      auto it = write_times.find(name);
+      if (it == write_times.end() || it->second != time) {
+        changed_files_.insert(name);
+      }
+    }
+    write_times.swap(current);
+  }
+}
+
+#endif
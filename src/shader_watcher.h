@@ -0,0 +1,35 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef SHADER_WATCHER_H_
+#define SHADER_WATCHER_H_
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// Watches the shader directory from a background thread (inotify on Linux,
+// modification time polling elsewhere) and hot-reloads the programs built
+// from files that changed.
+class ShaderWatcher {
+ public:
+  explicit ShaderWatcher(const std::string& directory);
+  ~ShaderWatcher();
+
+  // Call once per frame on the GL thread, before rendering.
+  void Update();
+
+ private:
+  void Run();
+
+  std::string directory_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::set<std::string> changed_files_;
+};
+
+#endif // SHADER_WATCHER_H_
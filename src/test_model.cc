@@ -2,6 +2,8 @@
 
 #include "test_model.h"
 
+#include <cmath>
+
 const glm::vec3 pos_1(-0.5f, -0.5f, -0.5f);
 const glm::vec3 pos_2(0.5f, -0.5f, -0.5f);
 const glm::vec3 pos_3(0.5f, 0.5f, -0.5f);
@@ -109,3 +111,29 @@ std::vector<glm::vec3> TestModel::cube_positions = std::vector<glm::vec3>(cube_p
 std::vector<Vertex> TestModel::plane_vertices = std::vector<Vertex>(plane_vertex_array, plane_vertex_array + 4);
 
 std::vector<GLuint> TestModel::plane_indices = std::vector<GLuint>(plane_index_array, plane_index_array + 6);
+
+void TestModel::MakeSphere(float radius, int rings, int segments,
+                           std::vector<Vertex>* vertices, std::vector<GLuint>* indices) {
+  const float kPi = 3.14159265358979f;
+  vertices->clear();
+  indices->clear();
+
+  for (int ring = 0; ring <= rings; ++ring) {
+    float v = (float)ring / rings;
+    float phi = v * kPi;
+    for (int segment = 0; segment <= segments; ++segment) {
+      float u = (float)segment / segments;
+      float theta = u * 2.0f * kPi;
+      glm::vec3 normal(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+      vertices->emplace_back(normal * radius, normal, glm::vec2(u, v));
+    }
+  }
+
+  for (int ring = 0; ring < rings; ++ring) {
+    for (int segment = 0; segment < segments; ++segment) {
+      GLuint first = ring * (segments + 1) + segment;
+      GLuint second = first + segments + 1;
+      indices->insert(indices->end(), {first, first + 1, second, second, first + 1, second + 1});
+    }
+  }
+}
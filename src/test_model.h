@@ -17,6 +17,10 @@ class TestModel {
 
   static std::vector<Vertex> plane_vertices;
   static std::vector<GLuint> plane_indices;
+
+  // UV sphere of |rings| x |segments| quads, for vertex heavy scenes.
+  static void MakeSphere(float radius, int rings, int segments,
+                         std::vector<Vertex>* vertices, std::vector<GLuint>* indices);
 };
 
 #endif // TEST_MODEL_H_
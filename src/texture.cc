@@ -2,58 +2,236 @@
 
 #include "texture.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "stb_image.h"
 
-Texture::Texture(GLuint texture_id) : texture_id_(texture_id) {}
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "ktx2.h"
 
-GLuint TextureFromFile(const char* path, const std::string& directory, bool gamma) {
+Texture::LoadStats Texture::load_stats_[2];
+
+Texture::Texture(GLuint texture_id, std::size_t gpu_bytes, bool is_ready)
+    : texture_id_(texture_id),
+      gpu_bytes_(gpu_bytes),
+      is_ready_(is_ready) {}
+
+Texture::~Texture() {
+  if (is_ready_) {
+    GLStateCache::Get().OnTextureDeleted(texture_id_);
+    glDeleteTextures(1, &texture_id_);
+  }
+}
+
+void Texture::SetReady(GLuint texture_id, std::size_t gpu_bytes) {
+  if (is_ready_) {
+    GLStateCache::Get().OnTextureDeleted(texture_id_);
+    glDeleteTextures(1, &texture_id_);
+  }
+  texture_id_ = texture_id;
+  gpu_bytes_ = gpu_bytes;
+  is_ready_ = true;
+}
+
+void Texture::SetResidentLevels(int base_level, std::size_t gpu_bytes) {
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, texture_id_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base_level);
+  base_level_ = base_level;
+  gpu_bytes_ = gpu_bytes;
+  is_streamed_ = true;
+}
+
+void Texture::AddLoadStats(bool compressed, double decode_ms, double mip_ms, double upload_ms,
+                           std::size_t gpu_bytes) {
+  auto& stats = load_stats_[compressed];
+  ++stats.loaded;
+  stats.decode_ms += decode_ms;
+  stats.mip_ms += mip_ms;
+  stats.upload_ms += upload_ms;
+  stats.gpu_bytes += gpu_bytes;
+}
+
+void GetTextureFormat(int channels, bool gamma, GLint* internal_format, GLenum* format) {
+  // Sized formats, as immutable storage requires them.
+  if (channels == 1) {
+    *internal_format = GL_R8;
+    *format = GL_RED;
+  } else if (channels == 2) {
+    *internal_format = GL_RG8;
+    *format = GL_RG;
+  } else if (channels == 3) {
+    *format = GL_RGB;
+    if (gamma) {
+      *internal_format = GL_SRGB8;
+    } else {
+      *internal_format = GL_RGB8;
+    }
+  } else {
+    *format = GL_RGBA;
+    if (gamma) {
+      *internal_format = GL_SRGB8_ALPHA8;
+    } else {
+      *internal_format = GL_RGBA8;
+    }
+  }
+}
+
+bool DecodeImageFile(const std::string& file_name, PngDecoder::Image* image, ThreadPool* pool) {
+  if (PngDecoder::Load(file_name, image, pool)) {
+    return true;
+  }
+
+  unsigned char* pixels = stbi_load(file_name.c_str(), &image->width, &image->height, &image->channels, 0);
+  if (!pixels) {
+    return false;
+  }
+  image->pixels.assign(pixels, pixels + (std::size_t)image->width * image->height * image->channels);
+  stbi_image_free(pixels);
+  return true;
+}
+
+std::size_t EstimateTextureBytes(int width, int height, int channels) {
+  // Drivers pad RGB texels to 4 bytes, the mip chain adds another third.
+  std::size_t texel_bytes = channels == 3 ? 4 : channels;
+  return (std::size_t)width * height * texel_bytes * 4 / 3;
+}
+
+void ApplyTextureSampler(const TextureSampler& sampler) {
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrap_s);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrap_t);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.min_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.mag_filter);
+}
+
+std::shared_ptr<Texture> TextureFromFile(const char* path, const std::string& directory, bool gamma,
+                                         const TextureSampler& sampler) {
   std::string file_name = std::string(path);
   file_name = directory + '/' + file_name;
 
   GLuint texture;
   glGenTextures(1, &texture);
+  std::size_t gpu_bytes = 0;
 
-  int width, height, nr_channels;
-  unsigned char *data = stbi_load(file_name.c_str(), &width, &height, &nr_channels, 0);
+  auto start = std::chrono::steady_clock::now();
+  PngDecoder::Image image;
+  bool loaded = DecodeImageFile(file_name, &image);
+  int width = image.width, height = image.height, nr_channels = image.channels;
+  unsigned char* data = image.pixels.data();
+  auto decoded = std::chrono::steady_clock::now();
 
-  if (data) {
+  if (loaded) {
     GLint internal_format;
     GLenum format;
-    if (nr_channels == 1) {
-      internal_format = GL_RED;
-      format = GL_RED;
-    } else if (nr_channels == 3) {
-      format = GL_RGB;
-      if (gamma) {
-        internal_format = GL_SRGB;
-      } else {
-        internal_format = GL_RGB;
-      }
-    } else if (nr_channels == 4) {
-      format = GL_RGBA;
-      if (gamma) {
-        internal_format = GL_SRGB_ALPHA;
-      } else {
-        internal_format = GL_RGBA;
-      }
-    }
+    GetTextureFormat(nr_channels, gamma, &internal_format, &format);
 
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    auto uploaded = std::chrono::steady_clock::now();
+    // Only the submission is timed, the driver may filter later.
     glGenerateMipmap(GL_TEXTURE_2D);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    ApplyTextureSampler(sampler);
+
+    gpu_bytes = EstimateTextureBytes(width, height, nr_channels);
+
+    Texture::AddLoadStats(false,
+                          std::chrono::duration<double, std::milli>(decoded - start).count(),
+                          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploaded).count(),
+                          std::chrono::duration<double, std::milli>(uploaded - decoded).count(),
+                          gpu_bytes);
   } else {
     std::cout << "DongZhong: " << "Failed to load texture" << std::endl;
   }
 
-  stbi_image_free(data);
-
-  return texture;
+  return std::make_shared<Texture>(texture, gpu_bytes);
 }
 
+std::shared_ptr<Texture> TextureFromKtx2(const char* path, const std::string& directory, bool gamma,
+                                         const TextureSampler& sampler) {
+  std::string file_name = directory + '/' + std::string(path);
+
+  auto start = std::chrono::steady_clock::now();
+  Ktx2Image image;
+  if (!ReadKtx2(file_name, &image)) {
+    return nullptr;
+  }
+  auto decoded = std::chrono::steady_clock::now();
+
+  bool srgb = image.vk_format == Ktx2Image::kBC1RGBSrgb || image.vk_format == Ktx2Image::kBC3Srgb ||
+              image.vk_format == Ktx2Image::kBC7Srgb;
+  if (srgb != gamma) {
+    std::cout << "DongZhong: " << file_name << " is " << (srgb ? "sRGB" : "linear") << ", but "
+              << (gamma ? "sRGB" : "linear") << " was requested" << std::endl;
+    return nullptr;
+  }
+
+  GLenum internal_format = 0;
+  std::size_t block_bytes = 16;
+  switch (image.vk_format) {
+    case Ktx2Image::kBC1RGBUnorm:
+      internal_format = GLExtensions::has_texture_compression_s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+      block_bytes = 8;
+      break;
+    case Ktx2Image::kBC1RGBSrgb:
+      internal_format = GLExtensions::has_texture_compression_s3tc_srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+      block_bytes = 8;
+      break;
+    case Ktx2Image::kBC3Unorm:
+      internal_format = GLExtensions::has_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+      break;
+    case Ktx2Image::kBC3Srgb:
+      internal_format = GLExtensions::has_texture_compression_s3tc_srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : 0;
+      break;
+    case Ktx2Image::kBC7Unorm:
+      internal_format = GLExtensions::has_texture_compression_bptc ? GL_COMPRESSED_RGBA_BPTC_UNORM : 0;
+      break;
+    case Ktx2Image::kBC7Srgb:
+      internal_format = GLExtensions::has_texture_compression_bptc ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : 0;
+      break;
+  }
+  if (internal_format == 0) {
+    std::cout << "DongZhong: " << "Compressed format of " << file_name << " isn't supported" << std::endl;
+    return nullptr;
+  }
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, texture);
+
+  std::size_t gpu_bytes = 0;
+  for (std::size_t level = 0; level < image.levels.size(); ++level) {
+    GLsizei width = std::max<GLsizei>(image.width >> level, 1);
+    GLsizei height = std::max<GLsizei>(image.height >> level, 1);
+    std::size_t expected = ((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+    if (image.levels[level].size() < expected) {
+      std::cout << "DongZhong: " << "Mip level " << level << " of " << file_name << " is truncated" << std::endl;
+      if (level == 0) {
+        // Nothing to sample, let the caller fall back to the source image.
+        GLStateCache::Get().OnTextureDeleted(texture);
+        glDeleteTextures(1, &texture);
+        return nullptr;
+      }
+      break;
+    }
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format, width, height, 0,
+                           (GLsizei)expected, image.levels[level].data());
+    gpu_bytes += expected;
+    // Keeps the texture complete when the file has no full mip chain.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)level);
+  }
+
+  ApplyTextureSampler(sampler);
+
+  Texture::AddLoadStats(true,
+                        std::chrono::duration<double, std::milli>(decoded - start).count(),
+                        0.0,
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decoded).count(),
+                        gpu_bytes);
+
+  return std::make_shared<Texture>(texture, gpu_bytes);
+}
@@ -3,22 +3,98 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
+#include <memory>
 #include <string>
+#include <tuple>
 
 #include <glad/glad.h>
 
+#include "png_decoder.h"
+#include "thread_pool.h"
+
 #define TEXTURE_PATH "/Users/bilibili/DongZhong/myCodes/LearnOpenGL/res/textures"
+#define TEXTURE_CACHE_PATH TEXTURE_PATH "/../../cache/textures/"
+
+struct TextureSampler {
+  GLint wrap_s = GL_REPEAT;
+  GLint wrap_t = GL_REPEAT;
+  GLint min_filter = GL_LINEAR_MIPMAP_LINEAR;
+  GLint mag_filter = GL_LINEAR;
+
+  bool operator<(const TextureSampler& other) const {
+    return std::tie(wrap_s, wrap_t, min_filter, mag_filter) <
+           std::tie(other.wrap_s, other.wrap_t, other.min_filter, other.mag_filter);
+  }
+};
 
+// Owns a GL texture object, which is deleted together with it. A texture
+// which isn't ready yet shows a placeholder it doesn't own until its own
+// object is handed over by SetReady().
 class Texture {
  public:
-  Texture(GLuint texture_id);
+  struct LoadStats {
+    std::size_t loaded = 0;
+    double decode_ms = 0.0;
+    double mip_ms = 0.0;
+    double upload_ms = 0.0;
+    std::size_t gpu_bytes = 0;
+  };
+
+  Texture(GLuint texture_id, std::size_t gpu_bytes = 0, bool is_ready = true);
+  ~Texture();
+
+  Texture(const Texture&) = delete;
+  Texture& operator=(const Texture&) = delete;
 
   GLuint GetID() const { return texture_id_; }
 
+  // Estimated video memory of all mip levels.
+  std::size_t GetGPUBytes() const { return gpu_bytes_; }
+
+  bool IsReady() const { return is_ready_; }
+  void SetReady(GLuint texture_id, std::size_t gpu_bytes);
+
+  // A streamed texture holds only its levels from GetBaseLevel() on, and
+  // sampling is clamped to them with GL_TEXTURE_BASE_LEVEL. See
+  // TextureStreamer.
+  bool IsStreamed() const { return is_streamed_; }
+  int GetBaseLevel() const { return base_level_; }
+  void SetResidentLevels(int base_level, std::size_t gpu_bytes);
+
+  // Totals of decoded (stb_image) and of block compressed (KTX2) loads.
+  static LoadStats GetLoadStats(bool compressed) { return load_stats_[compressed]; }
+  static void AddLoadStats(bool compressed, double decode_ms, double mip_ms, double upload_ms,
+                           std::size_t gpu_bytes);
+
  private:
   GLuint texture_id_;
+  std::size_t gpu_bytes_;
+  bool is_ready_;
+  bool is_streamed_ = false;
+  int base_level_ = 0;
+
+  static LoadStats load_stats_[2];
 };
 
-GLuint TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+void GetTextureFormat(int channels, bool gamma, GLint* internal_format, GLenum* format);
+
+// Decodes |file_name| with PngDecoder, or stb_image for what it doesn't
+// handle. Rows of large PNGs are spread over |pool| when given.
+bool DecodeImageFile(const std::string& file_name, PngDecoder::Image* image, ThreadPool* pool = nullptr);
+
+std::size_t EstimateTextureBytes(int width, int height, int channels);
+
+// Sets |sampler| on the texture bound to GL_TEXTURE_2D.
+void ApplyTextureSampler(const TextureSampler& sampler);
+
+// Decodes and uploads |path| without any caching, prefer TextureCache.
+std::shared_ptr<Texture> TextureFromFile(const char* path, const std::string& directory, bool gamma = false,
+                                         const TextureSampler& sampler = TextureSampler());
+
+// Uploads the block compressed mip chain of a KTX2 file. The colour space is
+// part of the file's format. Returns null if the file can't be read, its
+// colour space isn't the one |gamma| asks for or the driver lacks its format.
+std::shared_ptr<Texture> TextureFromKtx2(const char* path, const std::string& directory, bool gamma = false,
+                                         const TextureSampler& sampler = TextureSampler());
 
 #endif // TEXTURE_H_
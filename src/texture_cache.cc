@@ -0,0 +1,89 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "texture_cache.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include "texture_loader.h"
+
+TextureCache& TextureCache::Get() {
+  static TextureCache cache;
+  return cache;
+}
+
+std::shared_ptr<Texture> TextureCache::GetTexture(const std::string& path,
+                                                  const std::string& directory,
+                                                  bool gamma,
+                                                  const TextureSampler& sampler) {
+  ++stats_.requests;
+
+  Key key{directory + '/' + path, gamma, sampler};
+  auto& texture = textures_[key];
+  if (texture) {
+    ++stats_.hits;
+    return texture;
+  }
+
+  // A block compressed version written by texture_compressor wins, it
+  // uploads without decoding and takes a fraction of the memory. Unless it
+  // was written for the other colour space, then the PNG is used.
+  auto compressed_path = std::filesystem::path(path).replace_extension(".ktx2").string();
+  if (std::filesystem::exists(directory + '/' + compressed_path)) {
+    texture = TextureFromKtx2(compressed_path.c_str(), directory, gamma, sampler);
+  }
+  if (!texture) {
+    texture = TextureLoader::Get().Load(path, directory, gamma, sampler);
+  }
+  ++stats_.loads;
+  return texture;
+}
+
+std::size_t TextureCache::EvictUnused() {
+  std::size_t freed_bytes = 0;
+  for (auto iter = textures_.begin(); iter != textures_.end();) {
+    if (iter->second.use_count() == 1) {
+      freed_bytes += iter->second->GetGPUBytes();
+      ++stats_.evicted;
+      iter = textures_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  stats_.evicted_bytes += freed_bytes;
+  return freed_bytes;
+}
+
+void TextureCache::Clear() {
+  textures_.clear();
+}
+
+std::size_t TextureCache::GetResidentBytes() const {
+  std::size_t bytes = 0;
+  for (auto&& [key, texture] : textures_) {
+    bytes += texture->GetGPUBytes();
+  }
+  return bytes;
+}
+
+float TextureCache::GetHitRate() const {
+  if (stats_.requests == 0) {
+    return 0.0f;
+  }
+  return (float)stats_.hits / (float)stats_.requests;
+}
+
+void TextureCache::PrintReport() const {
+  std::cout << "DongZhong: " << "Texture cache: "
+            << stats_.requests << " requests, " << stats_.hits << " hits ("
+            << GetHitRate() * 100.0f << "%), " << stats_.loads << " loads, "
+            << stats_.evicted << " evicted (" << stats_.evicted_bytes / 1024 << " KB), "
+            << textures_.size() << " resident (" << GetResidentBytes() / 1024 << " KB)" << std::endl;
+
+  for (auto&& [key, texture] : textures_) {
+    // The cache's own reference doesn't count as a user.
+    std::cout << "DongZhong: " << "  " << key.path << (key.gamma ? " (sRGB)" : "") << ": "
+              << texture.use_count() - 1 << " users, " << texture->GetGPUBytes() / 1024 << " KB" << std::endl;
+  }
+}
@@ -0,0 +1,69 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef TEXTURE_CACHE_H_
+#define TEXTURE_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include <glad/glad.h>
+
+#include "texture.h"
+
+// Shares textures loaded from disk: requesting the same file with the same
+// colour space and sampler settings returns the texture already resident.
+// New files are loaded in the background by TextureLoader.
+// Entries nobody else references any more are dropped by EvictUnused().
+class TextureCache {
+ public:
+  struct Stats {
+    std::size_t requests = 0;
+    std::size_t hits = 0;
+    std::size_t loads = 0;
+    std::size_t evicted = 0;
+    std::size_t evicted_bytes = 0;
+  };
+
+  static TextureCache& Get();
+
+  std::shared_ptr<Texture> GetTexture(const std::string& path,
+                                      const std::string& directory = TEXTURE_PATH,
+                                      bool gamma = false,
+                                      const TextureSampler& sampler = TextureSampler());
+
+  // Frees textures only the cache still holds. Returns the bytes released.
+  std::size_t EvictUnused();
+
+  // Drops every entry. Call before the context goes away.
+  void Clear();
+
+  std::size_t GetResidentCount() const { return textures_.size(); }
+  std::size_t GetResidentBytes() const;
+
+  Stats GetStats() const { return stats_; }
+
+  float GetHitRate() const;
+
+  void PrintReport() const;
+
+ private:
+  struct Key {
+    std::string path;
+    bool gamma;
+    TextureSampler sampler;
+
+    bool operator<(const Key& other) const {
+      return std::tie(path, gamma, sampler) < std::tie(other.path, other.gamma, other.sampler);
+    }
+  };
+
+  TextureCache() = default;
+
+  std::map<Key, std::shared_ptr<Texture>> textures_;
+
+  Stats stats_;
+};
+
+#endif // TEXTURE_CACHE_H_
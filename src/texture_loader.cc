@@ -0,0 +1,415 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "texture_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "hash.h"
+#include "texture_streamer.h"
+
+TextureLoader& TextureLoader::Get() {
+  static TextureLoader loader;
+  return loader;
+}
+
+TextureLoader::TextureLoader() : completed_(nullptr) {
+  pixel_buffers_.fill(0);
+}
+
+TextureLoader::~TextureLoader() {
+  pool_.WaitIdle();
+  for (auto image = TakeCompleted(); image != nullptr;) {
+    auto next = image->next;
+    delete image;
+    image = next;
+  }
+  for (auto& upload : uploads_) {
+    delete upload.image;
+  }
+}
+
+std::shared_ptr<Texture> TextureLoader::Load(const std::string& path, const std::string& directory,
+                                             bool gamma, const TextureSampler& sampler) {
+  auto texture = std::make_shared<Texture>(GetPlaceholder(), 0, false);
+
+  auto image = new DecodedImage();
+  image->texture = texture;
+  image->file_name = directory + '/' + path;
+  image->gamma = gamma;
+  image->sampler = sampler;
+
+  ++stats_.requested;
+  pool_.Submit([this, image] { Decode(image); });
+
+  return texture;
+}
+
+void TextureLoader::Update() {
+  stats_.frame_upload_bytes = 0;
+
+  // The queue hands nodes back newest first, restore request order.
+  DecodedImage* images = nullptr;
+  for (auto image = TakeCompleted(); image != nullptr;) {
+    auto next = image->next;
+    image->next = images;
+    images = image;
+    image = next;
+  }
+
+  for (auto image = images; image != nullptr;) {
+    auto next = image->next;
+    if (image->levels.empty()) {
+      std::cout << "DongZhong: " << "Failed to load texture " << image->file_name << std::endl;
+      ++stats_.failed;
+      delete image;
+    } else if (image->texture.expired()) {
+      ++stats_.completed;
+      delete image;
+    } else {
+      StartUpload(image);
+    }
+    image = next;
+  }
+
+  if (uploads_.empty()) {
+    return;
+  }
+
+  // A row can't be split, so a buffer must hold at least the widest one.
+  std::size_t buffer_size = upload_budget_;
+  for (auto& upload : uploads_) {
+    buffer_size = std::max(buffer_size, (std::size_t)upload.image->width * upload.image->channels);
+  }
+  ReservePixelBuffers(buffer_size);
+
+  // Cycling through the ring gives the driver a few frames to consume a
+  // buffer before we write to it again.
+  GLuint pixel_buffer = pixel_buffers_[pixel_buffer_index_];
+  pixel_buffer_index_ = (pixel_buffer_index_ + 1) % kPixelBufferCount;
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+  auto mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pixel_buffer_size_,
+                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
+  }
+
+  struct Band {
+    std::size_t upload;
+    std::size_t level;
+    int first_row;
+    int row_count;
+    std::size_t offset;
+  };
+  std::vector<Band> bands;
+
+  // Levels go largest first, so each band is a run of rows of one level.
+  std::size_t offset = 0;
+  bool budget_left = true;
+  for (std::size_t i = 0; i < uploads_.size() && budget_left; ++i) {
+    auto& upload = uploads_[i];
+    auto image = upload.image;
+    while (upload.level < image->levels.size()) {
+      int level_width = std::max(image->width >> upload.level, 1);
+      int level_height = std::max(image->height >> upload.level, 1);
+      std::size_t row_bytes = (std::size_t)level_width * image->channels;
+
+      int row_count = (int)std::min<std::size_t>((upload_budget_ - std::min(offset, upload_budget_)) / row_bytes,
+                                                 level_height - upload.next_row);
+      if (row_count == 0 && offset == 0) {
+        row_count = 1;
+      }
+      if (row_count == 0) {
+        budget_left = false;
+        break;
+      }
+
+      std::size_t band_bytes = row_bytes * row_count;
+      std::memcpy(mapped + offset, image->levels[upload.level].data() + row_bytes * upload.next_row, band_bytes);
+      bands.push_back({i, upload.level, upload.next_row, row_count, offset});
+      offset += band_bytes;
+
+      upload.next_row += row_count;
+      if (upload.next_row == level_height) {
+        ++upload.level;
+        upload.next_row = 0;
+      }
+    }
+  }
+
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (auto& band : bands) {
+    auto band_start = std::chrono::steady_clock::now();
+    auto& upload = uploads_[band.upload];
+    GLint internal_format;
+    GLenum format;
+    GetTextureFormat(upload.image->channels, upload.image->gamma, &internal_format, &format);
+
+    GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, upload.texture);
+    glTexSubImage2D(GL_TEXTURE_2D, (GLint)band.level, 0, band.first_row,
+                    std::max(upload.image->width >> band.level, 1), band.row_count,
+                    format, GL_UNSIGNED_BYTE, (void*)band.offset);
+    upload.upload_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - band_start).count();
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  stats_.frame_upload_bytes = offset;
+
+  while (!uploads_.empty() && uploads_.front().level == uploads_.front().image->levels.size()) {
+    FinishUpload(uploads_.front());
+    uploads_.pop_front();
+  }
+}
+
+void TextureLoader::Clear() {
+  pool_.WaitIdle();
+
+  for (auto image = TakeCompleted(); image != nullptr;) {
+    auto next = image->next;
+    delete image;
+    image = next;
+  }
+
+  for (auto& upload : uploads_) {
+    GLStateCache::Get().OnTextureDeleted(upload.texture);
+    glDeleteTextures(1, &upload.texture);
+    delete upload.image;
+  }
+  uploads_.clear();
+
+  if (pixel_buffer_size_ != 0) {
+    glDeleteBuffers(kPixelBufferCount, pixel_buffers_.data());
+    pixel_buffers_.fill(0);
+    pixel_buffer_size_ = 0;
+  }
+
+  if (placeholder_ != 0) {
+    GLStateCache::Get().OnTextureDeleted(placeholder_);
+    glDeleteTextures(1, &placeholder_);
+    placeholder_ = 0;
+  }
+}
+
+void TextureLoader::SetUploadBudget(std::size_t bytes) {
+  upload_budget_ = std::max<std::size_t>(bytes, 1);
+}
+
+void TextureLoader::Decode(DecodedImage* image) {
+  auto start = std::chrono::steady_clock::now();
+  image->mip_cache_path = GetMipCachePath(*image);
+  image->from_cache = LoadMipChain(image->mip_cache_path, image);
+  image->cached = image->from_cache;
+  if (!image->from_cache) {
+    PngDecoder::Image decoded_image;
+    bool decoded_ok = DecodeImageFile(image->file_name, &decoded_image, &row_pool_);
+    auto decoded = std::chrono::steady_clock::now();
+    image->decode_ms = std::chrono::duration<double, std::milli>(decoded - start).count();
+
+    if (decoded_ok) {
+      image->width = decoded_image.width;
+      image->height = decoded_image.height;
+      image->channels = decoded_image.channels;
+      image->levels = MipGenerator::GenerateChain(decoded_image.pixels.data(), image->width, image->height,
+                                                  image->channels, image->gamma, kMipFilter, &row_pool_);
+      image->mip_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decoded).count();
+
+      image->cached = SaveMipChain(image->mip_cache_path, *image);
+    }
+  } else {
+    image->decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  PushCompleted(image);
+}
+
+void TextureLoader::PushCompleted(DecodedImage* image) {
+  image->next = completed_.load(std::memory_order_relaxed);
+  while (!completed_.compare_exchange_weak(image->next, image,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+  }
+}
+
+TextureLoader::DecodedImage* TextureLoader::TakeCompleted() {
+  return completed_.exchange(nullptr, std::memory_order_acquire);
+}
+
+GLuint TextureLoader::GetPlaceholder() {
+  if (placeholder_ == 0) {
+    const unsigned char kGrey[4] = {128, 128, 128, 255};
+    glGenTextures(1, &placeholder_);
+    GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, placeholder_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, kGrey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  return placeholder_;
+}
+
+void TextureLoader::StartUpload(DecodedImage* image) {
+  GLint internal_format;
+  GLenum format;
+  GetTextureFormat(image->channels, image->gamma, &internal_format, &format);
+
+  // Streamed textures need mutable storage, their finer levels are defined
+  // and dropped later.
+  GLsizei first_level = 0;
+  if (TextureStreamer::Get().IsEnabled() && image->cached) {
+    first_level = TextureStreamer::GetCoarseLevel(image->width, image->height);
+  }
+
+  // Storage first, the rows follow in bands over the next frames.
+  GLuint texture;
+  glGenTextures(1, &texture);
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, texture);
+  GLsizei level_count = (GLsizei)image->levels.size();
+  if (GLExtensions::has_texture_storage && first_level == 0) {
+    GLExtensions::TexStorage2D(GL_TEXTURE_2D, level_count, internal_format, image->width, image->height);
+  } else {
+    for (GLsizei level = first_level; level < level_count; ++level) {
+      glTexImage2D(GL_TEXTURE_2D, level, internal_format,
+                   std::max(image->width >> level, 1), std::max(image->height >> level, 1),
+                   0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, first_level);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level_count - 1);
+  }
+  ApplyTextureSampler(image->sampler);
+
+  if (image->from_cache) {
+    ++stats_.mip_cache_hits;
+  }
+
+  uploads_.push_back({image, texture, (std::size_t)first_level, 0, 0.0, (std::size_t)first_level});
+}
+
+void TextureLoader::ReservePixelBuffers(std::size_t size) {
+  if (size <= pixel_buffer_size_) {
+    return;
+  }
+
+  if (pixel_buffer_size_ == 0) {
+    glGenBuffers(kPixelBufferCount, pixel_buffers_.data());
+  }
+  for (auto pixel_buffer : pixel_buffers_) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  pixel_buffer_size_ = size;
+}
+
+void TextureLoader::FinishUpload(const Upload& upload) {
+  auto image = upload.image;
+
+  auto texture = image->texture.lock();
+  if (texture) {
+    std::size_t gpu_bytes = EstimateTextureBytes(image->width, image->height, image->channels);
+    texture->SetReady(upload.texture, gpu_bytes);
+    if (upload.first_level > 0) {
+      TextureStreamer::Get().Add(texture, image->mip_cache_path, image->width, image->height,
+                                 image->channels, image->gamma, (int)upload.first_level);
+      gpu_bytes = texture->GetGPUBytes();
+    }
+    Texture::AddLoadStats(false, image->decode_ms, image->mip_ms, upload.upload_ms, gpu_bytes);
+  } else {
+    GLStateCache::Get().OnTextureDeleted(upload.texture);
+    glDeleteTextures(1, &upload.texture);
+  }
+
+  ++stats_.completed;
+  delete image;
+}
+
+std::string TextureLoader::GetMipCachePath(const DecodedImage& image) {
+  std::error_code error;
+  auto modified = std::filesystem::last_write_time(image.file_name, error);
+  if (error) {
+    return std::string();
+  }
+
+  std::string key = image.file_name + '\0' + std::to_string(modified.time_since_epoch().count()) + '\0' +
+                    (image.gamma ? "srgb" : "linear") + '\0' + std::to_string((int)kMipFilter);
+
+  std::uint64_t hash = HashString(key);
+
+  char file_name[32];
+  std::snprintf(file_name, sizeof(file_name), "%016llx.mip", (unsigned long long)hash);
+  return std::string(TEXTURE_CACHE_PATH) + file_name;
+}
+
+bool TextureLoader::LoadMipChain(const std::string& path, DecodedImage* image) {
+  if (path.empty()) {
+    return false;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  std::int32_t header[4] = {0, 0, 0, 0};
+  file.read(reinterpret_cast<char*>(header), sizeof(header));
+  int width = header[0], height = header[1], channels = header[2], level_count = header[3];
+  if (!file || width <= 0 || height <= 0 || channels < 1 || channels > 4 ||
+      level_count != MipGenerator::GetLevelCount(width, height)) {
+    return false;
+  }
+
+  std::vector<std::vector<unsigned char>> levels(level_count);
+  for (int level = 0; level < level_count; ++level) {
+    levels[level].resize((std::size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * channels);
+    file.read(reinterpret_cast<char*>(levels[level].data()), levels[level].size());
+    if (!file) {
+      return false;
+    }
+  }
+
+  image->width = width;
+  image->height = height;
+  image->channels = channels;
+  image->levels = std::move(levels);
+  return true;
+}
+
+bool TextureLoader::SaveMipChain(const std::string& path, const DecodedImage& image) {
+  if (path.empty() || image.levels.empty()) {
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(TEXTURE_CACHE_PATH, error);
+
+  // Written under a unique name and renamed, so a concurrent reader never
+  // sees half a file.
+  std::string temporary_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream file(temporary_path, std::ios::binary);
+    std::int32_t header[4] = {image.width, image.height, image.channels, (std::int32_t)image.levels.size()};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (auto& level : image.levels) {
+      file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+    if (!file) {
+      std::filesystem::remove(temporary_path, error);
+      return false;
+    }
+  }
+  std::filesystem::rename(temporary_path, path, error);
+  return !error;
+}
@@ -0,0 +1,140 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef TEXTURE_LOADER_H_
+#define TEXTURE_LOADER_H_
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mip_generator.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// Loads textures without stalling the render thread: files are decoded on a
+// thread pool, handed back through a lock-free queue and uploaded through a
+// ring of pixel buffer objects, at most |upload_budget| bytes per frame.
+// Textures show a placeholder until their last row has been uploaded.
+//
+// Mip chains are built on the workers by MipGenerator and written to
+// TEXTURE_CACHE_PATH, so later launches skip both decoding and filtering.
+// While TextureStreamer is enabled only the coarse levels are uploaded, the
+// streamer reads the others from the cache when they're needed.
+class TextureLoader {
+ public:
+  struct Stats {
+    std::size_t requested = 0;
+    std::size_t completed = 0;
+    std::size_t failed = 0;
+    std::size_t mip_cache_hits = 0;
+    std::size_t frame_upload_bytes = 0;
+  };
+
+  static const std::size_t kDefaultUploadBudget = 4 * 1024 * 1024;
+
+  static TextureLoader& Get();
+
+  // Returns a texture showing the placeholder, which becomes the image at
+  // |directory|/|path| a few frames later.
+  std::shared_ptr<Texture> Load(const std::string& path, const std::string& directory,
+                                bool gamma, const TextureSampler& sampler);
+
+  // Call once per frame on the GL thread, uploads what the budget allows.
+  void Update();
+
+  // Deletes the GL objects. Call before the context goes away.
+  void Clear();
+
+  std::size_t GetUploadBudget() const { return upload_budget_; }
+  void SetUploadBudget(std::size_t bytes);
+
+  // Textures still decoding or uploading.
+  std::size_t GetPendingCount() const { return stats_.requested - stats_.completed - stats_.failed; }
+
+  Stats GetStats() const { return stats_; }
+
+ private:
+  static const std::size_t kPixelBufferCount = 3;
+  static const MipGenerator::Filter kMipFilter = MipGenerator::Filter::kKaiser;
+
+  // Node of the completion queue, filled on a worker.
+  struct DecodedImage {
+    std::weak_ptr<Texture> texture;
+    std::string file_name;
+    bool gamma;
+    TextureSampler sampler;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    // Full mip chain, level 0 first. Empty if loading failed.
+    std::vector<std::vector<unsigned char>> levels;
+    bool from_cache = false;
+    // Whether the chain is in the mip cache, which streaming reads from.
+    std::string mip_cache_path;
+    bool cached = false;
+    double decode_ms = 0.0;
+    double mip_ms = 0.0;
+    DecodedImage* next = nullptr;
+  };
+
+  struct Upload {
+    DecodedImage* image;
+    GLuint texture;
+    std::size_t level;
+    int next_row;
+    double upload_ms;
+    // Levels above it are left to TextureStreamer.
+    std::size_t first_level;
+  };
+
+  TextureLoader();
+  ~TextureLoader();
+
+  void Decode(DecodedImage* image);
+
+  // Multiple producers push with a CAS, the render thread takes the whole
+  // list at once, so nodes are never popped individually and ABA can't occur.
+  void PushCompleted(DecodedImage* image);
+  DecodedImage* TakeCompleted();
+
+  GLuint GetPlaceholder();
+
+  void StartUpload(DecodedImage* image);
+
+  // Makes every pixel buffer hold at least |size| bytes.
+  void ReservePixelBuffers(std::size_t size);
+
+  void FinishUpload(const Upload& upload);
+
+  // Cache entries are keyed by file, modification time and filter settings.
+  static std::string GetMipCachePath(const DecodedImage& image);
+  static bool LoadMipChain(const std::string& path, DecodedImage* image);
+  static bool SaveMipChain(const std::string& path, const DecodedImage& image);
+
+  std::atomic<DecodedImage*> completed_;
+
+  std::deque<Upload> uploads_;
+
+  std::array<GLuint, kPixelBufferCount> pixel_buffers_;
+  std::size_t pixel_buffer_size_ = 0;
+  std::size_t pixel_buffer_index_ = 0;
+  std::size_t upload_budget_ = kDefaultUploadBudget;
+
+  GLuint placeholder_ = 0;
+
+  Stats stats_;
+
+  // Unfilters the rows of large PNGs and filters the rows of large mip
+  // levels for the decoding workers, which can't wait on their own pool.
+  ThreadPool row_pool_;
+
+  // Destroyed first, so no worker outlives the queue.
+  ThreadPool pool_;
+};
+
+#endif // TEXTURE_LOADER_H_
@@ -0,0 +1,269 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#include "gl_state_cache.h"
+#include "mip_generator.h"
+
+TextureStreamer& TextureStreamer::Get() {
+  static TextureStreamer streamer;
+  return streamer;
+}
+
+int TextureStreamer::GetCoarseLevel(int width, int height) {
+  int level = 0;
+  while (std::max(width >> level, height >> level) > kCoarseSize) {
+    ++level;
+  }
+  return level;
+}
+
+std::size_t TextureStreamer::GetLevelBytes(int width, int height, int channels, int level) {
+  std::size_t texel_bytes = channels == 3 ? 4 : channels;
+  return (std::size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * texel_bytes;
+}
+
+void TextureStreamer::Add(const std::shared_ptr<Texture>& texture, const std::string& mip_cache_path,
+                          int width, int height, int channels, bool gamma, int coarse_level) {
+  StreamedTexture streamed;
+  streamed.texture = texture;
+  streamed.mip_cache_path = mip_cache_path;
+  streamed.width = width;
+  streamed.height = height;
+  streamed.channels = channels;
+  streamed.gamma = gamma;
+  streamed.level_count = MipGenerator::GetLevelCount(width, height);
+  streamed.coarse_level = coarse_level;
+  streamed.wanted_level = coarse_level;
+  for (int level = coarse_level; level < streamed.level_count; ++level) {
+    streamed.resident_bytes += GetLevelBytes(width, height, channels, level);
+  }
+
+  texture->SetResidentLevels(coarse_level, streamed.resident_bytes);
+  resident_bytes_ += streamed.resident_bytes;
+  textures_[texture.get()] = streamed;
+}
+
+void TextureStreamer::Request(const std::shared_ptr<Texture>& texture, float screen_size) {
+  if (!texture || !texture->IsStreamed()) {
+    return;
+  }
+
+  auto iter = textures_.find(texture.get());
+  if (iter == textures_.end()) {
+    return;
+  }
+
+  // One texel per pixel, assuming the texture spans the model once.
+  auto& streamed = iter->second;
+  float texels = (float)std::max(streamed.width, streamed.height);
+  int level = (int)std::floor(std::log2(texels / std::max(screen_size, 1.0f)));
+  level = std::clamp(level, 0, streamed.coarse_level);
+
+  streamed.wanted_level = std::min(streamed.wanted_level, level);
+  streamed.last_used_frame = frame_;
+}
+
+bool TextureStreamer::Pin(const std::shared_ptr<Texture>& texture) {
+  auto iter = textures_.find(texture.get());
+  if (iter == textures_.end()) {
+    return true;
+  }
+  if (texture->GetBaseLevel() > 0) {
+    return false;
+  }
+  iter->second.pinned = true;
+  return true;
+}
+
+void TextureStreamer::Update() {
+  std::vector<LoadedLevel> loaded;
+  {
+    std::lock_guard<std::mutex> lock(loaded_mutex_);
+    loaded.swap(loaded_);
+  }
+
+  for (auto& level : loaded) {
+    --pending_;
+    pending_bytes_ -= level.bytes;
+    auto texture = level.texture.lock();
+    auto iter = textures_.find(texture.get());
+    if (!texture || iter == textures_.end()) {
+      continue;
+    }
+
+    auto& streamed = iter->second;
+    streamed.loading = false;
+
+    if (level.pixels.empty()) {
+      // No mip cache to stream from, stay at what's resident.
+      std::cout << "DongZhong: " << "Failed to stream " << streamed.mip_cache_path << std::endl;
+      streamed.coarse_level = texture->GetBaseLevel();
+      continue;
+    }
+    if (level.level == texture->GetBaseLevel() - 1) {
+      UploadLevel(streamed, *texture, level);
+    }
+  }
+
+  for (auto iter = textures_.begin(); iter != textures_.end();) {
+    if (iter->second.texture.expired()) {
+      resident_bytes_ -= iter->second.resident_bytes;
+      iter = textures_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  while (resident_bytes_ > budget_ && EvictLevel()) {
+  }
+
+  // Ask for one more level of every texture short of what it was asked for,
+  // as far as the budget can make room.
+  for (auto&& [key, streamed] : textures_) {
+    auto texture = streamed.texture.lock();
+    int level = texture->GetBaseLevel() - 1;
+    if (streamed.loading || streamed.last_used_frame != frame_ || streamed.wanted_level > level) {
+      continue;
+    }
+
+    std::size_t bytes = GetLevelBytes(streamed.width, streamed.height, streamed.channels, level);
+    while (resident_bytes_ + pending_bytes_ + bytes > budget_ && EvictLevel()) {
+    }
+    if (resident_bytes_ + pending_bytes_ + bytes > budget_) {
+      continue;
+    }
+
+    streamed.loading = true;
+    pending_bytes_ += bytes;
+    requested_bytes_ += bytes;
+    ++pending_;
+
+    std::weak_ptr<Texture> weak_texture = texture;
+    std::string path = streamed.mip_cache_path;
+    int width = streamed.width, height = streamed.height, channels = streamed.channels;
+    pool_.Submit([this, weak_texture, path, width, height, channels, level, bytes] {
+      LoadedLevel loaded_level{weak_texture, level, bytes, {}};
+      if (!ReadLevel(path, width, height, channels, level, &loaded_level.pixels)) {
+        loaded_level.pixels.clear();
+      }
+
+      std::lock_guard<std::mutex> lock(loaded_mutex_);
+      loaded_.push_back(std::move(loaded_level));
+    });
+  }
+
+  for (auto&& [key, streamed] : textures_) {
+    streamed.wanted_level = streamed.coarse_level;
+  }
+  ++frame_;
+}
+
+void TextureStreamer::Clear() {
+  pool_.WaitIdle();
+  loaded_.clear();
+  textures_.clear();
+  resident_bytes_ = 0;
+  pending_bytes_ = 0;
+  pending_ = 0;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const {
+  Stats stats;
+  stats.textures = textures_.size();
+  stats.pending = pending_;
+  stats.resident_bytes = resident_bytes_;
+  stats.requested_bytes = requested_bytes_;
+  stats.evicted_bytes = evicted_bytes_;
+  return stats;
+}
+
+void TextureStreamer::UploadLevel(StreamedTexture& streamed, Texture& texture, const LoadedLevel& loaded) {
+  GLint internal_format;
+  GLenum format;
+  GetTextureFormat(streamed.channels, streamed.gamma, &internal_format, &format);
+
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, texture.GetID());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, loaded.level, internal_format,
+               std::max(streamed.width >> loaded.level, 1), std::max(streamed.height >> loaded.level, 1),
+               0, format, GL_UNSIGNED_BYTE, loaded.pixels.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  std::size_t bytes = GetLevelBytes(streamed.width, streamed.height, streamed.channels, loaded.level);
+  streamed.resident_bytes += bytes;
+  resident_bytes_ += bytes;
+  texture.SetResidentLevels(loaded.level, streamed.resident_bytes);
+}
+
+bool TextureStreamer::EvictLevel() {
+  // Textures on screen this frame only give up levels finer than they need,
+  // anything else would be requested again next frame.
+  StreamedTexture* victim = nullptr;
+  std::shared_ptr<Texture> victim_texture;
+  for (auto&& [key, streamed] : textures_) {
+    auto texture = streamed.texture.lock();
+    if (!texture || streamed.loading || streamed.pinned) {
+      continue;
+    }
+
+    int base_level = texture->GetBaseLevel();
+    bool in_use = streamed.last_used_frame == frame_ && base_level >= streamed.wanted_level;
+    if (base_level >= streamed.coarse_level || in_use) {
+      continue;
+    }
+    if (!victim || streamed.last_used_frame < victim->last_used_frame) {
+      victim = &streamed;
+      victim_texture = texture;
+    }
+  }
+  if (!victim) {
+    return false;
+  }
+
+  // Clamp sampling first, then drop the level's storage.
+  int level = victim_texture->GetBaseLevel();
+  std::size_t bytes = GetLevelBytes(victim->width, victim->height, victim->channels, level);
+  victim->resident_bytes -= bytes;
+  resident_bytes_ -= bytes;
+  evicted_bytes_ += bytes;
+  victim_texture->SetResidentLevels(level + 1, victim->resident_bytes);
+
+  GLint internal_format;
+  GLenum format;
+  GetTextureFormat(victim->channels, victim->gamma, &internal_format, &format);
+  GLStateCache::Get().BindTexture(GLStateCache::kScratchTextureUnit, GL_TEXTURE_2D, victim_texture->GetID());
+  glTexImage2D(GL_TEXTURE_2D, level, internal_format, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+  return true;
+}
+
+bool TextureStreamer::ReadLevel(const std::string& path, int width, int height, int channels, int level,
+                                std::vector<unsigned char>* pixels) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  // Same layout TextureLoader writes: a header, then every level in order.
+  std::int32_t header[4] = {0, 0, 0, 0};
+  file.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (!file || header[0] != width || header[1] != height || header[2] != channels) {
+    return false;
+  }
+
+  std::size_t offset = sizeof(header);
+  for (int i = 0; i < level; ++i) {
+    offset += (std::size_t)std::max(width >> i, 1) * std::max(height >> i, 1) * channels;
+  }
+  pixels->resize((std::size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * channels);
+
+  file.seekg(offset);
+  file.read(reinterpret_cast<char*>(pixels->data()), pixels->size());
+  return (bool)file;
+}
@@ -0,0 +1,134 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef TEXTURE_STREAMER_H_
+#define TEXTURE_STREAMER_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "texture.h"
+#include "thread_pool.h"
+
+// Keeps the fine mip levels of decoded textures resident only while they're
+// on screen. TextureLoader uploads the coarse tail, levels up to kCoarseSize,
+// and hands the texture over. Models then Request() the detail their screen
+// size needs, one level at a time, read from the mip cache file on the
+// streaming thread. When the resident levels pass the budget, the finest
+// level of the least recently used texture goes first.
+//
+// Off by default: MaterialTextures only takes a streamed texture once all
+// its levels are resident, until then it keeps its own binds.
+class TextureStreamer {
+ public:
+  struct Stats {
+    std::size_t textures = 0;
+    std::size_t pending = 0;
+    std::size_t resident_bytes = 0;
+    std::size_t requested_bytes = 0;
+    std::size_t evicted_bytes = 0;
+  };
+
+  static const std::size_t kDefaultBudget = 64 * 1024 * 1024;
+
+  // Levels up to this size are loaded with the texture and never evicted.
+  static const int kCoarseSize = 64;
+
+  static TextureStreamer& Get();
+
+  // Off by default. Only affects textures loaded afterwards.
+  bool IsEnabled() const { return enabled_; }
+  void SetEnabled(bool enabled) { enabled_ = enabled; }
+
+  std::size_t GetBudget() const { return budget_; }
+  void SetBudget(std::size_t bytes) { budget_ = bytes; }
+
+  // Finest level TextureLoader uploads for a streamed texture.
+  static int GetCoarseLevel(int width, int height);
+
+  // Video memory of |level|, padded like EstimateTextureBytes().
+  static std::size_t GetLevelBytes(int width, int height, int channels, int level);
+
+  // Takes over |texture|, whose levels from |coarse_level| on are uploaded.
+  // Finer levels are read from |mip_cache_path|.
+  void Add(const std::shared_ptr<Texture>& texture, const std::string& mip_cache_path,
+           int width, int height, int channels, bool gamma, int coarse_level);
+
+  // Asks for the levels |texture| needs when covering |screen_size| pixels
+  // this frame. Textures which aren't streamed are ignored.
+  void Request(const std::shared_ptr<Texture>& texture, float screen_size);
+
+  // Keeps every level of |texture| resident from now on, for users whose
+  // copies or handles can't follow level changes. Returns false while
+  // levels are still missing, true for textures which aren't streamed.
+  bool Pin(const std::shared_ptr<Texture>& texture);
+
+  // Call once per frame on the GL thread, before the scene requests levels.
+  // Uploads loaded levels, evicts and starts new loads.
+  void Update();
+
+  // Drops every texture. Call before the context goes away.
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  struct StreamedTexture {
+    std::weak_ptr<Texture> texture;
+    std::string mip_cache_path;
+    int width;
+    int height;
+    int channels;
+    bool gamma;
+    int level_count;
+    int coarse_level;
+    // Finest level requested since the last Update().
+    int wanted_level;
+    std::size_t last_used_frame = 0;
+    bool loading = false;
+    bool pinned = false;
+    std::size_t resident_bytes = 0;
+  };
+
+  struct LoadedLevel {
+    std::weak_ptr<Texture> texture;
+    int level;
+    std::size_t bytes;
+    // Empty if reading failed.
+    std::vector<unsigned char> pixels;
+  };
+
+  TextureStreamer() = default;
+
+  void UploadLevel(StreamedTexture& streamed, Texture& texture, const LoadedLevel& loaded);
+
+  // Frees the finest level of the least recently used texture that can
+  // spare one without being asked for it again right away.
+  bool EvictLevel();
+
+  static bool ReadLevel(const std::string& path, int width, int height, int channels, int level,
+                        std::vector<unsigned char>* pixels);
+
+  std::unordered_map<const Texture*, StreamedTexture> textures_;
+
+  std::mutex loaded_mutex_;
+  std::vector<LoadedLevel> loaded_;
+
+  bool enabled_ = false;
+  std::size_t budget_ = kDefaultBudget;
+  std::size_t frame_ = 1;
+  std::size_t resident_bytes_ = 0;
+  std::size_t pending_bytes_ = 0;
+  std::size_t pending_ = 0;
+  std::size_t requested_bytes_ = 0;
+  std::size_t evicted_bytes_ = 0;
+
+  // The streaming thread. Destroyed first, so it never outlives |loaded_|.
+  ThreadPool pool_{1};
+};
+
+#endif // TEXTURE_STREAMER_H_
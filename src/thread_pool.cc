@@ -0,0 +1,99 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+  if (thread_count == 0) {
+    unsigned int cores = std::thread::hardware_concurrency();
+    thread_count = std::max(1u, cores > 1 ? cores - 1 : 1u);
+  }
+
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back(&ThreadPool::Run, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  task_available_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  task_available_.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return tasks_.empty() && running_tasks_ == 0; });
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body) {
+  if (count == 0) {
+    return;
+  }
+
+  // A few chunks per thread even out uneven work.
+  std::size_t chunk_count = std::min(count, threads_.size() * 4);
+  std::size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+  std::mutex done_mutex;
+  std::condition_variable done;
+  std::size_t remaining = 0;
+
+  for (std::size_t begin = 0; begin < count; begin += chunk_size) {
+    std::size_t end = std::min(begin + chunk_size, count);
+    {
+      std::lock_guard<std::mutex> lock(done_mutex);
+      ++remaining;
+    }
+    Submit([&, begin, end] {
+      body(begin, end);
+      std::lock_guard<std::mutex> lock(done_mutex);
+      if (--remaining == 0) {
+        done.notify_one();
+      }
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(done_mutex);
+  done.wait(lock, [&] { return remaining == 0; });
+}
+
+void ThreadPool::Run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_available_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+      ++running_tasks_;
+    }
+
+    task();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --running_tasks_;
+      if (tasks_.empty() && running_tasks_ == 0) {
+        idle_.notify_all();
+      }
+    }
+  }
+}
@@ -0,0 +1,48 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in FIFO order. Tasks
+// must not touch GL, the context is only current on the render thread.
+class ThreadPool {
+ public:
+  // 0 picks one thread per core, leaving one for the render thread.
+  explicit ThreadPool(std::size_t thread_count = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void Submit(std::function<void()> task);
+
+  // Blocks until the queue is empty and no task is running.
+  void WaitIdle();
+
+  // Splits [0, count) into chunks, runs |body(begin, end)| on the workers and
+  // returns once every chunk is done. Must not be called from a worker.
+  void ParallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body);
+
+  std::size_t GetThreadCount() const { return threads_.size(); }
+
+ private:
+  void Run();
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::condition_variable idle_;
+  std::deque<std::function<void()>> tasks_;
+  std::size_t running_tasks_ = 0;
+  bool stopping_ = false;
+};
+
+#endif // THREAD_POOL_H_
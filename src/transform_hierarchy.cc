@@ -0,0 +1,413 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_HIERARCHY_SSE2
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// The kernel is written once against these: |kWidth| nodes side by side,
+// one float of each per lane.
+struct Lanes1 {
+  static const int kWidth = 1;
+  float v;
+
+  static Lanes1 Load(const float* values) { return {*values}; }
+  static Lanes1 Broadcast(float value) { return {value}; }
+  static Lanes1 Gather(const float* values, const int* indices, int stride) {
+    return {values[indices[0] * stride]};
+  }
+  void Store(float* values) const { *values = v; }
+  // out[lane] = {rows[0], rows[1], rows[2], rows[3]} of that lane.
+  static void Transpose(const Lanes1* rows, float (*out)[4]) {
+    for (int row = 0; row < 4; ++row) {
+      out[0][row] = rows[row].v;
+    }
+  }
+};
+
+inline Lanes1 operator+(Lanes1 a, Lanes1 b) { return {a.v + b.v}; }
+inline Lanes1 operator-(Lanes1 a, Lanes1 b) { return {a.v - b.v}; }
+inline Lanes1 operator*(Lanes1 a, Lanes1 b) { return {a.v * b.v}; }
+inline Lanes1 operator/(Lanes1 a, Lanes1 b) { return {a.v / b.v}; }
+
+#if defined(TRANSFORM_HIERARCHY_SSE2)
+struct Lanes4 {
+  static const int kWidth = 4;
+  __m128 v;
+
+  static Lanes4 Load(const float* values) { return {_mm_loadu_ps(values)}; }
+  static Lanes4 Broadcast(float value) { return {_mm_set1_ps(value)}; }
+  static Lanes4 Gather(const float* values, const int* indices, int stride) {
+    return {_mm_setr_ps(values[indices[0] * stride], values[indices[1] * stride], values[indices[2] * stride],
+                        values[indices[3] * stride])};
+  }
+  void Store(float* values) const { _mm_storeu_ps(values, v); }
+  static void Transpose(const Lanes4* rows, float (*out)[4]) {
+    __m128 r0 = rows[0].v, r1 = rows[1].v, r2 = rows[2].v, r3 = rows[3].v;
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(out[0], r0);
+    _mm_storeu_ps(out[1], r1);
+    _mm_storeu_ps(out[2], r2);
+    _mm_storeu_ps(out[3], r3);
+  }
+};
+
+inline Lanes4 operator+(Lanes4 a, Lanes4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Lanes4 operator-(Lanes4 a, Lanes4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Lanes4 operator*(Lanes4 a, Lanes4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Lanes4 operator/(Lanes4 a, Lanes4 b) { return {_mm_div_ps(a.v, b.v)}; }
+#endif
+
+#if defined(__AVX__)
+struct Lanes8 {
+  static const int kWidth = 8;
+  __m256 v;
+
+  static Lanes8 Load(const float* values) { return {_mm256_loadu_ps(values)}; }
+  static Lanes8 Broadcast(float value) { return {_mm256_set1_ps(value)}; }
+  static Lanes8 Gather(const float* values, const int* indices, int stride) {
+    return {_mm256_setr_ps(values[indices[0] * stride], values[indices[1] * stride], values[indices[2] * stride],
+                           values[indices[3] * stride], values[indices[4] * stride], values[indices[5] * stride],
+                           values[indices[6] * stride], values[indices[7] * stride])};
+  }
+  void Store(float* values) const { _mm256_storeu_ps(values, v); }
+  static void Transpose(const Lanes8* rows, float (*out)[4]) {
+    for (int half = 0; half < 2; ++half) {
+      Lanes4 half_rows[4];
+      for (int row = 0; row < 4; ++row) {
+        half_rows[row].v = half ? _mm256_extractf128_ps(rows[row].v, 1) : _mm256_castps256_ps128(rows[row].v);
+      }
+      Lanes4::Transpose(half_rows, out + half * 4);
+    }
+  }
+};
+
+inline Lanes8 operator+(Lanes8 a, Lanes8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Lanes8 operator-(Lanes8 a, Lanes8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Lanes8 operator*(Lanes8 a, Lanes8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Lanes8 operator/(Lanes8 a, Lanes8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+#endif
+
+// Moves the first new_slots.size() values to their new slots.
+template <typename T>
+void PermuteSlots(std::vector<T>* values, const std::vector<std::size_t>& new_slots) {
+  std::vector<T> permuted(values->begin(), values->end());
+  for (std::size_t slot = 0; slot < new_slots.size(); ++slot) {
+    permuted[new_slots[slot]] = (*values)[slot];
+  }
+  values->swap(permuted);
+}
+
+TransformHierarchy::TransformHierarchy(ThreadPool* pool)
+    : pool_(pool),
+      updated_count_(0) {
+  Clear();
+}
+
+TransformHierarchy::Node TransformHierarchy::AddNode(Node parent) {
+  Node node = (Node)slot_of_node_.size();
+  std::size_t slot = node;
+
+  parent_node_.push_back(parent);
+  depth_.push_back(parent == kNoParent ? 0 : depth_[parent] + 1);
+  slot_of_node_.push_back(slot);
+
+  const float kIdentity[kLocalComponentCount] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+  for (int i = 0; i < kLocalComponentCount; ++i) {
+    local_[i].push_back(kIdentity[i]);
+  }
+  parent_slot_.push_back(0);
+  dirty_.push_back(1);
+  updated_.back() = 0;
+  updated_.push_back(0);
+  node_of_slot_.push_back(node);
+  // Also moves the identity past the end along.
+  world_matrices_.emplace_back(1.0f);
+  normal_matrices_.emplace_back(1.0f);
+
+  layout_dirty_ = true;
+  return node;
+}
+
+void TransformHierarchy::Clear() {
+  parent_node_.clear();
+  depth_.clear();
+  slot_of_node_.clear();
+  for (auto& component : local_) {
+    component.clear();
+  }
+  parent_slot_.clear();
+  dirty_.clear();
+  updated_.assign(1, 0);
+  node_of_slot_.clear();
+  world_matrices_.assign(1, glm::mat4(1.0f));
+  normal_matrices_.clear();
+  level_begin_.assign(1, 0);
+  layout_dirty_ = false;
+  stats_ = Stats();
+}
+
+void TransformHierarchy::SetTranslation(Node node, const glm::vec3& translation) {
+  std::size_t slot = slot_of_node_[node];
+  local_[kTranslationX][slot] = translation.x;
+  local_[kTranslationY][slot] = translation.y;
+  local_[kTranslationZ][slot] = translation.z;
+  dirty_[slot] = 1;
+}
+
+void TransformHierarchy::SetRotation(Node node, const glm::quat& rotation) {
+  std::size_t slot = slot_of_node_[node];
+  local_[kRotationX][slot] = rotation.x;
+  local_[kRotationY][slot] = rotation.y;
+  local_[kRotationZ][slot] = rotation.z;
+  local_[kRotationW][slot] = rotation.w;
+  dirty_[slot] = 1;
+}
+
+void TransformHierarchy::SetScale(Node node, const glm::vec3& scale) {
+  std::size_t slot = slot_of_node_[node];
+  local_[kScaleX][slot] = scale.x;
+  local_[kScaleY][slot] = scale.y;
+  local_[kScaleZ][slot] = scale.z;
+  dirty_[slot] = 1;
+}
+
+void TransformHierarchy::SetLocal(Node node, const glm::vec3& translation, const glm::quat& rotation,
+                                  const glm::vec3& scale) {
+  SetTranslation(node, translation);
+  SetRotation(node, rotation);
+  SetScale(node, scale);
+}
+
+glm::vec3 TransformHierarchy::GetTranslation(Node node) const {
+  std::size_t slot = slot_of_node_[node];
+  return {local_[kTranslationX][slot], local_[kTranslationY][slot], local_[kTranslationZ][slot]};
+}
+
+glm::quat TransformHierarchy::GetRotation(Node node) const {
+  std::size_t slot = slot_of_node_[node];
+  return glm::quat(local_[kRotationW][slot], local_[kRotationX][slot], local_[kRotationY][slot],
+                   local_[kRotationZ][slot]);
+}
+
+glm::vec3 TransformHierarchy::GetScale(Node node) const {
+  std::size_t slot = slot_of_node_[node];
+  return {local_[kScaleX][slot], local_[kScaleY][slot], local_[kScaleZ][slot]};
+}
+
+void TransformHierarchy::Update() {
+  if (layout_dirty_) {
+    RebuildLayout();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  updated_count_ = 0;
+  for (std::size_t level = 0; level + 1 < level_begin_.size(); ++level) {
+    std::size_t begin = level_begin_[level];
+    std::size_t end = level_begin_[level + 1];
+    if (!pool_ || end - begin < kParallelMinSlots) {
+      updated_count_ += UpdateSlots(begin, end);
+      continue;
+    }
+
+    std::size_t chunk_count = (end - begin + kChunkSlots - 1) / kChunkSlots;
+    pool_->ParallelFor(chunk_count, [&](std::size_t first_chunk, std::size_t last_chunk) {
+      std::size_t updated = 0;
+      for (std::size_t chunk = first_chunk; chunk < last_chunk; ++chunk) {
+        std::size_t chunk_begin = begin + chunk * kChunkSlots;
+        updated += UpdateSlots(chunk_begin, std::min(chunk_begin + kChunkSlots, end));
+      }
+      updated_count_ += updated;
+    });
+  }
+
+  stats_.nodes = slot_of_node_.size();
+  stats_.levels = level_begin_.size() - 1;
+  stats_.updated = updated_count_;
+  stats_.update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* TransformHierarchy::GetSimdName() {
+#if defined(__AVX__)
+  return "AVX";
+#elif defined(TRANSFORM_HIERARCHY_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+void TransformHierarchy::RebuildLayout() {
+  std::size_t count = slot_of_node_.size();
+
+  // Counting sort by depth, stable so siblings stay together.
+  int max_depth = depth_.empty() ? -1 : *std::max_element(depth_.begin(), depth_.end());
+  level_begin_.assign(max_depth + 2, 0);
+  for (int depth : depth_) {
+    ++level_begin_[depth + 1];
+  }
+  for (std::size_t level = 1; level < level_begin_.size(); ++level) {
+    level_begin_[level] += level_begin_[level - 1];
+  }
+
+  std::vector<std::size_t> next_slot(level_begin_.begin(), level_begin_.end() - 1);
+  std::vector<std::size_t> new_slots(count);
+  for (std::size_t slot = 0; slot < count; ++slot) {
+    new_slots[slot] = next_slot[depth_[node_of_slot_[slot]]]++;
+  }
+
+  for (auto& component : local_) {
+    PermuteSlots(&component, new_slots);
+  }
+  PermuteSlots(&dirty_, new_slots);
+  PermuteSlots(&updated_, new_slots);
+  PermuteSlots(&node_of_slot_, new_slots);
+  PermuteSlots(&world_matrices_, new_slots);
+  PermuteSlots(&normal_matrices_, new_slots);
+
+  for (std::size_t slot = 0; slot < count; ++slot) {
+    slot_of_node_[node_of_slot_[slot]] = slot;
+  }
+  for (std::size_t slot = 0; slot < count; ++slot) {
+    Node parent = parent_node_[node_of_slot_[slot]];
+    parent_slot_[slot] = (int)(parent == kNoParent ? count : slot_of_node_[parent]);
+  }
+
+  layout_dirty_ = false;
+}
+
+std::size_t TransformHierarchy::UpdateSlots(std::size_t begin, std::size_t end) {
+  std::size_t slot = begin;
+  std::size_t updated = 0;
+#if defined(__AVX__)
+  for (; slot + 8 <= end; slot += 8) {
+    updated += UpdateLanes<Lanes8>(slot);
+  }
+#endif
+#if defined(TRANSFORM_HIERARCHY_SSE2)
+  for (; slot + 4 <= end; slot += 4) {
+    updated += UpdateLanes<Lanes4>(slot);
+  }
+#endif
+  for (; slot < end; ++slot) {
+    updated += UpdateLanes<Lanes1>(slot);
+  }
+  return updated;
+}
+
+template <typename Lanes>
+std::size_t TransformHierarchy::UpdateLanes(std::size_t slot) {
+  const int kWidth = Lanes::kWidth;
+  const int* parents = parent_slot_.data() + slot;
+
+  // A node changes with its local transform or its parent's world matrix.
+  // Parents are a level up, so their flags are already this frame's.
+  bool needs_update[kWidth];
+  bool any_update = false;
+  for (int lane = 0; lane < kWidth; ++lane) {
+    needs_update[lane] = dirty_[slot + lane] || updated_[parents[lane]];
+    any_update = any_update || needs_update[lane];
+  }
+  if (!any_update) {
+    std::fill(updated_.begin() + slot, updated_.begin() + slot + kWidth, 0);
+    return 0;
+  }
+
+  Lanes local[kLocalComponentCount];
+  for (int i = 0; i < kLocalComponentCount; ++i) {
+    local[i] = Lanes::Load(local_[i].data() + slot);
+  }
+  // Affine part of the parents' world matrices, column major.
+  Lanes parent[kWorldComponentCount];
+  const float* parent_values = glm::value_ptr(world_matrices_.front());
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 3; ++row) {
+      parent[column * 3 + row] = Lanes::Gather(parent_values + column * 4 + row, parents, 16);
+    }
+  }
+
+  // Rotation from the unit quaternion, columns scaled.
+  Lanes x = local[kRotationX], y = local[kRotationY], z = local[kRotationZ], w = local[kRotationW];
+  Lanes x2 = x + x, y2 = y + y, z2 = z + z;
+  Lanes xx = x * x2, yy = y * y2, zz = z * z2;
+  Lanes xy = x * y2, xz = x * z2, yz = y * z2;
+  Lanes wx = w * x2, wy = w * y2, wz = w * z2;
+  Lanes one = Lanes::Broadcast(1.0f);
+
+  Lanes matrix[kWorldComponentCount] = {
+    (one - (yy + zz)) * local[kScaleX], (xy + wz) * local[kScaleX], (xz - wy) * local[kScaleX],
+    (xy - wz) * local[kScaleY], (one - (xx + zz)) * local[kScaleY], (yz + wx) * local[kScaleY],
+    (xz + wy) * local[kScaleZ], (yz - wx) * local[kScaleZ], (one - (xx + yy)) * local[kScaleZ],
+    local[kTranslationX], local[kTranslationY], local[kTranslationZ],
+  };
+
+  Lanes world[kWorldComponentCount];
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 3; ++row) {
+      Lanes value = parent[row] * matrix[column * 3] + parent[3 + row] * matrix[column * 3 + 1] +
+                    parent[6 + row] * matrix[column * 3 + 2];
+      world[column * 3 + row] = column == 3 ? value + parent[9 + row] : value;
+    }
+  }
+
+  // transpose(inverse(m)) of the 3x3 part: the columns' cross products over
+  // the determinant.
+  const Lanes* a = world;
+  const Lanes* b = world + 3;
+  const Lanes* c = world + 6;
+  Lanes normal[9] = {
+    b[1] * c[2] - b[2] * c[1], b[2] * c[0] - b[0] * c[2], b[0] * c[1] - b[1] * c[0],
+    c[1] * a[2] - c[2] * a[1], c[2] * a[0] - c[0] * a[2], c[0] * a[1] - c[1] * a[0],
+    a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0],
+  };
+  Lanes inverse_determinant = one / (a[0] * normal[0] + a[1] * normal[1] + a[2] * normal[2]);
+
+  for (int i = 0; i < 9; ++i) {
+    normal[i] = normal[i] * inverse_determinant;
+  }
+
+  // Columns of the output matrices, one per lane.
+  float world_columns[4][kWidth][4];
+  float normal_columns[3][kWidth][4];
+  Lanes zero = Lanes::Broadcast(0.0f);
+  for (int column = 0; column < 4; ++column) {
+    Lanes rows[4] = {world[column * 3], world[column * 3 + 1], world[column * 3 + 2], column == 3 ? one : zero};
+    Lanes::Transpose(rows, world_columns[column]);
+  }
+  for (int column = 0; column < 3; ++column) {
+    Lanes rows[4] = {normal[column * 3], normal[column * 3 + 1], normal[column * 3 + 2], zero};
+    Lanes::Transpose(rows, normal_columns[column]);
+  }
+
+  std::size_t updated = 0;
+  for (int lane = 0; lane < kWidth; ++lane) {
+    dirty_[slot + lane] = 0;
+    updated_[slot + lane] = needs_update[lane];
+    if (!needs_update[lane]) {
+      continue;
+    }
+    ++updated;
+
+    glm::mat4& world_matrix = world_matrices_[slot + lane];
+    for (int column = 0; column < 4; ++column) {
+      std::memcpy(&world_matrix[column], world_columns[column][lane], sizeof(glm::vec4));
+    }
+    glm::mat3& normal_matrix = normal_matrices_[slot + lane];
+    for (int column = 0; column < 3; ++column) {
+      std::memcpy(&normal_matrix[column], normal_columns[column][lane], sizeof(glm::vec3));
+    }
+  }
+  return updated;
+}
@@ -0,0 +1,121 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef TRANSFORM_HIERARCHY_H_
+#define TRANSFORM_HIERARCHY_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "thread_pool.h"
+
+// Translation, rotation and scale of many nodes with parents, turned into
+// world and normal matrices in bulk. Setters only mark a node dirty;
+// Update() recomputes the dirty nodes and everything below them, and
+// leaves the rest alone.
+//
+// Local transforms are kept structure of arrays, and everything is sorted
+// by depth so a level is one contiguous range whose parents are all done.
+// Each level is processed in AVX, SSE2 or scalar lanes, several nodes at
+// once, and split across the workers of |pool| once it is large. The
+// matrices come out as glm types, ready for InstanceData.
+class TransformHierarchy {
+ public:
+  using Node = int;
+  static const Node kNoParent = -1;
+
+  struct Stats {
+    std::size_t nodes = 0;
+    std::size_t levels = 0;
+    // In the last Update().
+    std::size_t updated = 0;
+    double update_ms = 0.0;
+  };
+
+  // Large levels are spread over |pool| when given, which must outlive the
+  // hierarchy.
+  explicit TransformHierarchy(ThreadPool* pool = nullptr);
+
+  TransformHierarchy(const TransformHierarchy&) = delete;
+  TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+  // |parent| must have been added before. Starts as the identity.
+  Node AddNode(Node parent = kNoParent);
+  void Clear();
+
+  std::size_t GetNodeCount() const { return slot_of_node_.size(); }
+
+  void SetTranslation(Node node, const glm::vec3& translation);
+  void SetRotation(Node node, const glm::quat& rotation);
+  void SetScale(Node node, const glm::vec3& scale);
+  void SetLocal(Node node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+  glm::vec3 GetTranslation(Node node) const;
+  glm::quat GetRotation(Node node) const;
+  glm::vec3 GetScale(Node node) const;
+
+  // Not from a worker of any ThreadPool, it waits on its own.
+  void Update();
+
+  // As of the last Update().
+  const glm::mat4& GetWorldMatrix(Node node) const { return world_matrices_[slot_of_node_[node]]; }
+  const glm::mat3& GetNormalMatrix(Node node) const { return normal_matrices_[slot_of_node_[node]]; }
+  // Whether the last Update() changed the node's matrices.
+  bool IsUpdated(Node node) const { return updated_[slot_of_node_[node]] != 0; }
+
+  Stats GetStats() const { return stats_; }
+
+  // Widest lanes compiled in: "AVX", "SSE2" or "scalar".
+  static const char* GetSimdName();
+
+ private:
+  // Levels smaller than this aren't worth waking the workers for.
+  static const std::size_t kParallelMinSlots = 4096;
+  static const std::size_t kChunkSlots = 1024;
+
+  enum LocalComponent {
+    kTranslationX, kTranslationY, kTranslationZ,
+    kRotationX, kRotationY, kRotationZ, kRotationW,
+    kScaleX, kScaleY, kScaleZ,
+    kLocalComponentCount
+  };
+  // Affine part of a world matrix.
+  static const int kWorldComponentCount = 12;
+
+  // Sorts the slots by depth after nodes were added.
+  void RebuildLayout();
+
+  // Returns the number of slots updated.
+  std::size_t UpdateSlots(std::size_t begin, std::size_t end);
+  template <typename Lanes>
+  std::size_t UpdateLanes(std::size_t slot);
+
+  // By node.
+  std::vector<Node> parent_node_;
+  std::vector<int> depth_;
+  std::vector<std::size_t> slot_of_node_;
+
+  // By slot. |world_matrices_| has an identity entry past the last slot,
+  // the parent of the roots.
+  std::array<std::vector<float>, kLocalComponentCount> local_;
+  std::vector<int> parent_slot_;
+  std::vector<std::uint8_t> dirty_;
+  std::vector<std::uint8_t> updated_;
+  std::vector<Node> node_of_slot_;
+  std::vector<glm::mat4> world_matrices_;
+  std::vector<glm::mat3> normal_matrices_;
+
+  // Slot ranges of the levels, root level first.
+  std::vector<std::size_t> level_begin_;
+  bool layout_dirty_ = false;
+
+  ThreadPool* pool_;
+  std::atomic<std::size_t> updated_count_;
+  Stats stats_;
+};
+
+#endif // TRANSFORM_HIERARCHY_H_
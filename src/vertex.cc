@@ -2,9 +2,55 @@
 
 #include "vertex.h"
 
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
+
 Vertex::Vertex(const glm::vec3& pos,
                const glm::vec3& normal,
                const glm::vec2& tex_coords)
     : position_(pos),
       normal_(normal),
       tex_coords_(tex_coords) {}
+
+glm::vec2 EncodeOctahedral(const glm::vec3& normal) {
+  glm::vec2 p = glm::vec2(normal) / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+  if (normal.z < 0.0f) {
+    // Fold the lower hemisphere over the diagonals.
+    glm::vec2 sign(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * sign;
+  }
+  return p;
+}
+
+std::vector<PackedVertex> PackVertices(const std::vector<Vertex>& vertices, glm::vec3* scale, glm::vec3* offset) {
+  glm::vec3 min(0.0f), max(0.0f);
+  if (!vertices.empty()) {
+    min = max = vertices[0].GetPosition();
+  }
+  for (auto& vertex : vertices) {
+    min = glm::min(min, vertex.GetPosition());
+    max = glm::max(max, vertex.GetPosition());
+  }
+
+  // Flat meshes still get a non-zero extent on every axis.
+  *offset = (min + max) * 0.5f;
+  glm::vec3 half_extent = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
+  *scale = half_extent / 32767.0f;
+
+  std::vector<PackedVertex> packed(vertices.size());
+  for (std::size_t i = 0; i < vertices.size(); ++i) {
+    glm::vec3 position = glm::round((vertices[i].GetPosition() - *offset) / half_extent * 32767.0f);
+    position = glm::clamp(position, glm::vec3(-32767.0f), glm::vec3(32767.0f));
+    packed[i].position[0] = (GLshort)position.x;
+    packed[i].position[1] = (GLshort)position.y;
+    packed[i].position[2] = (GLshort)position.z;
+    packed[i].position[3] = 0;
+
+    glm::ivec2 normal(glm::round(EncodeOctahedral(glm::normalize(vertices[i].GetNormal())) * 511.0f));
+    packed[i].normal = ((GLuint)normal.x & 0x3ff) | (((GLuint)normal.y & 0x3ff) << 10);
+
+    packed[i].tex_coords = glm::packHalf2x16(vertices[i].GetTexCoords());
+  }
+  return packed;
+}
@@ -3,8 +3,12 @@
 #ifndef VERTEX_H_
 #define VERTEX_H_
 
+#include <vector>
+
 #include <glm/glm.hpp>
 
+#include "vertex_layout.h"
+
 class Vertex {
  public:
   Vertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec2& tex_coords);
@@ -16,9 +20,53 @@ class Vertex {
   glm::vec2 GetTexCoords() const { return tex_coords_; }
 
  private:
+  template <typename V>
+  friend struct VertexLayout;
+
   glm::vec3 position_;
   glm::vec3 normal_;
   glm::vec2 tex_coords_;
 };
 
+// Half the size of Vertex. Positions are quantised to 16 bits inside the
+// mesh bounds, see PackVertices(). Normals are octahedral encoded, two 10
+// bit components of GL_INT_2_10_10_10_REV. Texture coordinates are half
+// floats.
+struct PackedVertex {
+  // The fourth component only pads to 4 bytes.
+  GLshort position[4];
+  GLuint normal;
+  GLuint tex_coords;
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+template <>
+struct VertexLayout<Vertex> {
+  static constexpr std::array<VertexAttribute, 3> kAttributes = {{
+    {0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position_)},
+    {1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal_)},
+    {2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, tex_coords_)},
+  }};
+};
+
+// Positions and normals stay integers, vertex_shader.vs scales them. GL 3.3
+// and 4.2 normalise signed integers differently.
+template <>
+struct VertexLayout<PackedVertex> {
+  static constexpr std::array<VertexAttribute, 3> kAttributes = {{
+    {0, 3, GL_SHORT, GL_FALSE, offsetof(PackedVertex, position)},
+    {1, 4, GL_INT_2_10_10_10_REV, GL_FALSE, offsetof(PackedVertex, normal)},
+    {2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, tex_coords)},
+  }};
+};
+
+// Quantises |vertices| inside their bounding box. A position comes back as
+// |offset| + |scale| * the stored integers.
+std::vector<PackedVertex> PackVertices(const std::vector<Vertex>& vertices, glm::vec3* scale, glm::vec3* offset);
+
+// Octahedral encoding of a unit vector into a square, both components in
+// [-1, 1].
+glm::vec2 EncodeOctahedral(const glm::vec3& normal);
+
 #endif // VERTEX_H_
@@ -0,0 +1,37 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef VERTEX_LAYOUT_H_
+#define VERTEX_LAYOUT_H_
+
+#include <array>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+struct VertexAttribute {
+  GLuint location;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  std::size_t offset;
+};
+
+// Specialised next to every vertex type with a constexpr |kAttributes|
+// array, which SetupVertexAttributes() turns into GL calls.
+template <typename V>
+struct VertexLayout;
+
+// Points the attributes of the bound vertex array at the bound
+// GL_ARRAY_BUFFER, which holds tightly packed |V|s from |base_offset| on.
+// A |divisor| of 1 advances them per instance instead of per vertex.
+template <typename V>
+void SetupVertexAttributes(std::size_t base_offset = 0, GLuint divisor = 0) {
+  for (const auto& attribute : VertexLayout<V>::kAttributes) {
+    glEnableVertexAttribArray(attribute.location);
+    glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                          sizeof(V), (void*)(base_offset + attribute.offset));
+    glVertexAttribDivisor(attribute.location, divisor);
+  }
+}
+
+#endif // VERTEX_LAYOUT_H_
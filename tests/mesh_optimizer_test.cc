@@ -0,0 +1,148 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "mesh_optimizer.h"
+#include "test_check.h"
+#include "test_model.h"
+
+using VertexKey = std::array<float, 8>;
+using TriangleKey = std::array<VertexKey, 3>;
+
+VertexKey GetVertexKey(const Vertex& vertex) {
+  auto position = vertex.GetPosition();
+  auto normal = vertex.GetNormal();
+  auto tex_coords = vertex.GetTexCoords();
+  return {position.x, position.y, position.z, normal.x, normal.y, normal.z, tex_coords.x, tex_coords.y};
+}
+
+// Triangles by vertex contents, since indices are renumbered. Each one is
+// rotated to start at its smallest vertex, keeping the winding.
+std::vector<TriangleKey> GetTriangles(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+  std::vector<TriangleKey> triangles;
+  for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+    TriangleKey triangle = {GetVertexKey(vertices[indices[i]]), GetVertexKey(vertices[indices[i + 1]]),
+                            GetVertexKey(vertices[indices[i + 2]])};
+    std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+// Optimizes a copy and checks the triangles are exactly those of the input,
+// and that only referenced vertices remain.
+MeshOptimizer::Report CheckOptimize(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+  auto optimized_vertices = vertices;
+  auto optimized_indices = indices;
+  std::vector<GLuint> triangle_sources;
+  auto report = MeshOptimizer::Optimize(&optimized_vertices, &optimized_indices, &triangle_sources);
+
+  CHECK(optimized_indices.size() == indices.size());
+  for (GLuint index : optimized_indices) {
+    CHECK(index < optimized_vertices.size());
+    if (index >= optimized_vertices.size()) {
+      return report;
+    }
+  }
+  CHECK(GetTriangles(optimized_vertices, optimized_indices) == GetTriangles(vertices, indices));
+
+  // Every output triangle is its source triangle, corners in order.
+  CHECK(triangle_sources.size() == indices.size() / 3);
+  for (std::size_t t = 0; t < triangle_sources.size() && t * 3 < optimized_indices.size(); ++t) {
+    for (int corner = 0; corner < 3; ++corner) {
+      CHECK(GetVertexKey(optimized_vertices[optimized_indices[t * 3 + corner]]) ==
+            GetVertexKey(vertices[indices[triangle_sources[t] * 3 + corner]]));
+    }
+  }
+
+  std::set<GLuint> referenced(indices.begin(), indices.end());
+  std::set<GLuint> optimized_referenced(optimized_indices.begin(), optimized_indices.end());
+  CHECK(optimized_vertices.size() == referenced.size());
+  CHECK(optimized_referenced.size() == optimized_vertices.size());
+  return report;
+}
+
+std::vector<Vertex> MakeRandomVertices(std::size_t count, std::mt19937* rng) {
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+  std::vector<Vertex> vertices;
+  for (std::size_t i = 0; i < count; ++i) {
+    glm::vec3 normal = glm::normalize(glm::vec3(value(*rng), value(*rng), value(*rng)) + glm::vec3(0.0f, 0.0f, 3.0f));
+    vertices.emplace_back(glm::vec3(value(*rng), value(*rng), value(*rng)), normal,
+                          glm::vec2(value(*rng), value(*rng)));
+  }
+  return vertices;
+}
+
+void TestRandomMeshes() {
+  std::mt19937 rng(7);
+  for (int mesh = 0; mesh < 20; ++mesh) {
+    // Vertices past |used| are never referenced.
+    std::size_t vertex_count = 50 + rng() % 500;
+    std::size_t used = vertex_count - rng() % 40;
+    auto vertices = MakeRandomVertices(vertex_count, &rng);
+
+    std::vector<GLuint> indices;
+    std::size_t triangle_count = 1 + rng() % 3000;
+    for (std::size_t triangle = 0; triangle < triangle_count; ++triangle) {
+      for (int corner = 0; corner < 3; ++corner) {
+        indices.push_back(rng() % used);
+      }
+      // Repeated and degenerate triangles.
+      if (rng() % 10 == 0) {
+        indices.insert(indices.end(), indices.end() - 3, indices.end());
+      }
+      if (rng() % 10 == 0) {
+        GLuint index = rng() % used;
+        indices.insert(indices.end(), {index, index, (GLuint)(rng() % used)});
+      }
+    }
+    CheckOptimize(vertices, indices);
+  }
+}
+
+void TestDegenerateMeshes() {
+  std::mt19937 rng(11);
+  auto vertices = MakeRandomVertices(10, &rng);
+
+  CheckOptimize(vertices, {});
+  CheckOptimize(vertices, {3, 5, 7});
+  CheckOptimize(vertices, {4, 4, 4, 4, 4, 4, 2, 2, 2});
+  CheckOptimize(vertices, {0, 1, 1, 1, 0, 0, 0, 1, 0});
+}
+
+void TestSphereCache() {
+  std::vector<Vertex> vertices;
+  std::vector<GLuint> indices;
+  TestModel::MakeSphere(1.0f, 64, 128, &vertices, &indices);
+
+  auto report = CheckOptimize(vertices, indices);
+  CHECK(report.after.acmr <= report.before.acmr);
+  CHECK(report.after.acmr < 0.8f);
+
+  // Shuffled triangles have to be brought back to the same level.
+  std::mt19937 rng(3);
+  std::vector<std::size_t> order(indices.size() / 3);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+  std::vector<GLuint> shuffled;
+  for (std::size_t triangle : order) {
+    shuffled.insert(shuffled.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+  }
+  auto shuffled_report = CheckOptimize(vertices, shuffled);
+  CHECK(shuffled_report.after.acmr < shuffled_report.before.acmr);
+  CHECK(shuffled_report.after.acmr < 0.8f);
+}
+
+int main() {
+  TestRandomMeshes();
+  TestDegenerateMeshes();
+  TestSphereCache();
+  return TestResult();
+}
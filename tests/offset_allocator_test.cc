@@ -0,0 +1,121 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "offset_allocator.h"
+#include "test_check.h"
+
+// Smallest size whose bin only holds ranges of at least |size|: anything
+// this long must be found, shorter ranges of |size|'s own bin may not be.
+std::uint32_t GuaranteedFitSize(std::uint32_t size) {
+  if (size < 8) {
+    return size;
+  }
+  int high_bit = 31 - __builtin_clz(size);
+  std::uint32_t rounded = size + (1u << (high_bit - 3)) - 1;
+  int shift = (31 - __builtin_clz(rounded)) - 3;
+  return rounded >> shift << shift;
+}
+
+std::uint32_t LargestFreeRun(const std::vector<bool>& owned) {
+  std::uint32_t largest = 0, run = 0;
+  for (bool unit_owned : owned) {
+    run = unit_owned ? 0 : run + 1;
+    largest = std::max(largest, run);
+  }
+  return largest;
+}
+
+void TestRandomAllocations() {
+  const std::uint32_t kSize = 1 << 16;
+  OffsetAllocator allocator(kSize);
+  std::vector<bool> owned(kSize, false);
+  std::vector<OffsetAllocator::Allocation> live;
+  std::uint32_t used = 0;
+  std::size_t failures = 0;
+
+  std::mt19937 rng(5);
+  for (int step = 0; step < 200000; ++step) {
+    if (live.empty() || rng() % 100 < 55) {
+      std::uint32_t size = 1 + rng() % (rng() % 10 == 0 ? 4000 : 200);
+      auto allocation = allocator.Allocate(size);
+      if (!allocation.IsValid()) {
+        // Checking every failure is quadratic, the first few hundred and a
+        // sample after are plenty.
+        if (failures++ < 500 || failures % 64 == 0) {
+          CHECK(LargestFreeRun(owned) < GuaranteedFitSize(size));
+        }
+        continue;
+      }
+
+      std::uint32_t allocated = allocator.GetAllocationSize(allocation);
+      CHECK(allocated >= size);
+      CHECK(allocation.offset + allocated <= kSize);
+      for (std::uint32_t unit = allocation.offset; unit < std::min(allocation.offset + allocated, kSize); ++unit) {
+        CHECK(!owned[unit]);
+        owned[unit] = true;
+      }
+      used += allocated;
+      live.push_back(allocation);
+    } else {
+      std::size_t index = rng() % live.size();
+      auto allocation = live[index];
+      live[index] = live.back();
+      live.pop_back();
+
+      std::uint32_t allocated = allocator.GetAllocationSize(allocation);
+      std::fill(owned.begin() + allocation.offset, owned.begin() + allocation.offset + allocated, false);
+      used -= allocated;
+      allocator.Free(allocation);
+    }
+
+    if (step % 1000 == 0) {
+      auto stats = allocator.GetStats();
+      CHECK(stats.used == used);
+      CHECK(stats.allocations == live.size());
+      CHECK(stats.largest_free == LargestFreeRun(owned));
+    }
+  }
+  CHECK(failures > 0);
+
+  // Everything freed merges back into the one range it started as.
+  for (auto allocation : live) {
+    allocator.Free(allocation);
+  }
+  auto stats = allocator.GetStats();
+  CHECK(stats.used == 0);
+  CHECK(stats.allocations == 0);
+  CHECK(stats.free_ranges == 1);
+  CHECK(stats.largest_free == kSize);
+  CHECK(stats.GetFragmentation() == 0.0f);
+
+  auto whole = allocator.Allocate(kSize);
+  CHECK(whole.IsValid() && whole.offset == 0);
+  CHECK(!allocator.Allocate(1).IsValid());
+}
+
+void TestExactFit() {
+  // Sizes on bin boundaries, others are rounded up to the next one.
+  OffsetAllocator allocator(1024);
+  CHECK(!allocator.Allocate(1025).IsValid());
+
+  auto first = allocator.Allocate(512);
+  auto second = allocator.Allocate(512);
+  CHECK(first.IsValid() && second.IsValid());
+  CHECK(first.offset == 0 && second.offset == 512);
+  CHECK(allocator.GetStats().free_ranges == 0);
+
+  // Freed out of order, the ranges still merge.
+  allocator.Free(first);
+  allocator.Free(second);
+  CHECK(allocator.GetStats().free_ranges == 1);
+  CHECK(allocator.GetStats().largest_free == 1024);
+}
+
+int main() {
+  TestRandomAllocations();
+  TestExactFit();
+  return TestResult();
+}
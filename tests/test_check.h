@@ -0,0 +1,33 @@
+// Created by Dong Zhong on 2026/10/18.
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <iostream>
+
+// Headless tests are plain executables run by ctest: CHECK() reports a
+// failed condition and the test's main() returns TestResult().
+inline int& TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                         \
+  do {                                                                           \
+    if (!(condition)) {                                                          \
+      std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" \
+                << std::endl;                                                    \
+      ++TestFailures();                                                          \
+    }                                                                            \
+  } while (false)
+
+inline int TestResult() {
+  if (TestFailures() > 0) {
+    std::cout << TestFailures() << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return 0;
+}
+
+#endif // TEST_CHECK_H_
@@ -0,0 +1,140 @@
+// Created by Dong Zhong on 2026/10/18.
+
+// Times decoding PNG textures with the stock stbi_load against PngDecoder,
+// single threaded and with rows spread over a thread pool, and checks that
+// both produce the same pixels. Files are read into memory first, so only
+// decoding is timed.
+//
+//   decode_benchmark [--iterations N] [--threads N] <png or directory>...
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "png_decoder.h"
+#include "stb_image.h"
+#include "thread_pool.h"
+
+struct Totals {
+  double stb_ms = 0.0;
+  double decoder_ms = 0.0;
+  double parallel_ms = 0.0;
+  std::size_t bytes = 0;
+};
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double MegabytesPerSecond(std::size_t bytes, double ms) {
+  return ms > 0.0 ? bytes / (1024.0 * 1024.0) / (ms / 1000.0) : 0.0;
+}
+
+bool Benchmark(const std::filesystem::path& input, int iterations, ThreadPool& pool, Totals* totals) {
+  std::ifstream file(input, std::ios::binary);
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  int width = 0, height = 0, channels = 0;
+  unsigned char* reference = stbi_load_from_memory(data.data(), (int)data.size(), &width, &height, &channels, 0);
+  if (!reference) {
+    std::cout << "DongZhong: " << "Failed to load " << input << std::endl;
+    return false;
+  }
+  std::size_t bytes = (std::size_t)width * height * channels;
+
+  PngDecoder::Image image;
+  if (!PngDecoder::Decode(data.data(), data.size(), &image)) {
+    std::cout << "DongZhong: " << input.filename().string() << " isn't handled by PngDecoder, stb_image only" << std::endl;
+    stbi_image_free(reference);
+    return true;
+  }
+  bool same = image.width == width && image.height == height && image.channels == channels &&
+              std::memcmp(image.pixels.data(), reference, bytes) == 0;
+  stbi_image_free(reference);
+  if (!same) {
+    std::cout << "DongZhong: " << input.filename().string() << " decodes differently from stb_image" << std::endl;
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    int w, h, c;
+    stbi_image_free(stbi_load_from_memory(data.data(), (int)data.size(), &w, &h, &c, 0));
+  }
+  double stb_ms = MillisecondsSince(start) / iterations;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    PngDecoder::Decode(data.data(), data.size(), &image);
+  }
+  double decoder_ms = MillisecondsSince(start) / iterations;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    PngDecoder::Decode(data.data(), data.size(), &image, &pool);
+  }
+  double parallel_ms = MillisecondsSince(start) / iterations;
+
+  std::cout << "DongZhong: " << input.filename().string() << " " << width << "x" << height << "x" << channels
+            << ", " << image.row_runs << " independent row runs" << std::endl;
+  std::cout << "DongZhong: " << "  stbi_load " << stb_ms << " ms (" << MegabytesPerSecond(bytes, stb_ms)
+            << " MB/s), PngDecoder " << decoder_ms << " ms (" << MegabytesPerSecond(bytes, decoder_ms)
+            << " MB/s), " << pool.GetThreadCount() << " threads " << parallel_ms << " ms ("
+            << MegabytesPerSecond(bytes, parallel_ms) << " MB/s)" << std::endl;
+
+  totals->stb_ms += stb_ms;
+  totals->decoder_ms += decoder_ms;
+  totals->parallel_ms += parallel_ms;
+  totals->bytes += bytes;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = 10;
+  std::size_t threads = 0;
+  std::vector<std::filesystem::path> inputs;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(std::stoi(argv[++i]), 1);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::stoul(argv[++i]);
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+
+  if (inputs.empty()) {
+    std::cout << "Usage: decode_benchmark [--iterations N] [--threads N] <png or directory>..." << std::endl;
+    return 1;
+  }
+
+  ThreadPool pool(threads);
+
+  Totals totals;
+  int failures = 0;
+  for (auto& input : inputs) {
+    if (std::filesystem::is_directory(input)) {
+      for (auto& entry : std::filesystem::directory_iterator(input)) {
+        if (entry.path().extension() == ".png") {
+          failures += !Benchmark(entry.path(), iterations, pool, &totals);
+        }
+      }
+    } else {
+      failures += !Benchmark(input, iterations, pool, &totals);
+    }
+  }
+
+  std::cout << "DongZhong: " << "Total: stbi_load " << totals.stb_ms << " ms, PngDecoder " << totals.decoder_ms
+            << " ms (" << totals.stb_ms / std::max(totals.decoder_ms, 1e-9) << "x), with threads "
+            << totals.parallel_ms << " ms (" << totals.stb_ms / std::max(totals.parallel_ms, 1e-9) << "x)"
+            << std::endl;
+
+  return failures == 0 ? 0 : 1;
+}
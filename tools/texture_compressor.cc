@@ -0,0 +1,154 @@
+// Created by Dong Zhong on 2026/10/18.
+
+// Converts PNG textures into block compressed KTX2 files next to them, which
+// TextureCache then prefers over the PNG. Also prints how decoding and memory
+// compare with loading the PNG through stb_image.
+//
+//   texture_compressor [--bc1|--bc3|--bc7] [--linear] [--threads N] <png or directory>...
+//
+// Without a format flag RGB images become BC1 and images with alpha BC3.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block_encoder.h"
+#include "ktx2.h"
+#include "mip_generator.h"
+#include "stb_image.h"
+#include "thread_pool.h"
+
+struct Options {
+  bool has_format = false;
+  BlockEncoder::Format format = BlockEncoder::Format::kBC1;
+  bool srgb = true;
+  std::size_t threads = 0;
+};
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t GetVkFormat(BlockEncoder::Format format, bool srgb) {
+  switch (format) {
+    case BlockEncoder::Format::kBC1:
+      return srgb ? Ktx2Image::kBC1RGBSrgb : Ktx2Image::kBC1RGBUnorm;
+    case BlockEncoder::Format::kBC3:
+      return srgb ? Ktx2Image::kBC3Srgb : Ktx2Image::kBC3Unorm;
+    case BlockEncoder::Format::kBC7:
+      return srgb ? Ktx2Image::kBC7Srgb : Ktx2Image::kBC7Unorm;
+  }
+  return 0;
+}
+
+bool Convert(const std::filesystem::path& input, const Options& options, ThreadPool& pool) {
+  auto start = std::chrono::steady_clock::now();
+  int width, height, channels;
+  unsigned char* pixels = stbi_load(input.string().c_str(), &width, &height, &channels, 4);
+  if (!pixels) {
+    std::cout << "DongZhong: " << "Failed to load " << input << std::endl;
+    return false;
+  }
+  double decode_ms = MillisecondsSince(start);
+
+  std::vector<unsigned char> rgba(pixels, pixels + (std::size_t)width * height * 4);
+  stbi_image_free(pixels);
+
+  BlockEncoder::Format format = options.format;
+  if (!options.has_format) {
+    format = channels == 4 ? BlockEncoder::Format::kBC3 : BlockEncoder::Format::kBC1;
+  }
+
+  Ktx2Image image;
+  image.vk_format = GetVkFormat(format, options.srgb);
+  image.width = width;
+  image.height = height;
+
+  // What the stb path keeps resident: RGB padded to 4 bytes plus mips.
+  std::size_t uncompressed_bytes = 0;
+  std::size_t compressed_bytes = 0;
+
+  start = std::chrono::steady_clock::now();
+  // Filtered like TextureLoader does, sRGB colour in linear space.
+  auto levels = MipGenerator::GenerateChain(rgba.data(), width, height, 4, options.srgb,
+                                            MipGenerator::Filter::kKaiser, &pool);
+  int level_width = width, level_height = height;
+  for (auto& level : levels) {
+    image.levels.push_back(BlockEncoder::CompressImage(level.data(), level_width, level_height, format, &pool));
+    compressed_bytes += image.levels.back().size();
+    uncompressed_bytes += (std::size_t)level_width * level_height * (channels == 3 ? 4 : channels);
+
+    level_width = std::max(level_width / 2, 1);
+    level_height = std::max(level_height / 2, 1);
+  }
+  double encode_ms = MillisecondsSince(start);
+
+  auto output = std::filesystem::path(input).replace_extension(".ktx2");
+  if (!WriteKtx2(output.string(), image)) {
+    std::cout << "DongZhong: " << "Failed to write " << output << std::endl;
+    return false;
+  }
+
+  start = std::chrono::steady_clock::now();
+  Ktx2Image reloaded;
+  bool read = ReadKtx2(output.string(), &reloaded);
+  double read_ms = MillisecondsSince(start);
+
+  const char* format_names[] = {"BC1", "BC3", "BC7"};
+  std::cout << "DongZhong: " << input.filename().string() << " " << width << "x" << height
+            << " -> " << format_names[(int)format] << (options.srgb ? " sRGB" : "")
+            << ", " << image.levels.size() << " levels" << std::endl;
+  std::cout << "DongZhong: " << "  encode " << encode_ms << " ms on " << pool.GetThreadCount() << " threads" << std::endl;
+  std::cout << "DongZhong: " << "  load: stb decode " << decode_ms << " ms, KTX2 read "
+            << (read ? read_ms : -1.0) << " ms" << std::endl;
+  std::cout << "DongZhong: " << "  memory: " << uncompressed_bytes / 1024 << " KB uncompressed, "
+            << compressed_bytes / 1024 << " KB compressed ("
+            << (double)uncompressed_bytes / std::max<std::size_t>(compressed_bytes, 1) << "x)" << std::endl;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  std::vector<std::filesystem::path> inputs;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--bc1" || arg == "--bc3" || arg == "--bc7") {
+      options.has_format = true;
+      options.format = arg == "--bc1" ? BlockEncoder::Format::kBC1
+                     : arg == "--bc3" ? BlockEncoder::Format::kBC3
+                                      : BlockEncoder::Format::kBC7;
+    } else if (arg == "--linear") {
+      options.srgb = false;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      options.threads = std::stoul(argv[++i]);
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+
+  if (inputs.empty()) {
+    std::cout << "Usage: texture_compressor [--bc1|--bc3|--bc7] [--linear] [--threads N] <png or directory>..." << std::endl;
+    return 1;
+  }
+
+  ThreadPool pool(options.threads);
+
+  int failures = 0;
+  for (auto& input : inputs) {
+    if (std::filesystem::is_directory(input)) {
+      for (auto& entry : std::filesystem::directory_iterator(input)) {
+        if (entry.path().extension() == ".png") {
+          failures += !Convert(entry.path(), options, pool);
+        }
+      }
+    } else {
+      failures += !Convert(input, options, pool);
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}